@@ -0,0 +1,128 @@
+#include "aggregate.h"
+#include <limits.h>
+
+
+static agg_t combine_sum(agg_t a, agg_t b) { return a + b; }
+static agg_t combine_min(agg_t a, agg_t b) { return a < b ? a : b; }
+static agg_t combine_max(agg_t a, agg_t b) { return a > b ? a : b; }
+static agg_t value_key(key_t key) { return key; }
+static agg_t value_one(key_t key) { (void)key; return 1; }
+
+const rbtree_monoid_t rbtree_monoid_sum = { 0, combine_sum, value_key };
+const rbtree_monoid_t rbtree_monoid_count = { 0, combine_sum, value_one };
+const rbtree_monoid_t rbtree_monoid_min = { LLONG_MAX, combine_min, value_key };
+const rbtree_monoid_t rbtree_monoid_max = { LLONG_MIN, combine_max, value_key };
+
+static inline agg_t agg_of(const rbtree* tree, const node_t* node)
+{
+    const rbtree_monoid_t* m = (const rbtree_monoid_t*)tree->aux;
+    return node == tree->nil ? m->identity : ((const agg_node_t*)node)->agg;
+}
+
+/*
+ * agg = left ⊕ value(node) ⊕ right (key 순서 유지)
+ */
+static void aggregate_update(const rbtree* tree, node_t* node)
+{
+    const rbtree_monoid_t* m = (const rbtree_monoid_t*)tree->aux;
+
+    agg_t agg = m->combine(agg_of(tree, node->left), m->value(node->key));
+    ((agg_node_t*)node)->agg = m->combine(agg, agg_of(tree, node->right));
+}
+
+/*
+ * monoid를 등록한 트리 생성
+ * 삽입/삭제는 rbtree_insert, rbtree_erase 그대로 사용
+ */
+rbtree* new_rbtree_aggregate(const rbtree_monoid_t* monoid)
+{
+    if (!monoid || !monoid->combine || !monoid->value) return NULL;
+
+    rbtree* tree = new_rbtree_augmented(sizeof(agg_node_t), aggregate_update);
+    if (!tree) return NULL;
+
+    tree->aux = monoid;
+    return tree;
+}
+
+/*
+ * key >= lo 인 노드들의 합
+ * 조건을 만족하는 노드를 만나면 (노드 ⊕ 오른쪽 서브트리)를 앞에 붙이고 왼쪽으로
+ */
+static agg_t aggregate_from(const rbtree* tree, node_t* node, key_t lo)
+{
+    const rbtree_monoid_t* m = (const rbtree_monoid_t*)tree->aux;
+    agg_t acc = m->identity;
+
+    while (node != tree->nil)
+    {
+        if (node->key >= lo)
+        {
+            agg_t part = m->combine(m->value(node->key), agg_of(tree, node->right));
+            acc = m->combine(part, acc);
+            node = node->left;
+        }
+        else
+        {
+            node = node->right;
+        }
+    }
+    return acc;
+}
+
+/*
+ * key < hi 인 노드들의 합 (aggregate_from의 대칭)
+ */
+static agg_t aggregate_until(const rbtree* tree, node_t* node, key_t hi)
+{
+    const rbtree_monoid_t* m = (const rbtree_monoid_t*)tree->aux;
+    agg_t acc = m->identity;
+
+    while (node != tree->nil)
+    {
+        if (node->key < hi)
+        {
+            agg_t part = m->combine(agg_of(tree, node->left), m->value(node->key));
+            acc = m->combine(acc, part);
+            node = node->right;
+        }
+        else
+        {
+            node = node->left;
+        }
+    }
+    return acc;
+}
+
+/*
+ * key가 [lo, hi)인 노드들을 key 순서로 combine, O(log n)
+ * 범위 안에 처음 들어오는 노드(split)에서 갈라져 양쪽 경계를 따라 한 번씩만 내려감
+ */
+agg_t rbtree_aggregate(const rbtree* tree, const key_t lo, const key_t hi)
+{
+    const rbtree_monoid_t* m = (const rbtree_monoid_t*)tree->aux;
+    node_t* split = tree->root;
+
+    if (lo >= hi) return m->identity;
+
+    while (split != tree->nil)
+    {
+        if (split->key < lo)
+        {
+            split = split->right;
+        }
+        else if (split->key >= hi)
+        {
+            split = split->left;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (split == tree->nil) return m->identity;
+
+    agg_t agg = m->combine(aggregate_from(tree, split->left, lo), m->value(split->key));
+    return m->combine(agg, aggregate_until(tree, split->right, hi));
+}
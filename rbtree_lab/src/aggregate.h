@@ -0,0 +1,29 @@
+#ifndef _AGGREGATE_H_
+#define _AGGREGATE_H_
+
+#include "rbtree.h"
+
+typedef long long agg_t;
+
+// 트리마다 하나 등록하는 monoid: combine은 결합법칙만 만족하면 됨 (교환법칙 불필요)
+typedef struct {
+  agg_t identity;
+  agg_t (*combine)(agg_t, agg_t);
+  agg_t (*value)(key_t);  // 노드 하나의 값
+} rbtree_monoid_t;
+
+typedef struct {
+  node_t node;
+  agg_t agg;  // 서브트리 전체를 key 순서로 combine한 값
+} agg_node_t;
+
+extern const rbtree_monoid_t rbtree_monoid_sum;
+extern const rbtree_monoid_t rbtree_monoid_count;
+extern const rbtree_monoid_t rbtree_monoid_min;
+extern const rbtree_monoid_t rbtree_monoid_max;
+
+rbtree *new_rbtree_aggregate(const rbtree_monoid_t *);
+
+agg_t rbtree_aggregate(const rbtree *, const key_t lo, const key_t hi);
+
+#endif  // _AGGREGATE_H_
@@ -0,0 +1,123 @@
+#include "bst.h"
+
+
+/*
+ * rbtree.h 핵심 API를 AVL 트리로 구현한 비교용 backend (librbtree-avl.a)
+ * 노드 뒤에 서브트리 높이를 붙이고, 좌우 높이 차가 1을 넘으면 회전
+ * color는 쓰지 않음 (확장 기능은 red-black 구현에만 있음)
+ */
+
+typedef struct {
+    node_t node;
+    int height;  // nil = 0, 리프 = 1
+} avl_node_t;
+
+#define HEIGHT(x) ((x) == tree->nil ? 0 : ((avl_node_t*)(x))->height)
+
+BST_DEFINE_COMMON_API
+
+rbtree* new_rbtree(void)
+{
+    return bst_new(sizeof(avl_node_t));
+}
+
+static void update_height(rbtree* tree, node_t* x)
+{
+    int l = HEIGHT(x->left);
+    int r = HEIGHT(x->right);
+    ((avl_node_t*)x)->height = 1 + (l > r ? l : r);
+}
+
+/*
+ * node부터 루트까지 높이를 다시 계산하며 한쪽이 2 높아진 곳을 회전
+ * 안쪽 손자가 더 높으면 이중 회전
+ */
+static void rebalance(rbtree* tree, node_t* node)
+{
+    while (node != tree->nil)
+    {
+        update_height(tree, node);
+        int balance = HEIGHT(node->left) - HEIGHT(node->right);
+
+        if (balance > 1)
+        {
+            if (HEIGHT(node->left->left) < HEIGHT(node->left->right))
+            {
+                bst_left_rotate(tree, node->left, update_height);
+            }
+            bst_right_rotate(tree, node, update_height);
+            node = node->parent;  // 회전으로 올라온 노드
+        }
+        else if (balance < -1)
+        {
+            if (HEIGHT(node->right->right) < HEIGHT(node->right->left))
+            {
+                bst_right_rotate(tree, node->right, update_height);
+            }
+            bst_left_rotate(tree, node, update_height);
+            node = node->parent;
+        }
+        node = node->parent;
+    }
+}
+
+node_t* rbtree_insert(rbtree* tree, const key_t key)
+{
+    avl_node_t* node = (avl_node_t*)calloc(1, sizeof(avl_node_t));
+    if (!node) return NULL;
+
+    node->node.key = key;
+    node->height = 1;
+    bst_link_leaf(tree, &node->node);
+    rebalance(tree, node->node.parent);
+    return &node->node;
+}
+
+/*
+ * 석세서를 node 자리에 옮겨 붙이고(key 복사 없음) 구조가 바뀐 가장 낮은 곳부터 재조정
+ */
+int rbtree_erase(rbtree* tree, node_t* node)
+{
+    if (!tree || node == tree->nil) return 0;
+
+    node_t* start;
+    if (node->left == tree->nil || node->right == tree->nil)
+    {
+        node_t* child = (node->left != tree->nil) ? node->left : node->right;
+        if (child != tree->nil)
+        {
+            child->parent = node->parent;
+        }
+        bst_replace_child(tree, node->parent, node, child);
+        start = node->parent;
+    }
+    else
+    {
+        node_t* y = bst_min(tree, node->right);
+        if (y->parent != node)
+        {
+            start = y->parent;
+            start->left = y->right;
+            if (y->right != tree->nil)
+            {
+                y->right->parent = start;
+            }
+            y->right = node->right;
+            y->right->parent = y;
+        }
+        else
+        {
+            start = y;
+        }
+
+        y->parent = node->parent;
+        bst_replace_child(tree, node->parent, node, y);
+        y->left = node->left;
+        y->left->parent = y;
+    }
+
+    tree->size--;
+    free(node);
+    rebalance(tree, start);
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "rbtree.hpp"
+
+/*
+ * rb::multiset 와 std::multiset 비교
+ * ./bench_multiset [n]
+ * 같은 key 순서로 insert / find / 순회(std::accumulate) / 반복자 erase 시간을 잼
+ */
+
+using bench_clock = std::chrono::steady_clock;
+
+static double ns_per(bench_clock::time_point t0, bench_clock::time_point t1, std::size_t n) {
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / n;
+}
+
+template <class Set>
+static void run(const char *name, Set &set, const std::vector<int> &keys) {
+  const std::size_t n = keys.size();
+
+  auto t0 = bench_clock::now();
+  for (int k : keys) set.emplace(k);
+  auto t1 = bench_clock::now();
+
+  std::size_t hits = 0;
+  for (int k : keys) hits += set.find(k) != set.end();
+  auto t2 = bench_clock::now();
+
+  long long sum = std::accumulate(set.begin(), set.end(), 0LL);
+  auto t3 = bench_clock::now();
+
+  for (auto it = set.begin(); it != set.end();) it = set.erase(it);
+  auto t4 = bench_clock::now();
+
+  std::printf("  %-26s insert %6.1f  find %6.1f  iterate %5.1f  erase %6.1f ns/op  (hits=%zu sum=%lld)\n", name,
+              ns_per(t0, t1, n), ns_per(t1, t2, n), ns_per(t2, t3, n), ns_per(t3, t4, n), hits, sum);
+}
+
+int main(int argc, char *argv[]) {
+  std::size_t n = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  std::mt19937 rng(7);
+  std::vector<int> keys(n);
+  for (auto &k : keys) k = static_cast<int>(rng() & 0x7fffffff);
+
+  std::printf("n=%zu\n", n);
+  {
+    std::multiset<int> set;
+    run("std::multiset", set, keys);
+  }
+  {
+    rb::multiset set;
+    run("rb::multiset", set, keys);
+  }
+  {
+    std::pmr::unsynchronized_pool_resource pool;
+    std::pmr::multiset<int> set(&pool);
+    run("std::pmr::multiset (pool)", set, keys);
+  }
+  {
+    std::pmr::unsynchronized_pool_resource pool;
+    rb::multiset set(&pool);
+    run("rb::multiset (pool)", set, keys);
+  }
+  return 0;
+}
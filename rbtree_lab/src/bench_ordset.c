@@ -0,0 +1,137 @@
+#include "rbtree.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * rbtree.h 핵심 API만 쓰는 벤치마크, backend 라이브러리만 바꿔 링크해서 같은 워크로드를 비교
+ * ./bench_ordset-<backend> [n]
+ */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 결과를 쓰지 않는 루프가 최적화로 사라지지 않도록
+static volatile unsigned long sink;
+
+static unsigned int rng_state = 2463534242u;
+
+static unsigned int next_rand(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// key 분포
+static key_t key_uniform(size_t i) { (void)i; return (key_t)(next_rand() & 0x7fffffff); }
+static key_t key_sequential(size_t i) { return (key_t)i; }
+// 1024개의 좁은 구간에 몰린 key
+static key_t key_clustered(size_t i) { (void)i; return (key_t)((next_rand() % 1024) << 20 | (next_rand() & 0xfff)); }
+static key_t key_duplicates(size_t i) { (void)i; return (key_t)(next_rand() % 1024); }
+
+static const struct {
+    const char* name;
+    key_t (*make)(size_t i);
+} dists[] = {
+    { "uniform", key_uniform },
+    { "sequential", key_sequential },
+    { "clustered", key_clustered },
+    { "duplicates", key_duplicates },
+};
+
+static void run(const char* dist, key_t (*make)(size_t), size_t n)
+{
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(n * sizeof(key_t));
+    key_t* arr = (key_t*)malloc(n * sizeof(key_t));
+    node_t** found = (node_t**)malloc(n * sizeof(node_t*));
+    for (size_t i = 0; i < n; ++i)
+    {
+        keys[i] = make(i);
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        probes[i] = keys[next_rand() % n];
+    }
+
+    rbtree* tree = new_rbtree();
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_insert(tree, keys[i]);
+    }
+    double t1 = now_sec();
+
+    size_t hits = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        found[i] = rbtree_find(tree, probes[i]);
+        hits += found[i] != NULL;
+    }
+    double t2 = now_sec();
+
+    // 없는 key: 음수는 넣은 적이 없음
+    for (size_t i = 0; i < n; ++i)
+    {
+        hits += rbtree_find(tree, -1 - probes[i]) != NULL;
+    }
+    double t3 = now_sec();
+
+    // 찾은 노드에서 앞뒤 이웃 (끝이면 nil)
+    unsigned long sum = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        sum += (unsigned long)rbtree_next(tree, found[i])->key + (unsigned long)rbtree_prev(tree, found[i])->key;
+    }
+    sink = sum;
+    double t4 = now_sec();
+
+    rbtree_to_array(tree, arr, n);
+    double t5 = now_sec();
+
+    // 지우고 다시 넣는 churn
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_erase(tree, rbtree_find(tree, probes[i]));
+        rbtree_insert(tree, probes[i]);
+    }
+    double t6 = now_sec();
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_erase(tree, rbtree_find(tree, keys[i]));
+    }
+    double t7 = now_sec();
+
+    printf("%-11s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f%s\n", dist, (t1 - t0) * 1e9 / n, (t2 - t1) * 1e9 / n,
+           (t3 - t2) * 1e9 / n, (t4 - t3) * 1e9 / n, (t5 - t4) * 1e9 / n, (t6 - t5) * 1e9 / n, (t7 - t6) * 1e9 / n,
+           (hits != n || rbtree_min(tree) != tree->nil) ? "  (mismatch)" : "");
+
+    delete_rbtree(tree);
+    free(found);
+    free(arr);
+    free(probes);
+    free(keys);
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 1000000;
+    const char* backend = strrchr(argv[0], '-');
+
+    printf("[%s] n=%zu, ns/op\n", backend ? backend + 1 : argv[0], n);
+    printf("%-11s %9s %9s %9s %9s %9s %9s %9s\n", "keys", "insert", "find-hit", "find-miss", "next/prev", "to_array",
+           "churn", "erase");
+    for (size_t d = 0; d < sizeof(dists) / sizeof(dists[0]); ++d)
+    {
+        run(dists[d].name, dists[d].make, n);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "bloom.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+#define BLOOM_LINE 64
+#define BLOOM_KEYS_PER_BLOCK 32  // key당 16~32비트 -> 오탐 0.1~1%
+#define BLOOM_MIN_BLOCKS 16
+
+// 워드마다 다른 홀수를 곱해서 상위 6비트를 비트 위치로 씀
+static const uint32_t bloom_salt[BLOOM_BLOCK_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+static inline uint64_t bloom_hash(key_t key)
+{
+    // murmur3 finalizer
+    uint64_t h = (uint64_t)(uint32_t)key;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+static size_t bloom_blocks_for(size_t expected)
+{
+    size_t blocks = BLOOM_MIN_BLOCKS;
+    while (blocks * BLOOM_KEYS_PER_BLOCK < expected)
+    {
+        blocks <<= 1;
+    }
+    return blocks;
+}
+
+bloom_filter* bloom_new(size_t expected)
+{
+    bloom_filter* bf = (bloom_filter*)calloc(1, sizeof(bloom_filter));
+    if (!bf) return NULL;
+
+    if (bloom_reset(bf, expected) != 0)
+    {
+        free(bf);
+        return NULL;
+    }
+    return bf;
+}
+
+void bloom_free(bloom_filter* bf)
+{
+    if (!bf) return;
+
+    free(bf->blocks);
+    free(bf);
+}
+
+int bloom_reset(bloom_filter* bf, size_t expected)
+{
+    size_t blocks = bloom_blocks_for(expected);
+    size_t bytes = blocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+
+    if (!bf->blocks || blocks != bf->mask + 1)
+    {
+        uint64_t* mem = (uint64_t*)aligned_alloc(BLOOM_LINE, bytes);
+        if (!mem) return -1;
+
+        free(bf->blocks);
+        bf->blocks = mem;
+        bf->mask = blocks - 1;
+    }
+    memset(bf->blocks, 0, bytes);
+    bf->capacity = blocks * BLOOM_KEYS_PER_BLOCK;
+    bf->count = 0;
+    bf->stale = 0;
+    return 0;
+}
+
+void bloom_add(bloom_filter* bf, const key_t key)
+{
+    uint64_t h = bloom_hash(key);
+    uint64_t* block = bf->blocks + ((h >> 32) & bf->mask) * BLOOM_BLOCK_WORDS;
+    uint32_t lo = (uint32_t)h;
+
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; ++i)
+    {
+        block[i] |= 1ull << ((lo * bloom_salt[i]) >> 26);
+    }
+    bf->count++;
+}
+
+int bloom_maybe(const bloom_filter* bf, const key_t key)
+{
+    uint64_t h = bloom_hash(key);
+    const uint64_t* block = bf->blocks + ((h >> 32) & bf->mask) * BLOOM_BLOCK_WORDS;
+    uint32_t lo = (uint32_t)h;
+
+    // 분기 없이 8개를 모두 보고 합침 (한 캐시 라인 안이라 추가 미스 없음)
+    uint64_t miss = 0;
+    for (int i = 0; i < BLOOM_BLOCK_WORDS; ++i)
+    {
+        miss |= ~block[i] & (1ull << ((lo * bloom_salt[i]) >> 26));
+    }
+    return miss == 0;
+}
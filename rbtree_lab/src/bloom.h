@@ -0,0 +1,31 @@
+#ifndef _BLOOM_H_
+#define _BLOOM_H_
+
+#include "rbtree.h"
+
+#include <stdint.h>
+
+// rbtree.c 내부용: 없는 key를 걸러내는 blocked Bloom filter
+// key마다 64바이트 블록 하나만 보고, 블록의 8개 워드에서 한 비트씩 확인 (split block)
+// 지우기는 못 하므로 지운 수(stale)를 세어 두고 많아지면 트리에서 다시 만듦
+
+#define BLOOM_BLOCK_WORDS 8
+
+typedef struct bloom_filter {
+  uint64_t *blocks;  // 블록 수 * BLOOM_BLOCK_WORDS, 캐시 라인 정렬
+  size_t mask;       // 블록 수 - 1 (2의 거듭제곱)
+  size_t capacity;   // 이보다 많이 넣으면 오탐이 늘어서 키워야 함
+  size_t count;      // 다시 만든 뒤로 넣은 key 수
+  size_t stale;      // 다시 만든 뒤로 지운 key 수
+} bloom_filter;
+
+bloom_filter *bloom_new(size_t expected);
+void bloom_free(bloom_filter *);
+// expected개 크기로 비움 (블록 수가 같으면 그대로 씀), 할당 실패면 -1
+int bloom_reset(bloom_filter *, size_t expected);
+
+void bloom_add(bloom_filter *, const key_t);
+// 0이면 확실히 없음
+int bloom_maybe(const bloom_filter *, const key_t);
+
+#endif  // _BLOOM_H_
@@ -0,0 +1,193 @@
+#ifndef _BST_H_
+#define _BST_H_
+
+#include "rbtree.h"
+#include <stdlib.h>
+
+// 비교용 backend(avltree.c, treap.c) 내부용: sentinel nil을 쓰는 이진 탐색 트리 공통 연산
+// 균형 정보는 backend마다 node_t 뒤에 붙이고 회전 뒤에는 fix 훅으로 다시 계산
+
+typedef void (*bst_fix_t)(rbtree *, node_t *);
+
+static inline rbtree *bst_new(size_t node_size)
+{
+  rbtree *tree = (rbtree *)calloc(1, sizeof(rbtree));
+  node_t *nil = (node_t *)calloc(1, node_size);
+  if (!tree || !nil) {
+    free(tree);
+    free(nil);
+    return NULL;
+  }
+
+  nil->color = RBTREE_BLACK;
+  nil->left = nil;
+  nil->right = nil;
+  nil->parent = nil;
+
+  tree->nil = nil;
+  tree->root = nil;
+  tree->spare = nil;
+  tree->node_size = node_size;
+  return tree;
+}
+
+// 왼쪽 자식을 오른쪽으로 돌려 펴면서 해제 (재귀 없음)
+static inline void bst_delete(rbtree *tree)
+{
+  if (!tree) return;
+
+  node_t *node = tree->root;
+  while (node != tree->nil) {
+    node_t *left = node->left;
+    if (left != tree->nil) {
+      node->left = left->right;
+      left->right = node;
+      node = left;
+      continue;
+    }
+    node_t *next = node->right;
+    free(node);
+    node = next;
+  }
+  free(tree->nil);
+  free(tree);
+}
+
+static inline void bst_replace_child(rbtree *tree, node_t *parent, node_t *old, node_t *node)
+{
+  if (parent == tree->nil) {
+    tree->root = node;
+  } else if (parent->left == old) {
+    parent->left = node;
+  } else {
+    parent->right = node;
+  }
+}
+
+// 아래로 내려간 x, 올라온 y 순서로 fix
+static inline void bst_left_rotate(rbtree *tree, node_t *x, bst_fix_t fix)
+{
+  node_t *y = x->right;
+
+  x->right = y->left;
+  if (y->left != tree->nil) y->left->parent = x;
+  y->parent = x->parent;
+  bst_replace_child(tree, x->parent, x, y);
+  y->left = x;
+  x->parent = y;
+
+  if (fix) {
+    fix(tree, x);
+    fix(tree, y);
+  }
+}
+
+static inline void bst_right_rotate(rbtree *tree, node_t *y, bst_fix_t fix)
+{
+  node_t *x = y->left;
+
+  y->left = x->right;
+  if (x->right != tree->nil) x->right->parent = y;
+  x->parent = y->parent;
+  bst_replace_child(tree, y->parent, y, x);
+  x->right = y;
+  y->parent = x;
+
+  if (fix) {
+    fix(tree, y);
+    fix(tree, x);
+  }
+}
+
+// 같은 key는 오른쪽으로 가는 잎 자리에 연결
+static inline void bst_link_leaf(rbtree *tree, node_t *node)
+{
+  node_t *y = tree->nil;
+  node_t *x = tree->root;
+  while (x != tree->nil) {
+    y = x;
+    x = (node->key < x->key) ? x->left : x->right;
+  }
+
+  node->parent = y;
+  node->left = tree->nil;
+  node->right = tree->nil;
+  if (y == tree->nil) {
+    tree->root = node;
+  } else if (node->key < y->key) {
+    y->left = node;
+  } else {
+    y->right = node;
+  }
+  tree->size++;
+}
+
+static inline node_t *bst_find(const rbtree *tree, const key_t key)
+{
+  node_t *x = tree->root;
+  while (x != tree->nil) {
+    if (key == x->key) return x;
+    x = (key < x->key) ? x->left : x->right;
+  }
+  return NULL;
+}
+
+static inline node_t *bst_min(const rbtree *tree, node_t *x)
+{
+  if (x == tree->nil) return x;
+  while (x->left != tree->nil) x = x->left;
+  return x;
+}
+
+static inline node_t *bst_max(const rbtree *tree, node_t *x)
+{
+  if (x == tree->nil) return x;
+  while (x->right != tree->nil) x = x->right;
+  return x;
+}
+
+static inline node_t *bst_next(const rbtree *tree, const node_t *node)
+{
+  if (node->right != tree->nil) return bst_min(tree, node->right);
+
+  node_t *p = node->parent;
+  while (p != tree->nil && node == p->right) {
+    node = p;
+    p = p->parent;
+  }
+  return p;
+}
+
+static inline node_t *bst_prev(const rbtree *tree, const node_t *node)
+{
+  if (node == tree->nil) return bst_max(tree, tree->root);
+  if (node->left != tree->nil) return bst_max(tree, node->left);
+
+  node_t *p = node->parent;
+  while (p != tree->nil && node == p->left) {
+    node = p;
+    p = p->parent;
+  }
+  return p;
+}
+
+static inline int bst_to_array(const rbtree *tree, key_t *arr, const size_t n)
+{
+  size_t i = 0;
+  for (node_t *x = bst_min(tree, tree->root); x != tree->nil && i < n; x = bst_next(tree, x)) {
+    arr[i++] = x->key;
+  }
+  return (int)i;
+}
+
+// rbtree.h의 공통 함수들을 bst_* 로 정의 (backend 파일에서 한 번 펼침)
+#define BST_DEFINE_COMMON_API                                                                      \
+  node_t *rbtree_find(const rbtree *tree, const key_t key) { return bst_find(tree, key); }        \
+  node_t *rbtree_min(const rbtree *tree) { return bst_min(tree, tree->root); }                     \
+  node_t *rbtree_max(const rbtree *tree) { return bst_max(tree, tree->root); }                     \
+  node_t *rbtree_next(const rbtree *tree, const node_t *node) { return bst_next(tree, node); }    \
+  node_t *rbtree_prev(const rbtree *tree, const node_t *node) { return bst_prev(tree, node); }    \
+  int rbtree_to_array(const rbtree *tree, key_t *arr, const size_t n) { return bst_to_array(tree, arr, n); } \
+  void delete_rbtree(rbtree *tree) { bst_delete(tree); }
+
+#endif  // _BST_H_
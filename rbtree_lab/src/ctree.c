@@ -0,0 +1,915 @@
+#include "ctree.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define CT_LINE 64          // 캐시 라인 크기, 자주 바뀌는 값끼리 같은 줄을 쓰지 않도록
+#define CT_SPINS 64         // 이만큼 돌고도 락이 안 풀리면 CPU를 양보
+#define CT_POOLS 16         // 떼어 낸 노드 목록 수 (key로 나눠서 서로 덜 부딪힘)
+
+typedef struct {
+  node_t node;
+  atomic_int lock;
+  unsigned int count;    // 같은 key 수, 0이면 dead (지운 스레드가 곧 떼어 냄)
+  unsigned int deficit;  // 이 노드 아래 경로마다 모자란 검정 수 (검정 노드만, 0이 아니면 누가 위로 갚는 중)
+} cnode_t;
+
+// 떼어 낸 노드는 free하지 않고 다시 씀: 락 없이 parent를 읽는 스레드가 아직 가리키고 있을 수 있음
+typedef struct {
+  _Alignas(CT_LINE) atomic_int lock;
+  node_t *head;  // right로 이어짐
+} ct_pool_t;
+
+struct ctree {
+  _Alignas(CT_LINE) atomic_int root_lock;  // tree->root를 지킴 (루트의 부모 노드 락 역할)
+  _Alignas(CT_LINE) atomic_size_t nodes;   // 연결된 노드 수
+  ct_pool_t pools[CT_POOLS];
+  rbtree *tree;
+};
+
+// FIX_HELP: *next의 빨강-빨강 위반부터, FIX_HELP_BLACK: *next의 deficit부터 풀고 다시
+enum { FIX_DONE, FIX_UP, FIX_HELP, FIX_HELP_BLACK, FIX_AGAIN };
+
+static inline void cpu_relax(unsigned int spins)
+{
+    if (spins < CT_SPINS)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    else
+    {
+        sched_yield();
+    }
+}
+
+static void spin_lock(atomic_int* lock)
+{
+    for (unsigned int spins = 0; atomic_exchange_explicit(lock, 1, memory_order_acquire);)
+    {
+        while (atomic_load_explicit(lock, memory_order_relaxed))
+        {
+            cpu_relax(spins++);
+        }
+    }
+}
+
+static inline void spin_unlock(atomic_int* lock)
+{
+    atomic_store_explicit(lock, 0, memory_order_release);
+}
+
+static inline atomic_int* node_lock(node_t* x)
+{
+    return &((cnode_t*)x)->lock;
+}
+
+/*
+ * parent는 락 없이 읽어서 잡을 노드를 고르는 데 쓰므로 원자적으로 읽고 씀
+ * (left/right/색은 그 노드를 잡은 스레드만 읽고 씀), 트리에서 떼어 낸 노드는 NULL
+ */
+static inline node_t* get_parent(const node_t* x)
+{
+    return __atomic_load_n(&x->parent, __ATOMIC_ACQUIRE);
+}
+
+static inline void set_parent(node_t* x, node_t* parent)
+{
+    __atomic_store_n(&x->parent, parent, __ATOMIC_RELEASE);
+}
+
+static inline cnode_t* cnode(node_t* x)
+{
+    return (cnode_t*)x;
+}
+
+static inline node_t** child_ref(node_t* x, int left)
+{
+    return left ? &x->left : &x->right;
+}
+
+ctree* new_ctree(void)
+{
+    ctree* ct = (ctree*)aligned_alloc(CT_LINE, sizeof(ctree));
+    if (!ct) return NULL;
+
+    memset(ct, 0, sizeof(ctree));
+    // 할당자/compact를 쓰지 않으므로 노드는 calloc으로 만들고 delete_rbtree가 free
+    ct->tree = new_rbtree_augmented(sizeof(cnode_t), NULL);
+    if (!ct->tree)
+    {
+        free(ct);
+        return NULL;
+    }
+    return ct;
+}
+
+void delete_ctree(ctree* ct)
+{
+    if (!ct) return;
+
+    for (int i = 0; i < CT_POOLS; ++i)
+    {
+        while (ct->pools[i].head)
+        {
+            node_t* next = ct->pools[i].head->right;
+            free(ct->pools[i].head);
+            ct->pools[i].head = next;
+        }
+    }
+    delete_rbtree(ct->tree);
+    free(ct);
+}
+
+rbtree* ctree_tree(ctree* ct)
+{
+    // 연산이 다 끝났으면 dead 노드는 모두 떼어져 있음
+    ct->tree->size = atomic_load_explicit(&ct->nodes, memory_order_relaxed);
+    ct->tree->dead_count = 0;
+    return ct->tree;
+}
+
+static inline ct_pool_t* pool_of(ctree* ct, const key_t key)
+{
+    return &ct->pools[(((unsigned int)key * 2654435761u) >> 16) % CT_POOLS];
+}
+
+/*
+ * 새 빨간 노드 (parent는 연결할 때 정함)
+ * 목록에서 꺼낸 노드는 옛 포인터로 잠깐 잡는 스레드가 있을 수 있어서 lock은 건드리지 않음
+ */
+static node_t* node_new(ctree* ct, const key_t key)
+{
+    ct_pool_t* pool = pool_of(ct, key);
+    spin_lock(&pool->lock);
+    node_t* node = pool->head;
+    if (node) pool->head = node->right;
+    spin_unlock(&pool->lock);
+    if (!node)
+    {
+        node = (node_t*)calloc(1, sizeof(cnode_t));
+        if (!node) return NULL;
+    }
+
+    node->key = key;
+    node->color = RBTREE_RED;
+    node->dead = 0;
+    node->left = ct->tree->nil;
+    node->right = ct->tree->nil;
+    cnode(node)->count = 1;
+    cnode(node)->deficit = 0;
+    return node;
+}
+
+// parent가 NULL인 노드를 목록에 넣음, 락을 다 놓은 뒤 부름
+static void node_put(ctree* ct, node_t* x)
+{
+    ct_pool_t* pool = pool_of(ct, x->key);
+    spin_lock(&pool->lock);
+    x->right = pool->head;
+    pool->head = x;
+    spin_unlock(&pool->lock);
+}
+
+/*
+ * key 자리까지 hand-over-hand로 내려감: 자식을 잡은 뒤에 부모를 놓으므로 회전이 지나가도 길을 잃지 않음
+ * key 노드가 있으면 그 노드를, 없으면 key가 붙을 부모를 잠근 채 반환
+ * 빈 트리면 root_lock을 잡은 채 nil
+ */
+static node_t* descend(ctree* ct, const key_t key)
+{
+    rbtree* tree = ct->tree;
+    spin_lock(&ct->root_lock);
+    node_t* x = tree->root;
+    if (x == tree->nil) return x;
+
+    spin_lock(node_lock(x));
+    spin_unlock(&ct->root_lock);
+    for (;;)
+    {
+        if (key == x->key) return x;
+
+        node_t* next = key < x->key ? x->left : x->right;
+        if (next == tree->nil) return x;
+
+        spin_lock(node_lock(next));
+        spin_unlock(node_lock(x));
+        x = next;
+    }
+}
+
+static void unlock_found(ctree* ct, node_t* x)
+{
+    spin_unlock(x == ct->tree->nil ? &ct->root_lock : node_lock(x));
+}
+
+// g 자리(부모 t, 루트면 nil)에 node를 올림
+static void replace_child(ctree* ct, node_t* t, node_t* g, node_t* node)
+{
+    if (t == ct->tree->nil)
+    {
+        ct->tree->root = node;
+    }
+    else
+    {
+        *child_ref(t, t->left == g) = node;
+    }
+    set_parent(node, t);
+}
+
+static void lock_child(const rbtree* tree, node_t* x)
+{
+    if (x != tree->nil) spin_lock(node_lock(x));
+}
+
+static void unlock_child(const rbtree* tree, node_t* x)
+{
+    if (x != tree->nil) spin_unlock(node_lock(x));
+}
+
+static void move_child(const rbtree* tree, node_t* parent, int left, node_t* child)
+{
+    *child_ref(parent, left) = child;
+    if (child != tree->nil) set_parent(child, parent);
+}
+
+/*
+ * 빨간 x와 빨간 부모 p 사이의 위반을 insert_fixup의 한 경우만큼 처리
+ * 증조부모 t(g가 루트면 root_lock), 조부모 g, p, x 순으로 위에서부터 잡고, 잡을 때마다 부모 관계가 그대로인지 확인
+ * (노드의 parent는 그 노드나 부모를 잡아야 바뀌므로 부모를 잡은 채 확인한 관계는 놓을 때까지 유지됨)
+ * 삼촌과 회전으로 부모가 바뀌는 자식은 그다음에 잡음
+ * 모든 스레드가 잡은 노드의 자식만 기다리므로 교착이 없음
+ * FIX_UP: 위반이 *next로 올라감, FIX_HELP: 조부모도 빨강이라 *next(p)의 위반부터 풀어야 함
+ * FIX_HELP_BLACK: g가 deficit을 갚는 중이라 그것부터 (g의 색이나 자리를 바꾸면 deficit이 맞지 않음)
+ */
+static int fix_step(ctree* ct, node_t* x, node_t** next)
+{
+    rbtree* tree = ct->tree;
+    node_t* nil = tree->nil;
+    node_t *p, *g, *t;
+    atomic_int* top;
+    for (;;)
+    {
+        p = get_parent(x);
+        if (p == nil || !p) return FIX_DONE;  // 루트는 언제나 검정, NULL이면 x가 이미 떼어짐
+
+        g = get_parent(p);
+        if (!g) continue;
+        if (g == nil)
+        {
+            // p가 루트(검정)인지만 확인
+            spin_lock(&ct->root_lock);
+            int root = tree->root == p;
+            if (root) spin_lock(node_lock(p));
+            spin_unlock(&ct->root_lock);
+            if (!root) continue;
+
+            int child = get_parent(x) == p;
+            spin_unlock(node_lock(p));
+            if (child) return FIX_DONE;
+            continue;
+        }
+
+        t = get_parent(g);
+        if (!t) continue;
+        top = t == nil ? &ct->root_lock : node_lock(t);
+        spin_lock(top);
+        if ((t == nil) ? tree->root != g : get_parent(g) != t)
+        {
+            spin_unlock(top);
+            continue;
+        }
+        spin_lock(node_lock(g));
+        if (get_parent(p) != g)
+        {
+            spin_unlock(node_lock(g));
+            spin_unlock(top);
+            continue;
+        }
+        spin_lock(node_lock(p));
+        if (get_parent(x) != p)
+        {
+            spin_unlock(node_lock(p));
+            spin_unlock(node_lock(g));
+            spin_unlock(top);
+            continue;
+        }
+        spin_lock(node_lock(x));
+        break;
+    }
+
+    int result = FIX_DONE;
+    if (x->color == RBTREE_RED && p->color == RBTREE_RED)
+    {
+        if (g->color == RBTREE_RED)
+        {
+            *next = p;
+            result = FIX_HELP;
+        }
+        else if (cnode(g)->deficit > 0)
+        {
+            *next = g;
+            result = FIX_HELP_BLACK;
+        }
+        else
+        {
+            int left = p == g->left;
+            node_t* u = *child_ref(g, !left);
+            lock_child(tree, u);
+            if (u->color == RBTREE_RED)
+            {
+                // case 1: 색만 바꿔서 위반을 g로 올림 (g가 루트면 검정 그대로 두면 끝)
+                p->color = RBTREE_BLACK;
+                u->color = RBTREE_BLACK;
+                if (t != nil)
+                {
+                    g->color = RBTREE_RED;
+                    *next = g;
+                    result = FIX_UP;
+                }
+            }
+            else if ((x == p->left) == left)
+            {
+                // case 3: g에서 한 번 회전, p의 안쪽 자식 c가 g로 옮겨 감
+                //        [g]            [p]
+                //     [p]   [u]  ->  [x]   [g]
+                //   [x] [c]              [c] [u]
+                node_t* c = *child_ref(p, !left);
+                lock_child(tree, c);
+                move_child(tree, g, left, c);
+                move_child(tree, p, !left, g);
+                replace_child(ct, t, g, p);
+                p->color = RBTREE_BLACK;
+                g->color = RBTREE_RED;
+                unlock_child(tree, c);
+            }
+            else
+            {
+                // case 2 + 3: x가 두 번 회전해서 올라감, x의 두 자식 a, b가 p와 g로 나뉨
+                //        [g]              [x]
+                //     [p]   [u]  ->   [p]     [g]
+                //       [x]             [a] [b]  [u]
+                //     [a] [b]
+                node_t* a = *child_ref(x, left);
+                node_t* b = *child_ref(x, !left);
+                lock_child(tree, a);
+                lock_child(tree, b);
+                move_child(tree, p, !left, a);
+                move_child(tree, g, left, b);
+                move_child(tree, x, left, p);
+                move_child(tree, x, !left, g);
+                replace_child(ct, t, g, x);
+                x->color = RBTREE_BLACK;
+                g->color = RBTREE_RED;
+                unlock_child(tree, b);
+                unlock_child(tree, a);
+            }
+            unlock_child(tree, u);
+        }
+    }
+
+    spin_unlock(node_lock(x));
+    spin_unlock(node_lock(p));
+    spin_unlock(node_lock(g));
+    spin_unlock(top);
+    return result;
+}
+
+static void fix_black(ctree* ct, node_t* x);
+
+/*
+ * x에서 시작한 위반을 없어질 때까지 한 단계씩 위로 처리
+ * 단계 사이에는 락이 없어서 다른 스레드가 끼어들 수 있고, 그래서 매 단계 이웃을 다시 확인함
+ */
+static void fix_red(ctree* ct, node_t* x)
+{
+    for (node_t* next;;)
+    {
+        int result = fix_step(ct, x, &next);
+        if (result == FIX_DONE) return;
+
+        if (result == FIX_UP)
+        {
+            x = next;
+        }
+        else if (result == FIX_HELP)
+        {
+            // 위쪽 위반(다른 스레드의 것일 수도)을 먼저 풀고 x를 다시 봄
+            fix_red(ct, next);
+        }
+        else
+        {
+            fix_black(ct, next);
+        }
+    }
+}
+
+/*
+ * x, 부모 p, 그 위(p의 부모 t의 락, p가 루트면 root_lock)를 위에서부터 잡고 관계를 확인
+ * x가 루트면 p는 nil이고 root_lock과 x만 잡음, x가 이미 떼어졌으면 아무것도 잡지 않고 0
+ */
+static int lock_node(ctree* ct, node_t* x, node_t** pp, node_t** tp, atomic_int** top)
+{
+    rbtree* tree = ct->tree;
+    node_t* nil = tree->nil;
+    for (;;)
+    {
+        node_t* p = get_parent(x);
+        if (!p) return 0;
+
+        if (p == nil)
+        {
+            spin_lock(&ct->root_lock);
+            if (tree->root == x)
+            {
+                spin_lock(node_lock(x));
+                *pp = nil;
+                *tp = nil;
+                *top = &ct->root_lock;
+                return 1;
+            }
+            spin_unlock(&ct->root_lock);
+            continue;
+        }
+
+        node_t* t = get_parent(p);
+        if (!t) continue;
+
+        atomic_int* lock = t == nil ? &ct->root_lock : node_lock(t);
+        spin_lock(lock);
+        if ((t == nil) ? tree->root != p : get_parent(p) != t)
+        {
+            spin_unlock(lock);
+            continue;
+        }
+        spin_lock(node_lock(p));
+        if (get_parent(x) != p)
+        {
+            spin_unlock(node_lock(p));
+            spin_unlock(lock);
+            continue;
+        }
+        spin_lock(node_lock(x));
+        *pp = p;
+        *tp = t;
+        *top = lock;
+        return 1;
+    }
+}
+
+static void unlock_node(ctree* ct, atomic_int* top, node_t* p, node_t* x)
+{
+    spin_unlock(node_lock(x));
+    if (p != ct->tree->nil) spin_unlock(node_lock(p));
+    spin_unlock(top);
+}
+
+/*
+ * x 쪽이 갚고 나서 p 아래 전체가 검정 하나 모자라게 됨: p가 빨강이면 검정으로 끝, 루트면 그냥 끝
+ * 아니면 p의 deficit으로 올림 (FIX_UP)
+ */
+static int push_up(const rbtree* tree, node_t* t, node_t* p, node_t** next)
+{
+    if (p->color == RBTREE_RED)
+    {
+        p->color = RBTREE_BLACK;
+        return FIX_DONE;
+    }
+    if (t == tree->nil) return FIX_DONE;
+
+    cnode(p)->deficit++;
+    *next = p;
+    return FIX_UP;
+}
+
+// leaf면 x를 p에서 떼고, 아니면 x의 deficit 하나를 갚음
+static void settle(const rbtree* tree, node_t* p, node_t* x, int left, int leaf)
+{
+    if (leaf)
+    {
+        *child_ref(p, left) = tree->nil;
+    }
+    else
+    {
+        cnode(x)->deficit--;
+    }
+}
+
+/*
+ * 검정 x 쪽 경로에 검정 하나가 모자란 상황을 erase_fixup의 한 경우만큼 처리
+ * top(t), p, x를 잡은 채 부름 (p는 nil이 아님)
+ * leaf면 x는 떼어 낼 검정 잎(떼면 모자라게 됨), 아니면 x의 deficit 하나를 갚음
+ * 형제 s와 조카 near(x 쪽), far, 회전으로 옮겨지는 near의 자식만 더 잡음
+ * 회전할 자리에 빨강-빨강 위반이나 p의 deficit이 있으면 그것부터 풀도록 *next와 FIX_HELP/FIX_HELP_BLACK
+ * FIX_DONE: 다 갚음, FIX_UP: 모자람이 *next(p)로 올라감, FIX_AGAIN: case 1 회전 뒤 같은 x로 다시
+ */
+static int black_case(ctree* ct, node_t* t, node_t* p, node_t* x, int leaf, node_t** next)
+{
+    rbtree* tree = ct->tree;
+    node_t* nil = tree->nil;
+    int left = x == p->left;
+    // x 쪽 경로에 검정이 있으므로 형제 쪽도 비어 있지 않음
+    node_t* s = *child_ref(p, !left);
+    spin_lock(node_lock(s));
+
+    int result;
+    if (cnode(s)->deficit > 0)
+    {
+        // 양쪽 다 모자람: 하나씩 빼고 p 위로 하나를 올림
+        cnode(s)->deficit--;
+        settle(tree, p, x, left, leaf);
+        result = push_up(tree, t, p, next);
+        spin_unlock(node_lock(s));
+        return result;
+    }
+
+    node_t* near = *child_ref(s, left);
+    node_t* far = *child_ref(s, !left);
+    lock_child(tree, near);
+    lock_child(tree, far);
+    int rotate = s->color == RBTREE_RED || near->color == RBTREE_RED || far->color == RBTREE_RED;
+
+    *next = NULL;
+    if (s->color == RBTREE_RED)
+    {
+        // case 1은 p, near, far가 검정일 때만
+        if (p->color == RBTREE_RED) *next = s;
+        else if (near->color == RBTREE_RED) *next = near;
+        else if (far->color == RBTREE_RED) *next = far;
+    }
+    else if (rotate && p->color == RBTREE_RED && t != nil && t->color == RBTREE_RED)
+    {
+        // case 3, 4는 올라가는 노드가 p의 색을 받으므로 t와의 위반부터
+        *next = p;
+    }
+
+    if (*next)
+    {
+        result = FIX_HELP;
+    }
+    else if (rotate && cnode(p)->deficit > 0)
+    {
+        *next = p;
+        result = FIX_HELP_BLACK;
+    }
+    else if (s->color == RBTREE_RED)
+    {
+        // case 1: p에서 회전해서 x의 형제를 검정(near)으로 바꿈
+        //      [p]              [s]
+        //   [x]   [s]   ->   [p]   [far]
+        //      [near] [far] [x] [near]
+        move_child(tree, p, !left, near);
+        move_child(tree, s, left, p);
+        replace_child(ct, t, p, s);
+        s->color = RBTREE_BLACK;
+        p->color = RBTREE_RED;
+        result = FIX_AGAIN;
+    }
+    else if (!rotate)
+    {
+        // case 2: s를 빨강으로 해서 양쪽을 똑같이 모자라게 하고 p로 올림
+        s->color = RBTREE_RED;
+        settle(tree, p, x, left, leaf);
+        result = push_up(tree, t, p, next);
+    }
+    else if (far->color == RBTREE_RED)
+    {
+        // case 4: p에서 회전, s가 p의 색으로 올라가고 p와 far가 검정
+        //      [p]               [s]
+        //   [x]   [s]    ->   [p]   [far]
+        //      [near] [far] [x] [near]
+        move_child(tree, p, !left, near);
+        move_child(tree, s, left, p);
+        replace_child(ct, t, p, s);
+        s->color = p->color;
+        p->color = RBTREE_BLACK;
+        far->color = RBTREE_BLACK;
+        settle(tree, p, x, left, leaf);
+        result = FIX_DONE;
+    }
+    else
+    {
+        // case 3 + 4: near가 두 번 회전해서 p의 색으로 올라감, near의 자식 a, b가 p와 s로 나뉨
+        //      [p]                 [near]
+        //   [x]     [s]    ->    [p]     [s]
+        //       [near] [far]   [x] [a] [b] [far]
+        //       [a] [b]
+        node_t* a = *child_ref(near, left);
+        node_t* b = *child_ref(near, !left);
+        lock_child(tree, a);
+        lock_child(tree, b);
+        move_child(tree, p, !left, a);
+        move_child(tree, s, left, b);
+        move_child(tree, near, left, p);
+        move_child(tree, near, !left, s);
+        replace_child(ct, t, p, near);
+        near->color = p->color;
+        p->color = RBTREE_BLACK;
+        unlock_child(tree, b);
+        unlock_child(tree, a);
+        settle(tree, p, x, left, leaf);
+        result = FIX_DONE;
+    }
+
+    unlock_child(tree, far);
+    unlock_child(tree, near);
+    spin_unlock(node_lock(s));
+    return result;
+}
+
+/*
+ * deficit이 있는 x에서 한 단계
+ */
+static int black_step(ctree* ct, node_t* x, node_t** next)
+{
+    node_t *p, *t;
+    atomic_int* top;
+    if (!lock_node(ct, x, &p, &t, &top)) return FIX_DONE;
+
+    int result = FIX_DONE;
+    if (cnode(x)->deficit == 0)
+    {
+        // 다른 스레드가 이미 갚음
+    }
+    else if (p == ct->tree->nil)
+    {
+        // 루트면 모든 경로가 똑같이 모자라므로 그냥 없앰
+        cnode(x)->deficit--;
+    }
+    else
+    {
+        result = black_case(ct, t, p, x, 0, next);
+    }
+    unlock_node(ct, top, p, x);
+    return result;
+}
+
+/*
+ * x의 deficit 하나를 다 갚을 때까지 한 단계씩 위로 (다른 스레드의 것을 도와도 하나를 끝까지 책임짐)
+ */
+static void fix_black(ctree* ct, node_t* x)
+{
+    for (node_t* next;;)
+    {
+        int result = black_step(ct, x, &next);
+        if (result == FIX_DONE) return;
+
+        if (result == FIX_UP)
+        {
+            x = next;
+        }
+        else if (result == FIX_HELP)
+        {
+            fix_red(ct, next);
+        }
+        else if (result == FIX_HELP_BLACK)
+        {
+            fix_black(ct, next);
+        }
+    }
+}
+
+/*
+ * 자식이 둘인 dead x를 successor y와 자리(와 색)만 바꿈: x는 왼쪽 자식이 없는 y의 자리로 내려감
+ * top, p, x를 잡은 채 x의 두 자식을 잡고, 오른쪽 자식부터 y까지 hand-over-hand로 내려감
+ * (x를 잡고 있어서 x 아래로 새로 들어오는 스레드가 없고, 먼저 들어간 스레드는 앞질러 가지 않음)
+ * 바꾼 뒤 x의 key는 y보다 작은데 y의 오른쪽에 있지만, x의 key를 찾는 스레드는 y에서 왼쪽으로 가고
+ * x까지 오는 key는 모두 y보다 커서 오른쪽으로 가므로 탐색은 그대로 맞음 (x는 dead라 못 찾아도 됨)
+ */
+static int swap_successor(ctree* ct, node_t* p, node_t* x, node_t** next)
+{
+    rbtree* tree = ct->tree;
+    node_t* nil = tree->nil;
+    node_t* xl = x->left;
+    node_t* xr = x->right;
+    spin_lock(node_lock(xl));
+    spin_lock(node_lock(xr));
+
+    node_t* yp = x;
+    node_t* y = xr;
+    while (y->left != nil)
+    {
+        node_t* c = y->left;
+        spin_lock(node_lock(c));
+        if (yp != x && yp != xr) spin_unlock(node_lock(yp));
+        yp = y;
+        y = c;
+    }
+
+    int result = FIX_AGAIN;
+    if (cnode(y)->deficit > 0)
+    {
+        *next = y;
+        result = FIX_HELP_BLACK;
+    }
+    else
+    {
+        node_t* yr = y->right;
+        lock_child(tree, yr);
+        replace_child(ct, p, x, y);
+        move_child(tree, y, 1, xl);
+        if (y == xr)
+        {
+            move_child(tree, y, 0, x);
+        }
+        else
+        {
+            move_child(tree, y, 0, xr);
+            move_child(tree, yp, 1, x);
+        }
+        x->left = nil;
+        move_child(tree, x, 0, yr);
+
+        unsigned int color = x->color;
+        x->color = y->color;
+        y->color = color;
+        unlock_child(tree, yr);
+    }
+
+    if (y != xr) spin_unlock(node_lock(y));
+    if (yp != x && yp != xr) spin_unlock(node_lock(yp));
+    spin_unlock(node_lock(xr));
+    spin_unlock(node_lock(xl));
+    return result;
+}
+
+/*
+ * dead x를 트리에서 떼는 한 단계 (x가 다시 살아났거나 다른 스레드가 이미 뗐으면 FIX_DONE)
+ * 자식이 둘이면 successor와 자리를 바꾸고 FIX_AGAIN, 하나면 그 자식을 올림
+ * 검정 x를 떼어 생긴 모자람은 자식이 빨강이면 검정으로 칠해서 끝, 검정이면 deficit으로 *next에 넘김 (FIX_UP)
+ * 자식이 없는 검정 x는 black_case가 형제 쪽과 함께 처리하며 뗌
+ */
+static int unlink_step(ctree* ct, node_t* x, node_t** next)
+{
+    rbtree* tree = ct->tree;
+    node_t* nil = tree->nil;
+    node_t *p, *t;
+    atomic_int* top;
+    if (!lock_node(ct, x, &p, &t, &top)) return FIX_DONE;
+
+    int result = FIX_DONE;
+    int detached = 0;
+    node_t* c = x->left != nil ? x->left : x->right;
+    if (cnode(x)->count > 0)
+    {
+        // 그사이 같은 key가 다시 삽입됨
+    }
+    else if (cnode(x)->deficit > 0)
+    {
+        // 자리를 옮기거나 떼면 deficit이 맞지 않으므로 먼저 갚음
+        *next = x;
+        result = FIX_HELP_BLACK;
+    }
+    else if (x->left != nil && x->right != nil)
+    {
+        result = swap_successor(ct, p, x, next);
+    }
+    else if (c != nil)
+    {
+        spin_lock(node_lock(c));
+        if (x->color == RBTREE_BLACK && c->color == RBTREE_RED)
+        {
+            c->color = RBTREE_BLACK;
+        }
+        else if (x->color == RBTREE_BLACK && p != nil)
+        {
+            cnode(c)->deficit++;
+            *next = c;
+            result = FIX_UP;
+        }
+        replace_child(ct, p, x, c);
+        spin_unlock(node_lock(c));
+        detached = 1;
+    }
+    else if (x->color == RBTREE_RED || p == nil)
+    {
+        if (p == nil)
+        {
+            tree->root = nil;
+        }
+        else
+        {
+            *child_ref(p, p->left == x) = nil;
+        }
+        detached = 1;
+    }
+    else
+    {
+        result = black_case(ct, t, p, x, 1, next);
+        detached = result == FIX_DONE || result == FIX_UP;
+    }
+
+    if (detached) set_parent(x, NULL);
+    unlock_node(ct, top, p, x);
+    if (detached)
+    {
+        node_put(ct, x);
+        atomic_fetch_sub_explicit(&ct->nodes, 1, memory_order_relaxed);
+    }
+    return result;
+}
+
+static void unlink_dead(ctree* ct, node_t* x)
+{
+    for (node_t* next;;)
+    {
+        int result = unlink_step(ct, x, &next);
+        if (result == FIX_DONE) return;
+
+        if (result == FIX_UP)
+        {
+            fix_black(ct, next);
+            return;
+        }
+        if (result == FIX_HELP)
+        {
+            fix_red(ct, next);
+        }
+        else if (result == FIX_HELP_BLACK)
+        {
+            fix_black(ct, next);
+        }
+    }
+}
+
+int ctree_insert(ctree* ct, const key_t key)
+{
+    rbtree* tree = ct->tree;
+    // 새 key일 때만 쓰지만 락을 잡은 채로 할당하지 않도록 미리 만듦
+    node_t* node = node_new(ct, key);
+    if (!node) return -1;
+
+    node_t* x = descend(ct, key);
+    if (x == tree->nil)
+    {
+        node->color = RBTREE_BLACK;
+        set_parent(node, tree->nil);
+        tree->root = node;
+        spin_unlock(&ct->root_lock);
+        atomic_fetch_add_explicit(&ct->nodes, 1, memory_order_relaxed);
+    }
+    else if (x->key == key)
+    {
+        // 이미 있는 key: 개수만 늘림 (dead였으면 되살려서 떼어 내지 않게 함)
+        if (cnode(x)->count++ == 0)
+        {
+            x->dead = 0;
+        }
+        spin_unlock(node_lock(x));
+        node_put(ct, node);
+    }
+    else
+    {
+        // 빨간 잎으로 붙이고, 부모도 빨강이면 락을 놓은 뒤 위반을 지역 단계로 처리
+        set_parent(node, x);
+        *child_ref(x, key < x->key) = node;
+        int violation = x->color == RBTREE_RED;
+        spin_unlock(node_lock(x));
+        atomic_fetch_add_explicit(&ct->nodes, 1, memory_order_relaxed);
+        if (violation) fix_red(ct, node);
+    }
+    return 0;
+}
+
+/*
+ * 개수를 줄이고 0이 되면 그 자리에서 노드를 떼어 냄 (erase_fixup도 지역 단계로)
+ */
+int ctree_erase(ctree* ct, const key_t key)
+{
+    node_t* x = descend(ct, key);
+    int died = 0;
+    int erased = 0;
+    if (x != ct->tree->nil && x->key == key && cnode(x)->count > 0)
+    {
+        erased = 1;
+        if (--cnode(x)->count == 0)
+        {
+            x->dead = 1;
+            died = 1;
+        }
+    }
+    unlock_found(ct, x);
+
+    if (died) unlink_dead(ct, x);
+    return erased;
+}
+
+size_t ctree_count(ctree* ct, const key_t key)
+{
+    node_t* x = descend(ct, key);
+    size_t count = 0;
+    if (x != ct->tree->nil && x->key == key)
+    {
+        count = cnode(x)->count;
+    }
+    unlock_found(ct, x);
+    return count;
+}
+
+int ctree_find(ctree* ct, const key_t key)
+{
+    return ctree_count(ct, key) > 0;
+}
@@ -0,0 +1,42 @@
+#ifndef _CTREE_H_
+#define _CTREE_H_
+
+#include "rbtree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 여러 writer가 한 트리에서 같이 진행하는 rbtree (노드마다 락, relaxed balance)
+// - 찾기/삽입/삭제는 부모를 잡은 채 자식을 잡고 부모를 놓으며(hand-over-hand) 내려감
+// - 삽입은 빨간 잎을 붙이기만 하고 끝나고, 빨강-빨강 위반은 insert_fixup의 각 경우를 하나씩
+//   작은 이웃(위반 노드부터 증조부모까지 + 옮겨지는 자식)만 잡고 처리하는 지역 단계로 위로 밀어 올림
+//   단계 사이에는 락을 다 놓으므로 다른 스레드의 삽입/단계가 끼어들 수 있음
+// - 같은 key는 노드 하나의 개수로 셈, 개수가 0이 되면 삭제한 스레드가 노드를 떼어 냄
+//   자식이 둘이면 successor와 자리를 바꾼 뒤 떼고, 검정을 떼어 모자라게 된 경로는 노드의 deficit으로 표시해서
+//   erase_fixup의 각 경우를 부모, 형제, 조카(+ 옮겨지는 자식)만 잡는 지역 단계로 위로 밀어 올림
+//   떼어 낸 노드는 트리 안에서 다시 쓰고 delete_ctree에서 해제 (락 없이 parent를 읽는 스레드가 있어서)
+// 노드 포인터는 다른 스레드가 바로 바꿀 수 있어서 결과는 성공 여부만 돌려줌
+typedef struct ctree ctree;
+
+ctree *new_ctree(void);
+void delete_ctree(ctree *);
+
+// 실패(할당 실패)면 -1
+int ctree_insert(ctree *, const key_t);
+// key 하나를 지웠으면 1, 없으면 0
+int ctree_erase(ctree *, const key_t);
+// 있으면 1
+int ctree_find(ctree *, const key_t);
+
+// 안쪽 트리, 다른 스레드가 연산 중이 아닐 때만 사용
+// 같은 key는 노드 하나뿐 (개수는 노드 뒤에 있음)
+rbtree *ctree_tree(ctree *);
+// key의 개수
+size_t ctree_count(ctree *, const key_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _CTREE_H_
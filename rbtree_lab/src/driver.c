@@ -1,5 +1,1304 @@
+#include "ctree.h"
+#include "fctree.h"
+#include "ingest.h"
+#include "keystream.h"
+#include "node_arena.h"
 #include "rbtree.h"
+#include "shmtree.h"
+#include "strtree.h"
+#include "wal.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * 벤치마크 드라이버
+ * ./driver <bench> [n]
+ * 최적화 빌드는 상위 디렉터리에서 make bench
+ */
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// rand()는 RAND_MAX가 작은 환경이 있어서 xorshift 사용
+static unsigned int rng_state = 2463534242u;
+
+static key_t next_key(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (key_t)(rng_state & 0x7fffffff);
+}
+
+static rbtree* build_random_tree(size_t n, key_t* keys)
+{
+    rbtree* tree = new_rbtree();
+    for (size_t i = 0; i < n; ++i)
+    {
+        keys[i] = next_key();
+        rbtree_insert(tree, keys[i]);
+    }
+    return tree;
+}
+
+/*
+ * 절반은 있는 key, 절반은 없는 key로 rbtree_find 와 rbtree_find_batch 비교
+ */
+static void bench_find_batch(size_t n)
+{
+    size_t m = n < 1000000 ? 1000000 : n;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(m * sizeof(key_t));
+    node_t** out = (node_t**)malloc(m * sizeof(node_t*));
+    rbtree* tree = build_random_tree(n, keys);
+
+    for (size_t i = 0; i < m; ++i)
+    {
+        probes[i] = (i & 1) ? keys[next_key() % n] : next_key();
+    }
+
+    size_t hits = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < m; ++i)
+    {
+        hits += rbtree_find(tree, probes[i]) != NULL;
+    }
+    double t1 = now_sec();
+
+    rbtree_find_batch(tree, probes, m, out);
+    double t2 = now_sec();
+
+    size_t batch_hits = 0;
+    for (size_t i = 0; i < m; ++i)
+    {
+        batch_hits += out[i] != NULL;
+    }
+
+    printf("n=%zu lookups=%zu hits=%zu/%zu\n", n, m, hits, batch_hits);
+    printf("  rbtree_find       %8.1f ns/op\n", (t1 - t0) * 1e9 / m);
+    printf("  rbtree_find_batch %8.1f ns/op\n", (t2 - t1) * 1e9 / m);
+
+    delete_rbtree(tree);
+    free(out);
+    free(probes);
+    free(keys);
+}
+
+static double time_finds(const rbtree* tree, const key_t* probes, size_t m)
+{
+    size_t hits = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < m; ++i)
+    {
+        hits += rbtree_find(tree, probes[i]) != NULL;
+    }
+    double t1 = now_sec();
+    if (hits != m) printf("  (missed %zu)\n", m - hits);
+    return (t1 - t0) * 1e9 / m;
+}
+
+typedef struct {
+    unsigned char* data;
+    size_t len;
+    size_t pos;
+} mem_stream_t;
+
+static int mem_write(void* ctx, const void* buf, size_t len)
+{
+    mem_stream_t* s = (mem_stream_t*)ctx;
+    memcpy(s->data + s->len, buf, len);
+    s->len += len;
+    return 0;
+}
+
+static ssize_t mem_read(void* ctx, void* buf, size_t len)
+{
+    mem_stream_t* s = (mem_stream_t*)ctx;
+    if (len > s->len - s->pos) len = s->len - s->pos;
+    memcpy(buf, s->data + s->pos, len);
+    s->pos += len;
+    return (ssize_t)len;
+}
+
+static int array_next(void* ctx, key_t* key)
+{
+    key_t** p = (key_t**)ctx;
+    *key = *(*p)++;
+    return 0;
+}
+
+/*
+ * 촘촘한 key와 흩어진 key 트리를 key_t 배열(rbtree_to_array + rbtree_build)과 keystream으로 내보내고 다시 만들 때의 크기와 시간
+ */
+static void bench_keystream(size_t n)
+{
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    mem_stream_t s = { (unsigned char*)malloc(n * sizeof(key_t) + 4096), 0, 0 };
+
+    printf("n=%zu (export = to_array / encode, import = build from array / decode, ms)\n", n);
+    printf("  %-7s %12s %12s %7s %9s %9s %9s %9s\n", "keys", "array B", "stream B", "ratio", "to_array", "encode",
+           "build", "decode");
+    for (int dense = 1; dense >= 0; --dense)
+    {
+        rbtree* tree = new_rbtree();
+        for (size_t i = 0; i < n; ++i)
+        {
+            rbtree_insert(tree, dense ? (key_t)(i + i / 3) : next_key());
+        }
+
+        double t0 = now_sec();
+        rbtree_to_array(tree, keys, n);
+        double t1 = now_sec();
+        s.len = 0;
+        rbtree_encode(tree, mem_write, &s);
+        double t2 = now_sec();
+
+        rbtree* copy = new_rbtree();
+        key_t* cursor = keys;
+        double t3 = now_sec();
+        rbtree_build(copy, n, array_next, &cursor);
+        double t4 = now_sec();
+        delete_rbtree(copy);
+
+        copy = new_rbtree();
+        s.pos = 0;
+        double t5 = now_sec();
+        int err = rbtree_decode(copy, mem_read, &s);
+        double t6 = now_sec();
+
+        printf("  %-7s %12zu %12zu %6.1fx %9.1f %9.1f %9.1f %9.1f%s\n", dense ? "dense" : "random", n * sizeof(key_t),
+               s.len, (double)(n * sizeof(key_t)) / s.len, (t1 - t0) * 1e3, (t2 - t1) * 1e3, (t4 - t3) * 1e3,
+               (t6 - t5) * 1e3, err || copy->size != n ? " (mismatch)" : "");
+        delete_rbtree(copy);
+        delete_rbtree(tree);
+    }
+
+    free(s.data);
+    free(keys);
+}
+
+/*
+ * 삽입/삭제를 오래 반복해서 노드가 힙에 흩어진 트리에서 rbtree_compact 전후의 find 시간 비교
+ */
+static void bench_compact(size_t n)
+{
+    size_t m = 2000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(m * sizeof(key_t));
+    rbtree* tree = build_random_tree(n, keys);
+
+    // aging: 임의의 key를 지우고 새 key를 넣는 걸 3n번
+    for (size_t r = 0; r < 3 * n; ++r)
+    {
+        size_t i = next_key() % n;
+        rbtree_erase(tree, rbtree_find(tree, keys[i]));
+        keys[i] = next_key();
+        rbtree_insert(tree, keys[i]);
+    }
+
+    for (size_t i = 0; i < m; ++i)
+    {
+        probes[i] = keys[next_key() % n];
+    }
+
+    double aged = time_finds(tree, probes, m);
+    double t0 = now_sec();
+    rbtree_compact(tree);
+    double t1 = now_sec();
+    double compacted = time_finds(tree, probes, m);
+
+    printf("n=%zu lookups=%zu compact=%.1f ms\n", n, m, (t1 - t0) * 1e3);
+    printf("  aged      %8.1f ns/find\n", aged);
+    printf("  compacted %8.1f ns/find\n", compacted);
+
+    delete_rbtree(tree);
+    free(probes);
+    free(keys);
+}
+
+/*
+ * 해시 색인을 켜기 전후의 exact-match find 시간 비교
+ */
+static void bench_index(size_t n)
+{
+    size_t m = 2000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(m * sizeof(key_t));
+    rbtree* tree = build_random_tree(n, keys);
+
+    for (size_t i = 0; i < m; ++i)
+    {
+        probes[i] = keys[next_key() % n];
+    }
+
+    double plain = time_finds(tree, probes, m);
+    double t0 = now_sec();
+    rbtree_enable_index(tree);
+    double t1 = now_sec();
+    double indexed = time_finds(tree, probes, m);
+
+    printf("n=%zu lookups=%zu build=%.1f ms\n", n, m, (t1 - t0) * 1e3);
+    printf("  tree    %8.1f ns/find\n", plain);
+    printf("  indexed %8.1f ns/find\n", indexed);
+
+    delete_rbtree(tree);
+    free(probes);
+    free(keys);
+}
+
+static void run_churn(const char* name, rbtree* tree, const key_t* keys, size_t n, size_t m)
+{
+    double worst = 0;
+    double t0 = now_sec();
+    for (size_t r = 0; r < m; ++r)
+    {
+        key_t key = keys[next_key() % n];
+        node_t* node = rbtree_find(tree, key);
+        double e0 = now_sec();
+        rbtree_erase(tree, node);
+        double e1 = now_sec();
+        if (e1 - e0 > worst) worst = e1 - e0;
+        rbtree_insert(tree, key);
+    }
+    double t1 = now_sec();
+    printf("  %-6s %8.1f ns/(erase+insert)  worst erase %8.1f us\n", name, (t1 - t0) * 1e9 / m, worst * 1e6);
+}
+
+/*
+ * 있는 key 비율(1%~99%)을 바꿔 가며 Bloom filter를 켜기 전후의 find 시간 비교
+ * 트리에는 짝수 key만 넣고 없는 key는 홀수로 만듦
+ */
+static void bench_bloom(size_t n)
+{
+    static const int hit_percents[] = {1, 10, 50, 90, 99};
+    size_t m = 2000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(m * sizeof(key_t));
+    rbtree* plain = new_rbtree();
+    rbtree* filtered = new_rbtree();
+    for (size_t i = 0; i < n; ++i)
+    {
+        keys[i] = next_key() & ~1;
+        rbtree_insert(plain, keys[i]);
+        rbtree_insert(filtered, keys[i]);
+    }
+    double t0 = now_sec();
+    rbtree_enable_bloom(filtered);
+    double t1 = now_sec();
+
+    printf("n=%zu lookups=%zu build=%.1f ms\n", n, m, (t1 - t0) * 1e3);
+    printf("  %5s %10s %10s\n", "hit%", "tree", "bloom");
+    for (size_t h = 0; h < sizeof(hit_percents) / sizeof(hit_percents[0]); ++h)
+    {
+        for (size_t i = 0; i < m; ++i)
+        {
+            probes[i] = ((int)(next_key() % 100) < hit_percents[h]) ? keys[next_key() % n] : (next_key() | 1);
+        }
+        size_t hits[2] = {0, 0};
+        double t2 = now_sec();
+        for (size_t i = 0; i < m; ++i)
+        {
+            hits[0] += rbtree_find(plain, probes[i]) != NULL;
+        }
+        double t3 = now_sec();
+        for (size_t i = 0; i < m; ++i)
+        {
+            hits[1] += rbtree_find(filtered, probes[i]) != NULL;
+        }
+        double t4 = now_sec();
+        printf("  %5d %7.1f ns %7.1f ns%s\n", hit_percents[h], (t3 - t2) * 1e9 / m, (t4 - t3) * 1e9 / m,
+               hits[0] == hits[1] ? "" : "  (mismatch)");
+    }
+
+    delete_rbtree(filtered);
+    delete_rbtree(plain);
+    free(probes);
+    free(keys);
+}
+
+/*
+ * 노드 포인터를 들고 있다가 바로 지우는 경우와, 지울 때마다 key로 다시 찾는 경우 비교
+ * (erase가 다른 노드를 옮기지 않아서 들고 있는 포인터가 계속 유효)
+ */
+static void bench_handles(size_t n)
+{
+    size_t m = 2000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    node_t** handles = (node_t**)malloc(n * sizeof(node_t*));
+    key_t* fresh = (key_t*)malloc(m * sizeof(key_t));
+    size_t* victims = (size_t*)malloc(m * sizeof(size_t));
+    for (size_t i = 0; i < m; ++i)
+    {
+        fresh[i] = next_key();
+        victims[i] = next_key() % n;
+    }
+
+    // 같은 초기 트리 두 개: 하나는 key만, 하나는 노드 포인터를 기억
+    rbtree* by_key = build_random_tree(n, keys);
+    rbtree* by_handle = new_rbtree();
+    for (size_t i = 0; i < n; ++i)
+    {
+        handles[i] = rbtree_insert(by_handle, keys[i]);
+    }
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < m; ++i)
+    {
+        size_t j = victims[i];
+        rbtree_erase(by_key, rbtree_find(by_key, keys[j]));
+        rbtree_insert(by_key, fresh[i]);
+        keys[j] = fresh[i];
+    }
+    double t1 = now_sec();
+    for (size_t i = 0; i < m; ++i)
+    {
+        size_t j = victims[i];
+        rbtree_erase(by_handle, handles[j]);
+        handles[j] = rbtree_insert(by_handle, fresh[i]);
+    }
+    double t2 = now_sec();
+
+    printf("n=%zu replacements=%zu\n", n, m);
+    printf("  find+erase+insert   %8.1f ns/op\n", (t1 - t0) * 1e9 / m);
+    printf("  handle erase+insert %8.1f ns/op\n", (t2 - t1) * 1e9 / m);
+
+    delete_rbtree(by_handle);
+    delete_rbtree(by_key);
+    free(victims);
+    free(fresh);
+    free(handles);
+    free(keys);
+}
+
+/*
+ * 지웠다가 같은 key를 다시 넣는 churn에서 즉시 삭제와 lazy erase 비교
+ */
+static void bench_lazy(size_t n)
+{
+    size_t m = 2000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+
+    printf("n=%zu ops=%zu\n", n, m);
+    rbtree* tree = build_random_tree(n, keys);
+    run_churn("eager", tree, keys, n, m);
+    delete_rbtree(tree);
+
+    tree = build_random_tree(n, keys);
+    rbtree_set_lazy_erase(tree, 0.25);
+    run_churn("lazy", tree, keys, n, m);
+    delete_rbtree(tree);
+
+    free(keys);
+}
+
+/*
+ * URL 모양 key ("https://" + host + path)의 strtree_find와 같은 개수 int key의 rbtree_find 비교
+ */
+static void bench_strtree(size_t n)
+{
+    size_t m = 2000000;
+    char (*urls)[64] = (char (*)[64])malloc(n * sizeof(*urls));
+    size_t* lens = (size_t*)malloc(n * sizeof(size_t));
+    size_t* probes = (size_t*)malloc(m * sizeof(size_t));
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* key_probes = (key_t*)malloc(m * sizeof(key_t));
+    strtree* st = new_strtree();
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned int host = next_key(), path = next_key();
+        lens[i] = (size_t)snprintf(urls[i], sizeof(urls[i]), "https://www.%c%c%c%u.com/item/%u",
+                                   'a' + host % 26, 'a' + host / 26 % 26, 'a' + host / 676 % 26, host % 1000, path);
+        strtree_insert(st, urls[i], lens[i]);
+    }
+    rbtree* tree = build_random_tree(n, keys);
+
+    for (size_t i = 0; i < m; ++i)
+    {
+        probes[i] = next_key() % n;
+        key_probes[i] = keys[next_key() % n];
+    }
+
+    double ints = time_finds(tree, key_probes, m);
+
+    size_t hits = 0;
+    double t0 = now_sec();
+    for (size_t i = 0; i < m; ++i)
+    {
+        hits += strtree_find(st, urls[probes[i]], lens[probes[i]]) != NULL;
+    }
+    double t1 = now_sec();
+    if (hits != m) printf("  (missed %zu)\n", m - hits);
+
+    printf("n=%zu lookups=%zu e.g. %s\n", n, m, urls[0]);
+    printf("  int key %8.1f ns/find\n", ints);
+    printf("  url key %8.1f ns/find\n", (t1 - t0) * 1e9 / m);
+
+    delete_rbtree(tree);
+    delete_strtree(st);
+    free(key_probes);
+    free(keys);
+    free(probes);
+    free(lens);
+    free(urls);
+}
+
+static int cmp_key(const void* a, const void* b)
+{
+    key_t x = *(const key_t*)a, y = *(const key_t*)b;
+    return (x > y) - (x < y);
+}
+
+/*
+ * 워커 4개가 같은 key 집합을 검색할 때: 각자 rbtree_insert로 사본을 만드는 경우와
+ * 쓰는 프로세스가 공유 메모리에 한 번 적재하고 워커는 붙기만 하는 경우 비교
+ */
+static void bench_shm(size_t n)
+{
+    const int workers = 4;
+    size_t m = 1000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(m * sizeof(key_t));
+    char name[64];
+    snprintf(name, sizeof(name), "/rbtree-bench-%d", (int)getpid());
+
+    rbtree* tree = build_random_tree(n, keys);
+    for (size_t i = 0; i < m; ++i)
+    {
+        probes[i] = keys[next_key() % n];
+    }
+
+    double t0 = now_sec();
+    delete_rbtree(tree);
+    tree = new_rbtree();
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_insert(tree, keys[i]);
+    }
+    double t1 = now_sec();
+    double private_find = time_finds(tree, probes, m);
+    delete_rbtree(tree);
+
+    qsort(keys, n, sizeof(key_t), cmp_key);
+    shmtree_unlink(name);
+    double t2 = now_sec();
+    shmtree* st = shmtree_create(name, n);
+    shmtree_load(st, keys, n);
+    double t3 = now_sec();
+
+    double t4 = now_sec();
+    for (int w = 0; w < workers; ++w)
+    {
+        if (fork() == 0)
+        {
+            shmtree* view = shmtree_open(name);
+            size_t hits = 0;
+            for (size_t i = 0; i < m; ++i)
+            {
+                hits += shmtree_find(view, probes[i]);
+            }
+            shmtree_close(view);
+            _exit(hits == m ? 0 : 1);
+        }
+    }
+    int failed = 0;
+    for (int w = 0; w < workers; ++w)
+    {
+        int status;
+        wait(&status);
+        failed += !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    }
+    double t5 = now_sec();
+
+    printf("n=%zu workers=%d lookups/worker=%zu%s\n", n, workers, m, failed ? " (worker failed)" : "");
+    printf("  private: build %8.1f ms/worker, %zu MB/worker, %6.1f ns/find\n",
+           (t1 - t0) * 1e3, n * sizeof(node_t) >> 20, private_find);
+    printf("  shared:  load  %8.1f ms once,   %zu MB total,  %6.1f ns/find (all workers, incl. attach)\n",
+           (t3 - t2) * 1e3, st->bytes >> 20, (t5 - t4) * 1e9 / (m * workers));
+
+    shmtree_close(st);
+    shmtree_unlink(name);
+    free(probes);
+    free(keys);
+}
+
+/*
+ * 한 번에 delete_rbtree, budget 단위 rbtree_destroy_step, 백그라운드 해제의 호출자 쪽 멈춤 시간 비교
+ * 그리고 비운 뒤 다시 채울 때 delete+new와 rbtree_clear 비교
+ */
+static void bench_destroy(size_t n)
+{
+    const size_t budget = 4096;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+
+    rbtree* tree = build_random_tree(n, keys);
+    double t0 = now_sec();
+    delete_rbtree(tree);
+    double t1 = now_sec();
+
+    tree = build_random_tree(n, keys);
+    double worst = 0;
+    size_t calls = 0;
+    for (int more = 1; more; ++calls)
+    {
+        double s0 = now_sec();
+        more = rbtree_destroy_step(tree, budget);
+        double s1 = now_sec();
+        if (s1 - s0 > worst) worst = s1 - s0;
+    }
+
+    tree = build_random_tree(n, keys);
+    double t2 = now_sec();
+    delete_rbtree(tree);
+    tree = new_rbtree();
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_insert(tree, keys[i]);
+    }
+    double t3 = now_sec();
+    rbtree_clear(tree);
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_insert(tree, keys[i]);
+    }
+    double t4 = now_sec();
+
+    // 백그라운드 스레드가 다른 측정과 겹치지 않도록 마지막에
+    double t5 = now_sec();
+    rbtree_destroy_async(tree);
+    double t6 = now_sec();
+
+    printf("n=%zu\n", n);
+    printf("  delete_rbtree       %8.1f ms blocked\n", (t1 - t0) * 1e3);
+    printf("  destroy_step(%zu) %8.1f us worst call, %zu calls\n", budget, worst * 1e6, calls);
+    printf("  destroy_async       %8.1f us blocked\n", (t6 - t5) * 1e6);
+    printf("  delete+new+refill   %8.1f ms\n", (t3 - t2) * 1e3);
+    printf("  clear+refill        %8.1f ms\n", (t4 - t3) * 1e3);
+
+    free(keys);
+}
+
+/*
+ * n개 스트림에서 가장 큰 K개 유지: 매번 insert + min + erase 하는 경우와 rbtree_set_capacity 비교
+ */
+static void bench_topk(size_t n)
+{
+    const size_t k = 1000;
+    key_t* stream = (key_t*)malloc(n * sizeof(key_t));
+    for (size_t i = 0; i < n; ++i)
+    {
+        stream[i] = next_key();
+    }
+
+    rbtree* naive = new_rbtree();
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_insert(naive, stream[i]);
+        if (naive->size > k)
+        {
+            rbtree_erase(naive, rbtree_min(naive));
+        }
+    }
+    double t1 = now_sec();
+
+    rbtree* bounded = new_rbtree();
+    rbtree_set_capacity(bounded, k);
+    double t2 = now_sec();
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_insert(bounded, stream[i]);
+    }
+    double t3 = now_sec();
+
+    printf("n=%zu k=%zu same=%d\n", n, k, rbtree_min(naive)->key == rbtree_min(bounded)->key);
+    printf("  insert+min+erase %8.1f ns/item\n", (t1 - t0) * 1e9 / n);
+    printf("  capacity         %8.1f ns/item\n", (t3 - t2) * 1e9 / n);
+
+    delete_rbtree(bounded);
+    delete_rbtree(naive);
+    free(stream);
+}
+
+/*
+ * 변경 1000개마다 동기화하는 churn에서 WAL이 쓰는 양과 매번 rbtree_to_array 전체를 덤프하는 경우 비교
+ * 그리고 checkpoint + 로그 꼬리로 복구하는 시간
+ */
+static void bench_wal(size_t n)
+{
+    const size_t m = 1000000;
+    const size_t sync_every = 1000;
+    char dir[64];
+    snprintf(dir, sizeof(dir), "/tmp/rbtree-bench-wal-%d", (int)getpid());
+
+    rbtree_wal* wal = wal_open(dir);
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    for (size_t i = 0; i < n; ++i)
+    {
+        keys[i] = next_key();
+        wal_insert(wal, keys[i]);
+    }
+    wal_checkpoint(wal);
+
+    uint64_t generation = wal->generation;
+    double t0 = now_sec();
+    for (size_t r = 0; r < m; ++r)
+    {
+        size_t i = next_key() % n;
+        wal_erase(wal, rbtree_find(wal->tree, keys[i]));
+        keys[i] = next_key();
+        wal_insert(wal, keys[i]);
+        if (r % sync_every == 0)
+        {
+            wal_sync(wal);
+        }
+    }
+    wal_sync(wal);
+    double t1 = now_sec();
+
+    // 변경 2m개 레코드 + 그 사이 자동 checkpoint
+    double wal_mb = (2.0 * m * 5 + (wal->generation - generation) * n * sizeof(key_t)) / (1 << 20);
+    double dump_mb = (double)(m / sync_every) * n * sizeof(key_t) / (1 << 20);
+    size_t log_bytes = wal->log_bytes;
+    wal_close(wal);
+
+    double t2 = now_sec();
+    wal = wal_open(dir);
+    double t3 = now_sec();
+
+    printf("n=%zu churn=%zu (erase+insert) sync every %zu\n", n, m, sync_every);
+    printf("  wal        %8.1f ns/change, %8.1f MB written, %llu checkpoints\n", (t1 - t0) * 1e9 / (2 * m), wal_mb,
+           (unsigned long long)(wal->generation - generation));
+    printf("  full dump                      %8.1f MB written\n", dump_mb);
+    printf("  recovery   %8.1f ms (checkpoint + %zu KB log)\n", (t3 - t2) * 1e3, log_bytes >> 10);
+
+    wal_close(wal);
+    char path[128];
+    snprintf(path, sizeof(path), "%s/wal.log", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/checkpoint", dir);
+    unlink(path);
+    rmdir(dir);
+    free(keys);
+}
+
+/*
+ * 하드웨어 카운터 (perf_event_open)
+ * 이벤트마다 따로 열어서 일부만 지원되는 환경(VM, 권한 부족)에서도 되는 것만 보고
+ * 카운터가 많아 multiplexing되면 enabled/running 시간 비율로 보정
+ */
+#ifdef __linux__
+#define PERF_HW_CACHE(cache, result) \
+    ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | ((result) << 16))
+
+static const struct {
+    const char* name;
+    unsigned int type;
+    unsigned long long config;
+} perf_events[] = {
+    { "instr", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "L1d-miss", PERF_TYPE_HW_CACHE, PERF_HW_CACHE(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "LLC-miss", PERF_TYPE_HW_CACHE, PERF_HW_CACHE(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "dTLB-miss", PERF_TYPE_HW_CACHE, PERF_HW_CACHE(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_RESULT_MISS) },
+    { "br-miss", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+};
+#define PERF_EVENTS (sizeof(perf_events) / sizeof(perf_events[0]))
+
+typedef struct {
+    int fd[PERF_EVENTS];
+    double start;
+    double value[PERF_EVENTS];  // 음수면 측정 못 함
+    double seconds;
+} perf_counters_t;
+
+static void perf_open(perf_counters_t* pc)
+{
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = perf_events[i].type;
+        attr.config = perf_events[i].config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        pc->fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+}
+
+static void perf_close(perf_counters_t* pc)
+{
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        if (pc->fd[i] >= 0) close(pc->fd[i]);
+    }
+}
+
+static void perf_start(perf_counters_t* pc)
+{
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        if (pc->fd[i] < 0) continue;
+        ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    pc->start = now_sec();
+}
+
+static void perf_stop(perf_counters_t* pc)
+{
+    pc->seconds = now_sec() - pc->start;
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        unsigned long long v[3];  // value, time_enabled, time_running
+        pc->value[i] = -1;
+        if (pc->fd[i] < 0) continue;
+
+        ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+        if (read(pc->fd[i], v, sizeof(v)) == (ssize_t)sizeof(v) && v[2] > 0)
+        {
+            pc->value[i] = (double)v[0] * v[1] / v[2];
+        }
+    }
+}
+
+static void perf_report(const char* op, const perf_counters_t* pc, size_t ops)
+{
+    printf("  %-16s %8.1f", op, pc->seconds * 1e9 / ops);
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        if (pc->value[i] < 0)
+        {
+            printf(" %10s", "n/a");
+        }
+        else
+        {
+            printf(" %10.2f", pc->value[i] / ops);
+        }
+    }
+    printf("\n");
+}
+
+/*
+ * rbtree_insert / rbtree_find / rbtree_to_array / rbtree_erase 각각의 연산당 카운터
+ */
+static void bench_perf(size_t n)
+{
+    perf_counters_t pc;
+    perf_open(&pc);
+
+    int available = 0;
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        available += pc.fd[i] >= 0;
+    }
+    if (available == 0)
+    {
+        printf("  perf_event_open unavailable (kernel.perf_event_paranoid or container); counters show n/a\n");
+    }
+
+    size_t m = 1000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(m * sizeof(key_t));
+    key_t* arr = (key_t*)malloc(n * sizeof(key_t));
+    for (size_t i = 0; i < n; ++i)
+    {
+        keys[i] = next_key();
+    }
+
+    printf("n=%zu (per op)\n  %-16s %8s", n, "op", "ns");
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        printf(" %10s", perf_events[i].name);
+    }
+    printf("\n");
+
+    rbtree* tree = new_rbtree();
+    perf_start(&pc);
+    for (size_t i = 0; i < n; ++i)
+    {
+        rbtree_insert(tree, keys[i]);
+    }
+    perf_stop(&pc);
+    perf_report("rbtree_insert", &pc, n);
+
+    for (size_t i = 0; i < m; ++i)
+    {
+        probes[i] = keys[next_key() % n];
+    }
+    size_t hits = 0;
+    perf_start(&pc);
+    for (size_t i = 0; i < m; ++i)
+    {
+        hits += rbtree_find(tree, probes[i]) != NULL;
+    }
+    perf_stop(&pc);
+    perf_report("rbtree_find", &pc, m);
+
+    perf_start(&pc);
+    rbtree_to_array(tree, arr, n);
+    perf_stop(&pc);
+    perf_report("rbtree_to_array", &pc, n);
+
+    // 노드 포인터는 삭제를 거쳐도 유지되므로 미리 모아서 섞어 두고 erase만 잼
+    // (key로 찾으면 같은 key가 있을 때 한 노드를 두 번 지우게 되므로 순회로 모음)
+    node_t** nodes = (node_t**)malloc(n * sizeof(node_t*));
+    size_t count = 0;
+    for (node_t* x = rbtree_min(tree); x != tree->nil; x = rbtree_next(tree, x))
+    {
+        nodes[count++] = x;
+    }
+    for (size_t i = count; i > 1; --i)
+    {
+        size_t j = next_key() % i;
+        node_t* tmp = nodes[i - 1];
+        nodes[i - 1] = nodes[j];
+        nodes[j] = tmp;
+    }
+    perf_start(&pc);
+    for (size_t i = 0; i < count; ++i)
+    {
+        rbtree_erase(tree, nodes[i]);
+    }
+    perf_stop(&pc);
+    perf_report("rbtree_erase", &pc, count);
+    free(nodes);
+
+    if (hits != m) printf("  (missed %zu)\n", m - hits);
+    perf_close(&pc);
+    delete_rbtree(tree);
+    free(arr);
+    free(probes);
+    free(keys);
+}
+
+// 이 프로세스에서 THP로 잡힌 익명 메모리 (kB), 못 읽으면 -1
+static long anon_huge_kb(void)
+{
+    FILE* fp = fopen("/proc/self/smaps_rollup", "r");
+    if (!fp) return -1;
+
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1) break;
+    }
+    fclose(fp);
+    return kb;
+}
+
+/*
+ * 같은 key로 만든 큰 트리에서 노드 저장소(calloc, 4K arena, THP arena, hugetlb arena)별 find 시간과 dTLB 미스
+ * 트리가 TLB가 덮는 범위(수 MB)보다 훨씬 커야 차이가 보임 (./driver hugepage 10000000)
+ */
+static void bench_hugepage(size_t n)
+{
+    static const struct {
+        const char* name;
+        int flags;  // -1이면 arena 없이 calloc
+    } stores[] = {
+        { "calloc", -1 },
+        { "arena 4K", 0 },
+        { "arena THP", NODE_ARENA_THP | NODE_ARENA_NUMA_LOCAL },
+        { "arena hugetlb", NODE_ARENA_HUGETLB | NODE_ARENA_NUMA_LOCAL },
+    };
+
+    perf_counters_t pc;
+    perf_open(&pc);
+
+    size_t m = 1000000;
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* probes = (key_t*)malloc(m * sizeof(key_t));
+    for (size_t i = 0; i < n; ++i)
+    {
+        keys[i] = next_key();
+    }
+    for (size_t i = 0; i < m; ++i)
+    {
+        probes[i] = keys[next_key() % n];
+    }
+
+    printf("n=%zu finds=%zu (per find)\n  %-16s %8s", n, m, "store", "ns");
+    for (size_t i = 0; i < PERF_EVENTS; ++i)
+    {
+        printf(" %10s", perf_events[i].name);
+    }
+    printf("\n");
+
+    for (size_t s = 0; s < sizeof(stores) / sizeof(stores[0]); ++s)
+    {
+        node_arena* arena = stores[s].flags >= 0 ? node_arena_new(stores[s].flags) : NULL;
+        rbtree* tree = new_rbtree();
+        if (arena)
+        {
+            node_arena_attach(arena, tree);
+        }
+        for (size_t i = 0; i < n; ++i)
+        {
+            rbtree_insert(tree, keys[i]);
+        }
+
+        size_t hits = 0;
+        perf_start(&pc);
+        for (size_t i = 0; i < m; ++i)
+        {
+            hits += rbtree_find(tree, probes[i]) != NULL;
+        }
+        perf_stop(&pc);
+        perf_report(stores[s].name, &pc, m);
+        if (arena)
+        {
+            printf("    chunks=%zu (hugetlb %zu, thp %zu, numa %zu)", arena->stats.chunks, arena->stats.hugetlb_chunks,
+                   arena->stats.thp_chunks, arena->stats.numa_chunks);
+        }
+        else
+        {
+            printf("    chunks=-");
+        }
+        printf(" AnonHugePages=%ld kB%s\n", anon_huge_kb(), hits == m ? "" : " (missed)");
+
+        delete_rbtree(tree);
+        node_arena_delete(arena);
+    }
+
+    perf_close(&pc);
+    free(probes);
+    free(keys);
+}
+#else
+static void bench_perf(size_t n)
+{
+    (void)n;
+    printf("  perf counters need Linux perf_event_open\n");
+}
+
+static void bench_hugepage(size_t n)
+{
+    (void)n;
+    printf("  huge page benchmark needs Linux (perf_event_open, madvise)\n");
+}
+#endif
+
+/*
+ * rbtree_to_array와 rbtree_to_array_parallel(스레드 1~8개)의 내보내기 시간
+ */
+static void bench_parallel(size_t n)
+{
+    key_t* keys = (key_t*)malloc(n * sizeof(key_t));
+    key_t* expected = (key_t*)malloc(n * sizeof(key_t));
+    key_t* arr = (key_t*)malloc(n * sizeof(key_t));
+    rbtree* tree = build_random_tree(n, keys);
+
+    double t0 = now_sec();
+    rbtree_to_array(tree, expected, n);
+    double t1 = now_sec();
+
+    printf("n=%zu, %ld cpus online\n", n, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("  %-20s %8.1f ms\n", "to_array", (t1 - t0) * 1e3);
+    for (int threads = 1; threads <= 8; threads *= 2)
+    {
+        double t2 = now_sec();
+        rbtree_to_array_parallel(tree, arr, n, threads);
+        double t3 = now_sec();
+        printf("  to_array_parallel(%d) %7.1f ms%s\n", threads, (t3 - t2) * 1e3,
+               memcmp(arr, expected, n * sizeof(key_t)) == 0 ? "" : "  (mismatch)");
+    }
+
+    delete_rbtree(tree);
+    free(arr);
+    free(expected);
+    free(keys);
+}
+
+/*
+ * 쓰기 위주(insert/erase 반반) 워크로드에서 스레드 수를 늘려 가며 mutex 하나로 감싼 rbtree와 fctree 처리량 비교
+ * skewed면 연산 절반이 key 공간 앞 1/64에 몰리고 절반은 find (insert/erase는 1/4씩)
+ */
+#define FC_MAX_THREADS 64
+
+typedef struct {
+    rbtree* tree;
+    pthread_mutex_t* lock;
+    fctree* fc;
+    ctree* ct;
+    size_t ops;
+    unsigned int seed;
+    int skewed;
+} fc_worker_t;
+
+static void* fc_worker(void* arg)
+{
+    fc_worker_t* w = (fc_worker_t*)arg;
+    unsigned int seed = w->seed;
+    for (size_t i = 0; i < w->ops; ++i)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        key_t key = (key_t)((seed >> 1) % (1 << 20));
+        int insert = seed & 1;
+        int find = 0;
+        if (w->skewed)
+        {
+            if (seed >> 31) key %= (1 << 20) / 64;
+            find = (seed >> 30) & 1;
+        }
+
+        if (w->ct)
+        {
+            if (find)
+            {
+                ctree_find(w->ct, key);
+            }
+            else if (insert)
+            {
+                ctree_insert(w->ct, key);
+            }
+            else
+            {
+                ctree_erase(w->ct, key);
+            }
+            continue;
+        }
+
+        if (w->fc)
+        {
+            if (find)
+            {
+                fctree_find(w->fc, key);
+            }
+            else if (insert)
+            {
+                fctree_insert(w->fc, key);
+            }
+            else
+            {
+                fctree_erase(w->fc, key);
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(w->lock);
+        if (find)
+        {
+            rbtree_find(w->tree, key);
+        }
+        else if (insert)
+        {
+            rbtree_insert(w->tree, key);
+        }
+        else
+        {
+            node_t* node = rbtree_find(w->tree, key);
+            if (node) rbtree_erase(w->tree, node);
+        }
+        pthread_mutex_unlock(w->lock);
+    }
+    return NULL;
+}
+
+static double fc_run(int threads, size_t n, const fc_worker_t* proto)
+{
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    fc_worker_t workers[FC_MAX_THREADS];
+    pthread_t ids[FC_MAX_THREADS];
+
+    double t0 = now_sec();
+    for (int t = 0; t < threads; ++t)
+    {
+        workers[t] = *proto;
+        workers[t].lock = &lock;
+        workers[t].ops = n / threads;
+        workers[t].seed = 2463534242u + 7919u * t;
+        pthread_create(&ids[t], NULL, fc_worker, &workers[t]);
+    }
+    for (int t = 0; t < threads; ++t)
+    {
+        pthread_join(ids[t], NULL);
+    }
+    return (n / threads) * threads / (now_sec() - t0) * 1e-6;
+}
+
+static void bench_fc(size_t n)
+{
+    printf("n=%zu ops, insert/erase 50:50, %ld cpus online (Mops/s)\n", n, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("  %7s %10s %10s\n", "threads", "mutex", "fctree");
+    for (int threads = 1; threads <= 32; threads *= 2)
+    {
+        rbtree* tree = new_rbtree();
+        fctree* fc = new_fctree();
+        double locked = fc_run(threads, n, &(fc_worker_t){ .tree = tree });
+        double combined = fc_run(threads, n, &(fc_worker_t){ .fc = fc });
+        printf("  %7d %10.2f %10.2f\n", threads, locked, combined);
+        delete_fctree(fc);
+        delete_rbtree(tree);
+    }
+}
+
+/*
+ * 한쪽 key 범위에 몰린 워크로드에서 writer 여럿이 한 트리를 같이 고칠 때의 확장성
+ * mutex 하나, flat combining(fctree), 노드별 락 + relaxed balance(ctree)를 64 스레드까지 비교
+ * 트리를 미리 n/2개로 채워 두고 시작 (ctree가 여러 부분 트리에서 동시에 진행할 수 있도록)
+ */
+static void bench_ctree(size_t n)
+{
+    printf("n=%zu ops, 1/2 hot (1/64 of keys), find:insert:erase 2:1:1, %ld cpus online (Mops/s)\n", n,
+           sysconf(_SC_NPROCESSORS_ONLN));
+    printf("  %7s %10s %10s %10s\n", "threads", "mutex", "fctree", "ctree");
+    for (int threads = 1; threads <= FC_MAX_THREADS; threads *= 2)
+    {
+        rbtree* tree = new_rbtree();
+        fctree* fc = new_fctree();
+        ctree* ct = new_ctree();
+        rng_state = 2463534242u;
+        for (size_t i = 0; i < n / 2; ++i)
+        {
+            key_t key = next_key() % (1 << 20);
+            rbtree_insert(tree, key);
+            fctree_insert(fc, key);
+            ctree_insert(ct, key);
+        }
+
+        double locked = fc_run(threads, n, &(fc_worker_t){ .tree = tree, .skewed = 1 });
+        double combined = fc_run(threads, n, &(fc_worker_t){ .fc = fc, .skewed = 1 });
+        double relaxed = fc_run(threads, n, &(fc_worker_t){ .ct = ct, .skewed = 1 });
+        printf("  %7d %10.2f %10.2f %10.2f\n", threads, locked, combined, relaxed);
+        delete_ctree(ct);
+        delete_fctree(fc);
+        delete_rbtree(tree);
+    }
+}
+
+static int compare_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// 호출 하나하나의 시간(ns)을 정렬해서 평균/p50/p99/최대 출력
+static void print_latency(const char* name, uint32_t* lat, size_t m, double total)
+{
+    double sum = 0;
+    for (size_t i = 0; i < m; ++i)
+    {
+        sum += lat[i];
+    }
+    qsort(lat, m, sizeof(uint32_t), compare_u32);
+    printf("  %-8s %9.1f %8u %8u %9u %10.2f\n", name, sum / m, lat[m / 2], lat[(size_t)(m * 0.99)], lat[m - 1],
+           m / total * 1e-6);
+}
+
+/*
+ * 트리 크기를 키워 가며 rbtree_insert를 바로 부를 때와 rbtree_insert_async로 올릴 때 호출하는 쪽이 기다리는 시간
+ * async 처리량은 올리기 시작부터 flush로 모두 적용될 때까지 기준
+ */
+static void bench_async(size_t n)
+{
+    size_t m = 200000;
+    uint32_t* lat = (uint32_t*)malloc(m * sizeof(uint32_t));
+    key_t* keys = (key_t*)malloc(m * sizeof(key_t));
+    key_t* tree_keys = (key_t*)malloc(n * sizeof(key_t));
+
+    printf("%zu inserts into a tree of size s (ns per call; Mops/s until applied)\n", m);
+    for (size_t size = n / 100; size <= n; size *= 10)
+    {
+        printf("s=%zu\n  %-8s %9s %8s %8s %9s %10s\n", size, "", "mean", "p50", "p99", "max", "Mops/s");
+        for (int async = 0; async <= 1; ++async)
+        {
+            rbtree* tree = build_random_tree(size, tree_keys);
+            for (size_t i = 0; i < m; ++i)
+            {
+                keys[i] = next_key();
+            }
+
+            rbtree_async* as = async ? rbtree_async_start(tree, 0) : NULL;
+            double t0 = now_sec();
+            for (size_t i = 0; i < m; ++i)
+            {
+                struct timespec a, b;
+                clock_gettime(CLOCK_MONOTONIC, &a);
+                if (as)
+                {
+                    rbtree_insert_async(as, keys[i]);
+                }
+                else
+                {
+                    rbtree_insert(tree, keys[i]);
+                }
+                clock_gettime(CLOCK_MONOTONIC, &b);
+                lat[i] = (uint32_t)((b.tv_sec - a.tv_sec) * 1000000000L + (b.tv_nsec - a.tv_nsec));
+            }
+            if (as)
+            {
+                rbtree_async_stop(as);
+            }
+            double total = now_sec() - t0;
+
+            print_latency(async ? "async" : "direct", lat, m, total);
+            delete_rbtree(tree);
+        }
+    }
+
+    free(tree_keys);
+    free(keys);
+    free(lat);
+}
+
+typedef struct {
+    const char* name;
+    void (*run)(size_t n);
+} bench_t;
+
+static const bench_t benches[] = {
+    { "find_batch", bench_find_batch },
+    { "compact", bench_compact },
+    { "keystream", bench_keystream },
+    { "index", bench_index },
+    { "bloom", bench_bloom },
+    { "handles", bench_handles },
+    { "lazy", bench_lazy },
+    { "strtree", bench_strtree },
+    { "shm", bench_shm },
+    { "destroy", bench_destroy },
+    { "topk", bench_topk },
+    { "wal", bench_wal },
+    { "perf", bench_perf },
+    { "fc", bench_fc },
+    { "ctree", bench_ctree },
+    { "async", bench_async },
+    { "parallel", bench_parallel },
+    { "hugepage", bench_hugepage },
+};
 
 int main(int argc, char *argv[]) {
+    size_t count = sizeof(benches) / sizeof(benches[0]);
+    size_t n = (argc > 2) ? strtoul(argv[2], NULL, 10) : 1000000;
 
-}
\ No newline at end of file
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (argc < 2 || strcmp(argv[1], benches[i].name) == 0)
+        {
+            printf("[%s]\n", benches[i].name);
+            benches[i].run(n);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,493 @@
+#include "node_arena.h"
+#include "rbtree.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * 메모리보다 큰 key 파일(key_t 이진 배열) 정렬
+ * ./extsort [-m MiB] [-k fan-in] [-T tmpdir] [-v] <in|-> <out|->
+ * 1) replacement selection: 트리에 메모리만큼 key를 담고 최솟값을 run에 쓴 뒤 다음 key를 읽어
+ *    방금 쓴 값 이상이면 지금 run 트리에, 작으면 다음 run 트리에 넣음
+ *    -> 입력이 무작위면 run 길이가 평균 메모리의 두 배라서 run 수가 절반
+ * 2) k-way merge: run마다 앞 key를 트리에 넣고 최솟값을 빼서 쓰고 그 run의 다음 key를 넣음
+ *    run이 fan-in보다 많으면 fan-in개씩 묶어 더 긴 run으로 합치는 단계를 반복
+ * 노드는 node_arena에서 받아서 두 트리를 합쳐 메모리 한도만큼만 쓰고, 빠진 노드 자리를 계속 재사용
+ */
+
+#define EXTSORT_IO_BYTES (1 << 20)  // 입력/출력 버퍼
+#define EXTSORT_MIN_RUN_IO 4096     // merge할 때 run 하나의 최소 읽기 버퍼 (key 수)
+
+// 처음 실패한 단계와 그때의 errno (0이면 시스템 오류가 아님), main이 보고
+static const char* fail_step;
+static int fail_errno;
+
+static int fail(const char* step, int err)
+{
+    if (!fail_step)
+    {
+        fail_step = step;
+        fail_errno = err;
+    }
+    return -1;
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * 버퍼를 둔 key 단위 읽기/쓰기 (fd 하나에 하나씩)
+ */
+typedef struct {
+  int fd;
+  key_t* buf;
+  size_t cap;
+  size_t pos;
+  size_t len;
+  int err;
+} key_io_t;
+
+static int key_io_open(key_io_t* io, int fd, size_t cap)
+{
+    io->fd = fd;
+    io->cap = cap;
+    io->pos = 0;
+    io->len = 0;
+    io->err = 0;
+    io->buf = (key_t*)malloc(cap * sizeof(key_t));
+    return io->buf ? 0 : fail("out of memory", ENOMEM);
+}
+
+// 다음 key가 없으면 0 (끝이거나 오류, 오류면 err)
+static int key_read(key_io_t* io, key_t* key)
+{
+    if (io->pos == io->len)
+    {
+        size_t got = 0;
+        char* p = (char*)io->buf;
+        // key 경계가 맞을 때까지 채움
+        while (got == 0 || got % sizeof(key_t) != 0)
+        {
+            ssize_t r = read(io->fd, p + got, io->cap * sizeof(key_t) - got);
+            if (r < 0 && errno == EINTR) continue;
+            if (r < 0)
+            {
+                io->err = 1;
+                fail("read", errno);
+                break;
+            }
+            if (r == 0)
+            {
+                if (got % sizeof(key_t) != 0)
+                {
+                    io->err = 1;
+                    fail("input size is not a multiple of key_t", 0);
+                }
+                break;
+            }
+            got += (size_t)r;
+        }
+        io->pos = 0;
+        io->len = got / sizeof(key_t);
+        if (io->len == 0) return 0;
+    }
+    *key = io->buf[io->pos++];
+    return 1;
+}
+
+static void key_flush(key_io_t* io)
+{
+    const char* p = (const char*)io->buf;
+    size_t left = io->len * sizeof(key_t);
+    while (left > 0 && !io->err)
+    {
+        ssize_t w = write(io->fd, p, left);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0)
+        {
+            io->err = 1;
+            fail("write", w < 0 ? errno : EIO);
+            break;
+        }
+        p += w;
+        left -= (size_t)w;
+    }
+    io->len = 0;
+}
+
+static inline void key_write(key_io_t* io, key_t key)
+{
+    if (io->len == io->cap)
+    {
+        key_flush(io);
+    }
+    io->buf[io->len++] = key;
+}
+
+// 버퍼를 비우고 fd를 닫음, 오류가 있었으면 -1
+static int key_io_close(key_io_t* io, int writing)
+{
+    if (writing)
+    {
+        key_flush(io);
+    }
+    free(io->buf);
+    int err = io->err;
+    if (io->fd > 2)
+    {
+        err = (close(io->fd) != 0 && fail("close", errno)) || err;
+    }
+    return err ? -1 : 0;
+}
+
+typedef struct {
+  char** paths;
+  size_t count;
+  size_t cap;
+} run_list_t;
+
+static const char* tmp_dir = "/tmp";
+
+// 임시 run 파일을 만들어 목록에 넣고 쓰기용 fd를 돌려줌
+static int run_create(run_list_t* runs)
+{
+    if (runs->count == runs->cap)
+    {
+        size_t cap = runs->cap ? runs->cap * 2 : 64;
+        char** paths = (char**)realloc(runs->paths, cap * sizeof(char*));
+        if (!paths) return fail("out of memory", ENOMEM);
+
+        runs->paths = paths;
+        runs->cap = cap;
+    }
+
+    size_t len = strlen(tmp_dir) + sizeof("/extsort-XXXXXX");
+    char* path = (char*)malloc(len);
+    if (!path) return fail("out of memory", ENOMEM);
+
+    snprintf(path, len, "%s/extsort-XXXXXX", tmp_dir);
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        fail("cannot create temporary run file", errno);
+        free(path);
+        return -1;
+    }
+    runs->paths[runs->count++] = path;
+    return fd;
+}
+
+static void run_remove(run_list_t* runs, size_t from, size_t to)
+{
+    for (size_t i = from; i < to; ++i)
+    {
+        if (!runs->paths[i]) continue;
+
+        unlink(runs->paths[i]);
+        free(runs->paths[i]);
+        runs->paths[i] = NULL;
+    }
+}
+
+/*
+ * replacement selection으로 input 전체를 run 파일들로 나눔
+ * cur: 지금 run에 들어갈 key, next: 방금 쓴 값보다 작아서 다음 run으로 미룬 key (합쳐서 memory개)
+ */
+static int make_runs(key_io_t* in, size_t memory, run_list_t* runs, size_t* total)
+{
+    node_arena* arena = node_arena_new(NODE_ARENA_THP);
+    rbtree* cur = new_rbtree();
+    rbtree* next = new_rbtree();
+    int err = !arena || !cur || !next || node_arena_attach(arena, cur) != 0 || node_arena_attach(arena, next) != 0;
+    if (err) fail("out of memory", ENOMEM);
+
+    key_t key;
+    *total = 0;
+    while (!err && cur->size < memory && key_read(in, &key))
+    {
+        err = rbtree_insert(cur, key) == NULL && fail("out of memory", ENOMEM);
+        (*total)++;
+    }
+
+    while (!err && cur->size > 0)
+    {
+        key_io_t out;
+        int fd = run_create(runs);
+        if (fd < 0 || key_io_open(&out, fd, EXTSORT_IO_BYTES / sizeof(key_t)) != 0)
+        {
+            if (fd >= 0) close(fd);
+            err = 1;
+            break;
+        }
+
+        while (cur->size > 0 && !err)
+        {
+            node_t* min = rbtree_min(cur);
+            key_t last = min->key;
+            rbtree_erase(cur, min);
+            key_write(&out, last);
+
+            if (key_read(in, &key))
+            {
+                err = rbtree_insert(key >= last ? cur : next, key) == NULL && fail("out of memory", ENOMEM);
+                (*total)++;
+            }
+        }
+        err = key_io_close(&out, 1) != 0 || err;
+
+        rbtree* t = cur;
+        cur = next;
+        next = t;
+    }
+    err = err || in->err;
+
+    delete_rbtree(cur);
+    delete_rbtree(next);
+    node_arena_delete(arena);
+    return err ? -1 : 0;
+}
+
+// merge 트리의 노드: 어느 run에서 온 key인지
+typedef struct {
+  node_t node;
+  size_t run;
+} merge_node_t;
+
+/*
+ * paths[0..k)의 정렬된 run들을 out으로 합침
+ */
+static int merge_runs(char** paths, size_t k, key_io_t* out, size_t bytes)
+{
+    if (k == 0) return 0;
+
+    // 메모리 한도를 run마다의 읽기 버퍼로 나눔
+    size_t per_run = bytes / sizeof(key_t) / k;
+    if (per_run < EXTSORT_MIN_RUN_IO)
+    {
+        per_run = EXTSORT_MIN_RUN_IO;
+    }
+    key_io_t* in = (key_io_t*)calloc(k, sizeof(key_io_t));
+    rbtree* heads = new_rbtree_augmented(sizeof(merge_node_t), NULL);
+    int err = (!in || !heads) && fail("out of memory", ENOMEM);
+
+    size_t opened = 0;
+    for (; !err && opened < k; ++opened)
+    {
+        int fd = open(paths[opened], O_RDONLY);
+        if (fd < 0) fail("cannot open temporary run file", errno);
+        if (fd < 0 || key_io_open(&in[opened], fd, per_run) != 0)
+        {
+            if (fd >= 0) close(fd);
+            err = 1;
+            break;
+        }
+
+        key_t key;
+        if (key_read(&in[opened], &key))
+        {
+            merge_node_t* x = (merge_node_t*)rbtree_insert(heads, key);
+            if (!x)
+            {
+                err = fail("out of memory", ENOMEM);
+                ++opened;
+                break;
+            }
+            x->run = opened;
+        }
+    }
+
+    while (!err && heads->size > 0)
+    {
+        merge_node_t* min = (merge_node_t*)rbtree_min(heads);
+        size_t run = min->run;
+        key_write(out, min->node.key);
+        rbtree_erase(heads, &min->node);
+
+        key_t key;
+        if (key_read(&in[run], &key))
+        {
+            merge_node_t* x = (merge_node_t*)rbtree_insert(heads, key);
+            if (!x)
+            {
+                err = fail("out of memory", ENOMEM);
+                break;
+            }
+            x->run = run;
+        }
+    }
+
+    for (size_t i = 0; i < opened; ++i)
+    {
+        int close_err = key_io_close(&in[i], 0) != 0;
+        err = in[i].err || close_err || err;
+    }
+    delete_rbtree(heads);
+    free(in);
+    return err || out->err ? -1 : 0;
+}
+
+/*
+ * run이 fan_in개 이하가 될 때까지 fan_in개씩 묶어 합친 뒤 마지막으로 out에 합침, 합친 단계 수를 돌려줌 (실패면 -1)
+ */
+static int merge_all(run_list_t* runs, size_t fan_in, key_io_t* out, size_t bytes)
+{
+    size_t first = 0;  // 아직 합치지 않은 run의 시작
+    int passes = 0;
+    while (runs->count - first > fan_in)
+    {
+        size_t end = runs->count;
+        for (size_t i = first; i < end; i += fan_in)
+        {
+            size_t k = end - i < fan_in ? end - i : fan_in;
+            key_io_t merged;
+            int fd = run_create(runs);
+            if (fd < 0 || key_io_open(&merged, fd, EXTSORT_IO_BYTES / sizeof(key_t)) != 0)
+            {
+                if (fd >= 0) close(fd);
+                return -1;
+            }
+
+            int err = merge_runs(runs->paths + i, k, &merged, bytes);
+            if (key_io_close(&merged, 1) != 0 || err != 0) return -1;
+
+            run_remove(runs, i, i + k);
+        }
+        first = end;
+        passes++;
+    }
+
+    if (merge_runs(runs->paths + first, runs->count - first, out, bytes) != 0) return -1;
+
+    run_remove(runs, first, runs->count);
+    return passes + 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: extsort [-m MiB] [-k fan-in] [-T tmpdir] [-v] <in|-> <out|->\n"
+                    "  sorts a file of native-endian key_t (%zu-byte) keys\n"
+                    "  -m  memory for tree nodes and merge buffers (default 64)\n"
+                    "  -k  runs merged at once (default 64)\n",
+            sizeof(key_t));
+}
+
+int main(int argc, char* argv[])
+{
+    size_t mib = 64;
+    size_t fan_in = 64;
+    int verbose = 0;
+    const char* env_tmp = getenv("TMPDIR");
+    if (env_tmp && *env_tmp)
+    {
+        tmp_dir = env_tmp;
+    }
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:k:T:v")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm':
+            mib = strtoul(optarg, NULL, 10);
+            break;
+        case 'k':
+            fan_in = strtoul(optarg, NULL, 10);
+            break;
+        case 'T':
+            tmp_dir = optarg;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            usage();
+            return 2;
+        }
+    }
+    if (argc - optind != 2 || mib == 0 || fan_in < 2)
+    {
+        usage();
+        return 2;
+    }
+
+    const char* in_path = argv[optind];
+    const char* out_path = argv[optind + 1];
+    int in_fd = strcmp(in_path, "-") == 0 ? 0 : open(in_path, O_RDONLY);
+    if (in_fd < 0)
+    {
+        fprintf(stderr, "extsort: cannot open %s: %s\n", in_path, strerror(errno));
+        return 1;
+    }
+    // 출력을 O_TRUNC로 열면 입력이 지워지므로 같은 파일이면 거부
+    struct stat in_st, out_st;
+    int out_exists = strcmp(out_path, "-") == 0 ? fstat(1, &out_st) == 0 : stat(out_path, &out_st) == 0;
+    if (fstat(in_fd, &in_st) == 0 && out_exists && S_ISREG(in_st.st_mode) && in_st.st_dev == out_st.st_dev &&
+        in_st.st_ino == out_st.st_ino)
+    {
+        fprintf(stderr, "extsort: %s and %s are the same file\n", in_path, out_path);
+        return 1;
+    }
+    int out_fd = strcmp(out_path, "-") == 0 ? 1 : open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0)
+    {
+        fprintf(stderr, "extsort: cannot open %s: %s\n", out_path, strerror(errno));
+        return 1;
+    }
+
+    // 트리 노드 하나 = node_t (arena에 빈틈 없이 놓임)
+    size_t bytes = mib * 1024 * 1024;
+    size_t memory = bytes / sizeof(node_t);
+    key_io_t in, out;
+    run_list_t runs = { NULL, 0, 0 };
+    size_t total = 0;
+    int passes = -1;
+
+    double t0 = now_sec();
+    int err = key_io_open(&in, in_fd, EXTSORT_IO_BYTES / sizeof(key_t)) != 0 ||
+              make_runs(&in, memory, &runs, &total) != 0;
+    size_t run_count = runs.count;
+    err = key_io_close(&in, 0) != 0 || err;
+    double t1 = now_sec();
+
+    if (!err)
+    {
+        err = key_io_open(&out, out_fd, EXTSORT_IO_BYTES / sizeof(key_t)) != 0;
+        if (!err)
+        {
+            passes = merge_all(&runs, fan_in, &out, bytes);
+            err = key_io_close(&out, 1) != 0 || passes < 0;
+        }
+    }
+    double t2 = now_sec();
+
+    run_remove(&runs, 0, runs.count);
+    free(runs.paths);
+    if (err)
+    {
+        if (!fail_step)
+        {
+            fail_step = "out of memory";
+            fail_errno = ENOMEM;
+        }
+        fprintf(stderr, "extsort: %s%s%s\n", fail_step, fail_errno ? ": " : "", fail_errno ? strerror(fail_errno) : "");
+        return 1;
+    }
+
+    if (verbose)
+    {
+        fprintf(stderr, "%zu keys, memory %zu keys\n", total, memory);
+        fprintf(stderr, "runs: %zu, average %.2fx memory, %.3f s\n", run_count,
+                run_count ? (double)total / run_count / memory : 0.0, t1 - t0);
+        fprintf(stderr, "merge: %d pass%s (fan-in %zu), %.3f s\n", passes, passes == 1 ? "" : "es", fan_in, t2 - t1);
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+#include "fctree.h"
+#include "finger.h"
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define FC_SLOTS 64         // 동시에 연산을 올릴 수 있는 스레드 수 (넘으면 빈 슬롯이 날 때까지 기다림)
+#define FC_LINE 64          // 캐시 라인 크기, 슬롯끼리 같은 줄을 쓰지 않도록
+#define FC_PASSES 4         // combiner가 락을 놓기 전에 슬롯을 훑는 최대 횟수
+#define FC_SPINS 64         // 이만큼 돌고도 안 끝나면 CPU를 양보
+
+enum { FC_FREE, FC_CLAIMED, FC_PENDING, FC_DONE };
+enum { FC_INSERT = 1, FC_ERASE, FC_FIND };
+
+typedef struct {
+  _Alignas(FC_LINE) atomic_int state;
+  int op;
+  key_t key;
+  int result;
+} fc_slot_t;
+
+struct fctree {
+  _Alignas(FC_LINE) atomic_int lock;
+  rbtree *tree;
+  fc_slot_t slots[FC_SLOTS];
+};
+
+// 스레드마다 처음 보는 슬롯 (보통은 이 슬롯만 씀)
+static atomic_uint fc_next_thread;
+static _Thread_local unsigned int fc_thread_slot = UINT_MAX;
+
+fctree* new_fctree(void)
+{
+    fctree* fc = (fctree*)aligned_alloc(FC_LINE, sizeof(fctree));
+    if (!fc) return NULL;
+
+    memset(fc, 0, sizeof(fctree));
+    fc->tree = new_rbtree();
+    if (!fc->tree)
+    {
+        free(fc);
+        return NULL;
+    }
+    return fc;
+}
+
+void delete_fctree(fctree* fc)
+{
+    if (!fc) return;
+
+    delete_rbtree(fc->tree);
+    free(fc);
+}
+
+rbtree* fctree_tree(fctree* fc)
+{
+    return fc->tree;
+}
+
+/*
+ * key 순으로 정렬된 batch를 적용, finger는 지금까지 처리한 key 이하의 살아 있는 노드
+ */
+static void apply_batch(rbtree* tree, fc_slot_t** batch, size_t m)
+{
+    node_t* finger = tree->nil;
+    for (size_t i = 0; i < m; ++i)
+    {
+        fc_slot_t* slot = batch[i];
+        node_t* node;
+        switch (slot->op)
+        {
+        case FC_INSERT:
+            node = finger_insert(tree, finger, slot->key);
+            slot->result = node ? 0 : -1;
+            if (node) finger = node;
+            break;
+        case FC_ERASE:
+            node = finger_find(tree, finger, slot->key);
+            slot->result = node != NULL;
+            if (node)
+            {
+                // 앞 노드는 삭제로 해제되지 않음
+                finger = rbtree_prev(tree, node);
+                rbtree_erase(tree, node);
+            }
+            break;
+        default:
+            node = finger_find(tree, finger, slot->key);
+            slot->result = node != NULL;
+            if (node) finger = node;
+            break;
+        }
+        atomic_store_explicit(&slot->state, FC_DONE, memory_order_release);
+    }
+}
+
+/*
+ * 락을 잡은 스레드가 올라온 연산을 모아서 처리
+ * 처리하는 동안 새로 올라온 것도 몇 번 더 훑어서 같이 처리
+ */
+static void combine(fctree* fc)
+{
+    fc_slot_t* batch[FC_SLOTS];
+
+    for (int pass = 0; pass < FC_PASSES; ++pass)
+    {
+        size_t m = 0;
+        for (size_t i = 0; i < FC_SLOTS; ++i)
+        {
+            fc_slot_t* slot = &fc->slots[i];
+            if (atomic_load_explicit(&slot->state, memory_order_acquire) != FC_PENDING) continue;
+
+            // key 순 삽입 정렬 (많아야 FC_SLOTS개)
+            size_t j = m++;
+            for (; j > 0 && batch[j - 1]->key > slot->key; --j)
+            {
+                batch[j] = batch[j - 1];
+            }
+            batch[j] = slot;
+        }
+        if (m == 0) break;
+
+        apply_batch(fc->tree, batch, m);
+    }
+}
+
+static inline int try_lock(fctree* fc)
+{
+    return !atomic_load_explicit(&fc->lock, memory_order_relaxed) &&
+           !atomic_exchange_explicit(&fc->lock, 1, memory_order_acquire);
+}
+
+static inline void cpu_relax(unsigned int spins)
+{
+    if (spins < FC_SPINS)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    else
+    {
+        sched_yield();
+    }
+}
+
+/*
+ * 빈 슬롯을 잡아 연산을 올리고, 누군가(자기 자신일 수도) 처리할 때까지 기다림
+ */
+static int submit(fctree* fc, int op, const key_t key)
+{
+    if (fc_thread_slot == UINT_MAX)
+    {
+        fc_thread_slot = atomic_fetch_add_explicit(&fc_next_thread, 1, memory_order_relaxed) % FC_SLOTS;
+    }
+
+    fc_slot_t* slot;
+    for (unsigned int i = fc_thread_slot, spins = 0;; i = (i + 1) % FC_SLOTS)
+    {
+        slot = &fc->slots[i];
+        int expected = FC_FREE;
+        if (atomic_load_explicit(&slot->state, memory_order_relaxed) == FC_FREE &&
+            atomic_compare_exchange_strong_explicit(&slot->state, &expected, FC_CLAIMED, memory_order_acquire,
+                                                    memory_order_relaxed))
+        {
+            break;
+        }
+        if (i % FC_SLOTS == FC_SLOTS - 1)
+        {
+            cpu_relax(spins++);
+        }
+    }
+
+    slot->op = op;
+    slot->key = key;
+    atomic_store_explicit(&slot->state, FC_PENDING, memory_order_release);
+
+    for (unsigned int spins = 0; atomic_load_explicit(&slot->state, memory_order_acquire) != FC_DONE;)
+    {
+        if (try_lock(fc))
+        {
+            combine(fc);
+            atomic_store_explicit(&fc->lock, 0, memory_order_release);
+            continue;
+        }
+        cpu_relax(spins++);
+    }
+
+    int result = slot->result;
+    atomic_store_explicit(&slot->state, FC_FREE, memory_order_release);
+    return result;
+}
+
+int fctree_insert(fctree* fc, const key_t key)
+{
+    return submit(fc, FC_INSERT, key);
+}
+
+int fctree_erase(fctree* fc, const key_t key)
+{
+    return submit(fc, FC_ERASE, key);
+}
+
+int fctree_find(fctree* fc, const key_t key)
+{
+    return submit(fc, FC_FIND, key);
+}
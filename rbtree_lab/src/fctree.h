@@ -0,0 +1,34 @@
+#ifndef _FCTREE_H_
+#define _FCTREE_H_
+
+#include "rbtree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 여러 스레드가 같이 쓰는 rbtree (flat combining)
+// 스레드는 자기 슬롯에 연산을 올려 두고, 락을 잡은 스레드 하나(combiner)가 올라온 연산을 모아서 한 번에 적용
+// - 락을 잡으려고 경쟁하는 대신 각자 자기 슬롯만 보며 기다리므로 락 캐시 라인이 코어 사이를 덜 오감
+// - 모은 연산은 key 순으로 정렬해서 직전 위치부터 이어서 찾음 (루트부터 매번 내려가지 않음)
+// 노드 포인터는 다른 스레드가 바로 지울 수 있어서 결과는 성공 여부만 돌려줌
+typedef struct fctree fctree;
+
+fctree *new_fctree(void);
+void delete_fctree(fctree *);
+
+// 실패(할당 실패)면 -1
+int fctree_insert(fctree *, const key_t);
+// key 노드 하나를 지웠으면 1, 없으면 0
+int fctree_erase(fctree *, const key_t);
+// 있으면 1
+int fctree_find(fctree *, const key_t);
+
+// 안쪽 트리, 다른 스레드가 연산 중이 아닐 때만 사용 (lazy erase/top-K/색인은 켜면 안 됨)
+rbtree *fctree_tree(fctree *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _FCTREE_H_
@@ -0,0 +1,49 @@
+#ifndef _FINGER_H_
+#define _FINGER_H_
+
+#include "rbtree.h"
+
+// key 순으로 정렬된 연산 묶음을 적용하는 쪽(fctree.c, ingest.c) 내부용
+// finger = 직전에 처리한 key 이하의 살아 있는 노드 (처음엔 nil), 다음 key는 루트 대신 finger에서 찾기 시작
+
+/*
+ * finger에서 key가 들어갈 범위를 덮는 서브트리 루트까지 올라감
+ * 왼쪽 자식이면서 부모 key가 key보다 크면 그 서브트리 범위 안 -> 거기서 멈춤
+ */
+static inline node_t *finger_climb(const rbtree *tree, node_t *x, const key_t key)
+{
+  if (x == tree->nil) return tree->root;
+
+  while (x->parent != tree->nil && !(x == x->parent->left && key < x->parent->key)) {
+    x = x->parent;
+  }
+  return x;
+}
+
+static inline node_t *finger_find(const rbtree *tree, node_t *finger, const key_t key)
+{
+  // finger->key <= key라서, 범위의 아래 경계와 같은 key는 finger 자신뿐
+  if (finger != tree->nil && finger->key == key) return finger;
+
+  for (node_t *x = finger_climb(tree, finger, key); x != tree->nil;) {
+    if (key == x->key) return x;
+    x = (key < x->key) ? x->left : x->right;
+  }
+  return NULL;
+}
+
+static inline node_t *finger_insert(rbtree *tree, node_t *finger, const key_t key)
+{
+  node_t *node = rbtree_alloc_node(tree, key);
+  if (!node) return NULL;
+
+  node_t *y = tree->nil;
+  for (node_t *x = finger_climb(tree, finger, key); x != tree->nil;) {
+    y = x;
+    x = (key < x->key) ? x->left : x->right;
+  }
+  rbtree_link_node(tree, y, y != tree->nil && key < y->key, node);
+  return node;
+}
+
+#endif  // _FINGER_H_
@@ -0,0 +1,154 @@
+#include "hash_index.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+// 칸이 절반 넘게 차면 두 배로 늘림
+#define HASH_INDEX_MIN_SLOTS 16
+
+static inline size_t hash_key(key_t key, size_t mask)
+{
+    // Fibonacci hashing: 상위 비트가 잘 섞이므로 위쪽을 씀
+    unsigned long long h = (unsigned long long)(unsigned int)key * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h >> 32) & mask;
+}
+
+hash_index* hash_index_new(size_t expected)
+{
+    size_t slots = HASH_INDEX_MIN_SLOTS;
+    while (slots < expected * 2)
+    {
+        slots <<= 1;
+    }
+
+    hash_index* idx = (hash_index*)calloc(1, sizeof(hash_index));
+    if (!idx) return NULL;
+
+    idx->slots = (hash_slot_t*)calloc(slots, sizeof(hash_slot_t));
+    if (!idx->slots)
+    {
+        free(idx);
+        return NULL;
+    }
+    idx->mask = slots - 1;
+    return idx;
+}
+
+void hash_index_free(hash_index* idx)
+{
+    if (!idx) return;
+
+    free(idx->slots);
+    free(idx);
+}
+
+/*
+ * 칸 배열은 그대로 두고 비움
+ */
+void hash_index_clear(hash_index* idx)
+{
+    memset(idx->slots, 0, (idx->mask + 1) * sizeof(hash_slot_t));
+    idx->count = 0;
+}
+
+node_t* hash_index_get(const hash_index* idx, const key_t key)
+{
+    size_t i = hash_key(key, idx->mask);
+
+    while (idx->slots[i].node)
+    {
+        if (idx->slots[i].key == key)
+        {
+            return idx->slots[i].node;
+        }
+        i = (i + 1) & idx->mask;
+    }
+    return NULL;
+}
+
+static int hash_index_grow(hash_index* idx)
+{
+    size_t old_slots = idx->mask + 1;
+    hash_slot_t* old = idx->slots;
+    hash_slot_t* slots = (hash_slot_t*)calloc(old_slots * 2, sizeof(hash_slot_t));
+    if (!slots) return -1;
+
+    idx->slots = slots;
+    idx->mask = old_slots * 2 - 1;
+    for (size_t j = 0; j < old_slots; ++j)
+    {
+        if (!old[j].node) continue;
+
+        size_t i = hash_key(old[j].key, idx->mask);
+        while (slots[i].node)
+        {
+            i = (i + 1) & idx->mask;
+        }
+        slots[i] = old[j];
+    }
+    free(old);
+    return 0;
+}
+
+/*
+ * key가 이미 있으면 노드만 바꿔 끼움
+ */
+int hash_index_put(hash_index* idx, const key_t key, node_t* node)
+{
+    size_t i = hash_key(key, idx->mask);
+    while (idx->slots[i].node)
+    {
+        if (idx->slots[i].key == key)
+        {
+            idx->slots[i].node = node;
+            return 0;
+        }
+        i = (i + 1) & idx->mask;
+    }
+
+    if ((idx->count + 1) * 2 > idx->mask + 1)
+    {
+        if (hash_index_grow(idx) != 0) return -1;
+
+        i = hash_key(key, idx->mask);
+        while (idx->slots[i].node)
+        {
+            i = (i + 1) & idx->mask;
+        }
+    }
+
+    idx->slots[i].key = key;
+    idx->slots[i].node = node;
+    idx->count++;
+    return 0;
+}
+
+/*
+ * backward shift 삭제: tombstone 없이 뒤에 있던 항목들을 자기 자리 쪽으로 당김
+ */
+void hash_index_remove(hash_index* idx, const key_t key)
+{
+    size_t i = hash_key(key, idx->mask);
+
+    while (idx->slots[i].node && idx->slots[i].key != key)
+    {
+        i = (i + 1) & idx->mask;
+    }
+    if (!idx->slots[i].node) return;
+
+    size_t hole = i;
+    for (;;)
+    {
+        i = (i + 1) & idx->mask;
+        if (!idx->slots[i].node) break;
+
+        // i의 원래 자리(home)가 (hole, i] 사이면 못 당김
+        size_t home = hash_key(idx->slots[i].key, idx->mask);
+        if (((i - home) & idx->mask) < ((i - hole) & idx->mask)) continue;
+
+        idx->slots[hole] = idx->slots[i];
+        hole = i;
+    }
+    idx->slots[hole].node = NULL;
+    idx->count--;
+}
@@ -0,0 +1,28 @@
+#ifndef _HASH_INDEX_H_
+#define _HASH_INDEX_H_
+
+#include "rbtree.h"
+
+// rbtree.c 내부용: key -> node_t* open addressing (linear probing) 해시
+// 같은 key가 여러 개면 그중 아무 노드 하나만 가리킴
+
+typedef struct {
+  key_t key;
+  node_t *node;  // NULL이면 빈 칸
+} hash_slot_t;
+
+typedef struct hash_index {
+  hash_slot_t *slots;
+  size_t mask;   // 칸 수 - 1 (2의 거듭제곱)
+  size_t count;
+} hash_index;
+
+hash_index *hash_index_new(size_t expected);
+void hash_index_free(hash_index *);
+void hash_index_clear(hash_index *);
+
+node_t *hash_index_get(const hash_index *, const key_t);
+int hash_index_put(hash_index *, const key_t, node_t *);
+void hash_index_remove(hash_index *, const key_t);
+
+#endif  // _HASH_INDEX_H_
@@ -0,0 +1,258 @@
+#include "ingest.h"
+#include "finger.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define ASYNC_CAPACITY 65536  // 기본 링 크기 (연산 수)
+#define ASYNC_BATCH 4096      // 적용 스레드가 한 번에 꺼내 정렬하는 최대 연산 수
+#define ASYNC_LINE 64         // 캐시 라인 크기, 올리는 쪽 카운터와 적용 쪽 카운터를 떨어뜨림
+#define ASYNC_SPINS 64        // 이만큼 돌고도 안 되면 CPU를 양보
+#define ASYNC_YIELDS 256      // 이만큼 양보하고도 안 되면 잠깐 잠
+
+enum { ASYNC_INSERT = 1, ASYNC_ERASE };
+
+/*
+ * 링의 칸: 자리 pos를 잡은 스레드가 op/key를 쓰고 나서 ready = pos + 1로 공개
+ * 적용 스레드는 head 칸부터 ready가 맞는 것까지만 꺼냄 (공개 순서와 상관없이 번호 순)
+ */
+typedef struct {
+  atomic_ullong ready;
+  int op;
+  key_t key;
+} async_slot_t;
+
+// 적용 스레드가 꺼내서 정렬하는 사본 (pos는 같은 key끼리 원래 순서를 지키는 데 씀)
+typedef struct {
+  key_t key;
+  int op;
+  unsigned long long pos;
+} async_op_t;
+
+struct rbtree_async {
+  _Alignas(ASYNC_LINE) atomic_ullong tail;  // 다음에 나눠 줄 자리 = 지금까지 올라온 연산 수
+  _Alignas(ASYNC_LINE) atomic_ullong head;  // 적용이 끝난 연산 수, 이 앞 칸은 다시 써도 됨
+  atomic_int stop;
+  rbtree *tree;
+  async_slot_t *ring;
+  size_t mask;
+  async_op_t *batch;
+  pthread_t applier;
+};
+
+static void backoff(unsigned int spins)
+{
+    if (spins < ASYNC_SPINS)
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+    else if (spins < ASYNC_SPINS + ASYNC_YIELDS)
+    {
+        sched_yield();
+    }
+    else
+    {
+        struct timespec ts = { 0, 50000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static int compare_op(const void* a, const void* b)
+{
+    const async_op_t* x = (const async_op_t*)a;
+    const async_op_t* y = (const async_op_t*)b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->pos < y->pos ? -1 : 1;
+}
+
+/*
+ * key 순 묶음 적용 (fctree와 같은 finger 방식)
+ * 같은 key는 pos 순이라 insert/erase가 올라온 순서 그대로 적용됨
+ */
+static void apply_batch(rbtree* tree, const async_op_t* ops, size_t m)
+{
+    node_t* finger = tree->nil;
+    for (size_t i = 0; i < m; ++i)
+    {
+        node_t* node;
+        if (ops[i].op == ASYNC_INSERT)
+        {
+            // 할당 실패는 알려 줄 곳이 없어서 그 연산만 버림
+            node = finger_insert(tree, finger, ops[i].key);
+            if (node) finger = node;
+        }
+        else
+        {
+            node = finger_find(tree, finger, ops[i].key);
+            if (node)
+            {
+                // 앞 노드는 삭제로 해제되지 않음
+                finger = rbtree_prev(tree, node);
+                rbtree_erase(tree, node);
+            }
+        }
+    }
+}
+
+/*
+ * 색인/top-K/lazy erase/트레이스가 켜진 트리는 finger 경로가 그 처리를 건너뛰므로
+ * rbtree_insert/rbtree_find/rbtree_erase로 하나씩 적용 (정렬된 순서라 캐시 지역성은 그대로)
+ */
+static int plain_tree(const rbtree* tree)
+{
+    return !tree->index && !tree->capacity && tree->lazy_ratio <= 0 && tree->dead_count == 0 && !tree->trace;
+}
+
+static void apply_each(rbtree* tree, const async_op_t* ops, size_t m)
+{
+    for (size_t i = 0; i < m; ++i)
+    {
+        if (ops[i].op == ASYNC_INSERT)
+        {
+            rbtree_insert(tree, ops[i].key);
+        }
+        else
+        {
+            node_t* node = rbtree_find(tree, ops[i].key);
+            if (node) rbtree_erase(tree, node);
+        }
+    }
+}
+
+/*
+ * 공개된 연산을 번호 순으로 ASYNC_BATCH개까지 꺼내 정렬, 적용한 뒤 head를 넘겨 칸을 돌려줌
+ * stop이 켜져 있고 올라온 연산을 다 적용했으면 끝
+ */
+static void* applier_main(void* arg)
+{
+    rbtree_async* as = (rbtree_async*)arg;
+    unsigned long long head = atomic_load_explicit(&as->head, memory_order_relaxed);
+
+    for (unsigned int spins = 0;;)
+    {
+        size_t m = 0;
+        for (; m < ASYNC_BATCH; ++m)
+        {
+            async_slot_t* slot = &as->ring[(head + m) & as->mask];
+            if (atomic_load_explicit(&slot->ready, memory_order_acquire) != head + m + 1) break;
+
+            as->batch[m] = (async_op_t){ slot->key, slot->op, head + m };
+        }
+
+        if (m == 0)
+        {
+            if (atomic_load_explicit(&as->stop, memory_order_acquire) &&
+                atomic_load_explicit(&as->tail, memory_order_acquire) == head)
+            {
+                break;
+            }
+            backoff(spins++);
+            continue;
+        }
+        spins = 0;
+
+        qsort(as->batch, m, sizeof(async_op_t), compare_op);
+        if (plain_tree(as->tree))
+        {
+            apply_batch(as->tree, as->batch, m);
+        }
+        else
+        {
+            apply_each(as->tree, as->batch, m);
+        }
+        head += m;
+        atomic_store_explicit(&as->head, head, memory_order_release);
+    }
+    return NULL;
+}
+
+rbtree_async* rbtree_async_start(rbtree* tree, size_t capacity)
+{
+    size_t cap = 1;
+    while (cap < (capacity ? capacity : ASYNC_CAPACITY))
+    {
+        cap <<= 1;
+    }
+
+    rbtree_async* as = (rbtree_async*)aligned_alloc(ASYNC_LINE, sizeof(rbtree_async));
+    if (!as) return NULL;
+
+    memset(as, 0, sizeof(rbtree_async));
+    as->tree = tree;
+    as->mask = cap - 1;
+    as->ring = (async_slot_t*)calloc(cap, sizeof(async_slot_t));
+    as->batch = (async_op_t*)malloc(ASYNC_BATCH * sizeof(async_op_t));
+    if (!as->ring || !as->batch || pthread_create(&as->applier, NULL, applier_main, as) != 0)
+    {
+        free(as->ring);
+        free(as->batch);
+        free(as);
+        return NULL;
+    }
+    return as;
+}
+
+void rbtree_async_stop(rbtree_async* as)
+{
+    if (!as) return;
+
+    atomic_store_explicit(&as->stop, 1, memory_order_release);
+    pthread_join(as->applier, NULL);
+    free(as->ring);
+    free(as->batch);
+    free(as);
+}
+
+/*
+ * 자리를 잡고, 링이 한 바퀴 돌아 그 칸이 아직 적용 전이면 빌 때까지 기다린 뒤 공개
+ */
+static uint64_t submit(rbtree_async* as, int op, const key_t key)
+{
+    unsigned long long pos = atomic_fetch_add_explicit(&as->tail, 1, memory_order_relaxed);
+    for (unsigned int spins = 0; pos - atomic_load_explicit(&as->head, memory_order_acquire) > as->mask;)
+    {
+        backoff(spins++);
+    }
+
+    async_slot_t* slot = &as->ring[pos & as->mask];
+    slot->op = op;
+    slot->key = key;
+    atomic_store_explicit(&slot->ready, pos + 1, memory_order_release);
+    return pos + 1;
+}
+
+uint64_t rbtree_insert_async(rbtree_async* as, const key_t key)
+{
+    return submit(as, ASYNC_INSERT, key);
+}
+
+uint64_t rbtree_erase_async(rbtree_async* as, const key_t key)
+{
+    return submit(as, ASYNC_ERASE, key);
+}
+
+uint64_t rbtree_async_applied(const rbtree_async* as)
+{
+    return atomic_load_explicit(&as->head, memory_order_acquire);
+}
+
+void rbtree_async_wait(rbtree_async* as, uint64_t seq)
+{
+    for (unsigned int spins = 0; atomic_load_explicit(&as->head, memory_order_acquire) < seq;)
+    {
+        backoff(spins++);
+    }
+}
+
+uint64_t rbtree_async_flush(rbtree_async* as)
+{
+    uint64_t seq = atomic_load_explicit(&as->tail, memory_order_acquire);
+    rbtree_async_wait(as, seq);
+    return seq;
+}
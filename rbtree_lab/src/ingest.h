@@ -0,0 +1,42 @@
+#ifndef _INGEST_H_
+#define _INGEST_H_
+
+#include "rbtree.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 비동기 insert/erase: 여러 스레드가 연산을 링 버퍼에 올리기만 하고 바로 돌아오며,
+// 전용 적용 스레드 하나가 쌓인 연산을 key 순으로 정렬한 묶음으로 트리에 적용
+// - 올리는 쪽은 락 없이 자리 하나를 잡아(fetch_add) 쓰고 끝 -> 트리 크기와 상관없이 거의 일정한 시간
+// - 링이 가득 차면 적용 스레드가 자리를 비울 때까지 기다림 (capacity로 조절)
+// - 같은 key에 대한 연산끼리는 올린 순서대로 적용됨
+// - 색인/top-K/lazy erase/트레이스가 켜진 트리는 rbtree_insert/rbtree_erase와 똑같이 적용 (finger 탐색 대신 루트부터)
+// 시작부터 rbtree_async_stop까지 트리는 적용 스레드 것: 다른 스레드는 트리를 건드리면 안 됨
+// (예외: 올리는 스레드가 없을 때 rbtree_async_flush가 돌아온 뒤에는 읽어도 됨)
+typedef struct rbtree_async rbtree_async;
+
+// capacity: 링에 쌓아 둘 수 있는 연산 수 (2의 거듭제곱으로 올림, 0이면 기본값)
+rbtree_async *rbtree_async_start(rbtree *, size_t capacity);
+// 쌓인 연산을 모두 적용하고 적용 스레드를 끝냄, 올리는 스레드가 모두 끝난 뒤에 호출
+void rbtree_async_stop(rbtree_async *);
+
+// 연산 번호(1부터 증가)를 돌려줌, 결과(erase할 key가 없었는지 등)는 알려 주지 않음
+uint64_t rbtree_insert_async(rbtree_async *, const key_t);
+// key 노드 하나를 지움 (없으면 아무 일 없음)
+uint64_t rbtree_erase_async(rbtree_async *, const key_t);
+
+// 번호 seq까지의 연산이 모두 트리에 적용될 때까지 기다림 (read-your-writes)
+void rbtree_async_wait(rbtree_async *, uint64_t seq);
+// 지금까지 올라온 연산이 모두 적용될 때까지 기다림, 마지막 번호를 돌려줌
+uint64_t rbtree_async_flush(rbtree_async *);
+// 적용이 끝난 마지막 번호
+uint64_t rbtree_async_applied(const rbtree_async *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _INGEST_H_
@@ -0,0 +1,97 @@
+#include "interval.h"
+
+
+/*
+ * max_hi 재계산: 자기 hi와 양쪽 서브트리의 max_hi 중 최대값
+ * 회전/삽입/삭제 때 rbtree.c에서 아래쪽 노드부터 불러줌
+ */
+static void interval_update(const rbtree* tree, node_t* node)
+{
+    interval_t* iv = (interval_t*)node;
+    key_t max_hi = iv->hi;
+
+    if (node->left != tree->nil && ((interval_t*)node->left)->max_hi > max_hi)
+    {
+        max_hi = ((interval_t*)node->left)->max_hi;
+    }
+    if (node->right != tree->nil && ((interval_t*)node->right)->max_hi > max_hi)
+    {
+        max_hi = ((interval_t*)node->right)->max_hi;
+    }
+
+    iv->max_hi = max_hi;
+}
+
+/*
+ * 구간 트리 생성 (lo를 key로 쓰는 augment 레드블랙트리)
+ */
+rbtree* new_interval_tree(void)
+{
+    return new_rbtree_augmented(sizeof(interval_t), interval_update);
+}
+
+/*
+ * [lo, hi) 구간 삽입, 빈 구간(lo >= hi)이나 할당 실패면 NULL
+ * 삭제는 rbtree_erase(tree, &iv->node)
+ */
+interval_t* interval_insert(rbtree* tree, const key_t lo, const key_t hi)
+{
+    if (!tree || lo >= hi) return NULL;
+
+    interval_t* iv = (interval_t*)rbtree_alloc_node(tree, lo);
+    if (!iv) return NULL;
+
+    iv->hi = hi;
+    iv->max_hi = hi;
+
+    rbtree_insert_node(tree, &iv->node);
+    return iv;
+}
+
+/*
+ * lo <= last && hi > from 인 구간을 중위순서로 수집
+ * max_hi <= from 인 서브트리, key > last 인 노드의 오른쪽 서브트리는 통째로 건너뜀
+ */
+static void query_rec(const rbtree* tree, node_t* node, key_t from, key_t last,
+                      interval_t** arr, size_t* i, size_t n_size)
+{
+    if (node == tree->nil || *i >= n_size) return;
+
+    interval_t* iv = (interval_t*)node;
+    if (iv->max_hi <= from) return;
+
+    query_rec(tree, node->left, from, last, arr, i, n_size);
+
+    // 오른쪽은 lo가 더 크거나 같으니 여기서 끊김
+    if (node->key > last || *i >= n_size) return;
+
+    if (iv->hi > from)
+    {
+        arr[(*i)++] = iv;
+    }
+
+    query_rec(tree, node->right, from, last, arr, i, n_size);
+}
+
+/*
+ * point를 포함하는 구간 (lo <= point < hi)
+ * 결과는 lo 오름차순, 최대 n개까지 채우고 채운 개수 반환
+ */
+size_t interval_stabbing(const rbtree* tree, const key_t point, interval_t** arr, const size_t n)
+{
+    size_t i = 0;
+    query_rec(tree, tree->root, point, point, arr, &i, n);
+    return i;
+}
+
+/*
+ * [lo, hi)와 겹치는 구간 (a.lo < hi && a.hi > lo)
+ */
+size_t interval_overlap(const rbtree* tree, const key_t lo, const key_t hi, interval_t** arr, const size_t n)
+{
+    if (lo >= hi) return 0;
+
+    size_t i = 0;
+    query_rec(tree, tree->root, lo, hi - 1, arr, &i, n);
+    return i;
+}
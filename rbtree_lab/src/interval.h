@@ -0,0 +1,20 @@
+#ifndef _INTERVAL_H_
+#define _INTERVAL_H_
+
+#include "rbtree.h"
+
+// [lo, hi) 구간, node.key가 lo
+typedef struct {
+  node_t node;
+  key_t hi;
+  key_t max_hi;  // 서브트리 안에서 가장 큰 hi
+} interval_t;
+
+rbtree *new_interval_tree(void);
+
+interval_t *interval_insert(rbtree *, const key_t lo, const key_t hi);
+
+size_t interval_stabbing(const rbtree *, const key_t point, interval_t **, const size_t);
+size_t interval_overlap(const rbtree *, const key_t lo, const key_t hi, interval_t **, const size_t);
+
+#endif  // _INTERVAL_H_
@@ -0,0 +1,290 @@
+#include "keystream.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define KEYSTREAM_MAGIC 0x52424b53u  // "RBKS"
+#define KEYSTREAM_VERSION 1
+#define KEYSTREAM_BLOCK 128             // 블록 하나의 key 차이 수
+#define KEYSTREAM_BUFFER (64 * 1024)
+#define KEYSTREAM_BLOCK_MAX (1 + KEYSTREAM_BLOCK * 4)  // 32비트 폭 블록
+
+// 이웃 key 차이를 32비트에 담음
+_Static_assert(sizeof(key_t) <= 4, "keystream stores key deltas in 32 bits");
+
+/*
+ * 블록 하나: 폭 b 한 바이트 + m개의 값을 아래 비트부터 b비트씩 이어 붙임 (마지막 바이트는 0으로 채움)
+ */
+static unsigned char* pack_block(unsigned char* p, const uint32_t* v, size_t m)
+{
+    uint32_t all = 0;
+    for (size_t i = 0; i < m; ++i)
+    {
+        all |= v[i];
+    }
+    int width = all ? 32 - __builtin_clz(all) : 0;
+    *p++ = (unsigned char)width;
+
+    uint64_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < m; ++i)
+    {
+        acc |= (uint64_t)v[i] << bits;
+        for (bits += width; bits >= 8; bits -= 8)
+        {
+            *p++ = (unsigned char)acc;
+            acc >>= 8;
+        }
+    }
+    if (bits > 0)
+    {
+        *p++ = (unsigned char)acc;
+    }
+    return p;
+}
+
+static const unsigned char* unpack_block(const unsigned char* p, int width, uint32_t* v, size_t m)
+{
+    const uint64_t mask = ((uint64_t)1 << width) - 1;
+    uint64_t acc = 0;
+    int bits = 0;
+    for (size_t i = 0; i < m; ++i)
+    {
+        for (; bits < width; bits += 8)
+        {
+            acc |= (uint64_t)*p++ << bits;
+        }
+        v[i] = (uint32_t)(acc & mask);
+        acc >>= width;
+        bits -= width;
+    }
+    return p;
+}
+
+static inline size_t block_bytes(int width, size_t m)
+{
+    return (m * (size_t)width + 7) / 8;
+}
+
+typedef struct {
+    keystream_write_t write;
+    void* ctx;
+    unsigned char* buf;
+    size_t len;
+    uint32_t deltas[KEYSTREAM_BLOCK];
+    size_t m;
+    key_t prev;
+    uint64_t count;
+    int err;
+} encoder_t;
+
+static void encoder_flush(encoder_t* enc)
+{
+    if (!enc->err && enc->len > 0)
+    {
+        enc->err = enc->write(enc->ctx, enc->buf, enc->len) != 0;
+    }
+    enc->len = 0;
+}
+
+static void encoder_block(encoder_t* enc)
+{
+    if (enc->len + KEYSTREAM_BLOCK_MAX > KEYSTREAM_BUFFER)
+    {
+        encoder_flush(enc);
+    }
+    enc->len = (size_t)(pack_block(enc->buf + enc->len, enc->deltas, enc->m) - enc->buf);
+    enc->m = 0;
+}
+
+static void encoder_header(encoder_t* enc, int64_t first)
+{
+    keystream_header_t header = { KEYSTREAM_MAGIC, KEYSTREAM_VERSION, enc->count, first };
+    memcpy(enc->buf, &header, sizeof(header));
+    enc->len = sizeof(header);
+}
+
+// 첫 key는 헤더에, 그 뒤로는 앞 key와의 차이를 모아 블록으로
+static void encode_visit(void* ctx, node_t* node, size_t rank)
+{
+    encoder_t* enc = (encoder_t*)ctx;
+    if (rank == 0)
+    {
+        encoder_header(enc, node->key);
+    }
+    else
+    {
+        enc->deltas[enc->m++] = (uint32_t)((int64_t)node->key - enc->prev);
+        if (enc->m == KEYSTREAM_BLOCK)
+        {
+            encoder_block(enc);
+        }
+    }
+    enc->prev = node->key;
+}
+
+int rbtree_encode(const rbtree* tree, keystream_write_t write, void* ctx)
+{
+    if (!tree || !write) return -1;
+
+    encoder_t enc = { .write = write, .ctx = ctx, .count = tree->size - tree->dead_count };
+    enc.buf = (unsigned char*)malloc(KEYSTREAM_BUFFER);
+    if (!enc.buf) return -1;
+
+    if (enc.count == 0)
+    {
+        encoder_header(&enc, 0);
+    }
+    rbtree_foreach(tree, encode_visit, &enc, 1);
+    if (enc.m > 0)
+    {
+        encoder_block(&enc);
+    }
+    encoder_flush(&enc);
+
+    free(enc.buf);
+    return enc.err ? -1 : 0;
+}
+
+typedef struct {
+    keystream_read_t read;
+    void* ctx;
+    unsigned char* buf;
+    size_t pos;
+    size_t end;
+    key_t keys[KEYSTREAM_BLOCK];
+    size_t next;       // keys에서 다음에 줄 위치
+    size_t ready;      // keys에 풀어 둔 수
+    uint64_t left;     // 아직 풀지 않은 차이 수
+    int64_t prev;
+} decoder_t;
+
+/*
+ * 버퍼에 need바이트가 있도록 남은 것을 앞으로 당기고 모자란 만큼만 읽음
+ * 흐름 끝 뒤의 바이트는 읽지 않으므로 같은 fd/파이프에 이어지는 데이터는 호출자가 그대로 읽을 수 있음
+ */
+static int decoder_fill(decoder_t* dec, size_t need)
+{
+    if (dec->end - dec->pos >= need) return 0;
+
+    memmove(dec->buf, dec->buf + dec->pos, dec->end - dec->pos);
+    dec->end -= dec->pos;
+    dec->pos = 0;
+    while (dec->end < need)
+    {
+        ssize_t r = dec->read(dec->ctx, dec->buf + dec->end, need - dec->end);
+        if (r <= 0) return -1;
+        dec->end += (size_t)r;
+    }
+    return 0;
+}
+
+static int decode_block(decoder_t* dec)
+{
+    size_t m = dec->left < KEYSTREAM_BLOCK ? (size_t)dec->left : KEYSTREAM_BLOCK;
+    if (decoder_fill(dec, 1) != 0) return -1;
+
+    // 다음 블록이 있으면 그 폭 바이트까지 한 번에 읽음 (블록마다 read 한 번)
+    int width = dec->buf[dec->pos++];
+    size_t need = block_bytes(width, m) + (dec->left > m);
+    if (width > 32 || decoder_fill(dec, need) != 0) return -1;
+
+    uint32_t deltas[KEYSTREAM_BLOCK];
+    dec->pos = (size_t)(unpack_block(dec->buf + dec->pos, width, deltas, m) - dec->buf);
+    for (size_t i = 0; i < m; ++i)
+    {
+        dec->prev += deltas[i];
+        dec->keys[i] = (key_t)dec->prev;
+        if (dec->keys[i] != dec->prev) return -1;
+    }
+    dec->left -= m;
+    dec->next = 0;
+    dec->ready = m;
+    return 0;
+}
+
+static int decode_next(void* ctx, key_t* key)
+{
+    decoder_t* dec = (decoder_t*)ctx;
+    if (dec->next == dec->ready && decode_block(dec) != 0) return -1;
+
+    *key = dec->keys[dec->next++];
+    return 0;
+}
+
+int rbtree_decode(rbtree* tree, keystream_read_t read, void* ctx)
+{
+    if (!tree || !read || tree->root != tree->nil) return -1;
+
+    decoder_t* dec = (decoder_t*)calloc(1, sizeof(decoder_t));
+    unsigned char* buf = (unsigned char*)malloc(KEYSTREAM_BUFFER);
+    int err = !dec || !buf;
+    if (!err)
+    {
+        dec->read = read;
+        dec->ctx = ctx;
+        dec->buf = buf;
+        err = decoder_fill(dec, sizeof(keystream_header_t)) != 0;
+    }
+
+    keystream_header_t header;
+    if (!err)
+    {
+        memcpy(&header, dec->buf, sizeof(header));
+        dec->pos = sizeof(header);
+        err = header.magic != KEYSTREAM_MAGIC || header.version != KEYSTREAM_VERSION ||
+              header.count > SIZE_MAX / sizeof(node_t) || (key_t)header.first != header.first;
+    }
+    if (!err && header.count > 0)
+    {
+        // 첫 key는 헤더에서 바로 꺼낼 수 있도록 풀어 둔 상태로 시작
+        dec->keys[0] = (key_t)header.first;
+        dec->ready = 1;
+        dec->prev = header.first;
+        dec->left = header.count - 1;
+        err = rbtree_build(tree, (size_t)header.count, decode_next, dec) != 0;
+    }
+
+    free(buf);
+    free(dec);
+    return err ? -1 : 0;
+}
+
+static int write_fd(void* ctx, const void* buf, size_t len)
+{
+    int fd = *(int*)ctx;
+    for (const char* p = (const char*)buf; len > 0;)
+    {
+        ssize_t w = write(fd, p, len);
+        if (w < 0)
+        {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+static ssize_t read_fd(void* ctx, void* buf, size_t len)
+{
+    int fd = *(int*)ctx;
+    for (;;)
+    {
+        ssize_t r = read(fd, buf, len);
+        if (r >= 0 || errno != EINTR) return r;
+    }
+}
+
+int rbtree_encode_fd(const rbtree* tree, int fd)
+{
+    return rbtree_encode(tree, write_fd, &fd);
+}
+
+int rbtree_decode_fd(rbtree* tree, int fd)
+{
+    return rbtree_decode(tree, read_fd, &fd);
+}
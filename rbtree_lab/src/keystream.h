@@ -0,0 +1,45 @@
+#ifndef _KEYSTREAM_H_
+#define _KEYSTREAM_H_
+
+#include "rbtree.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 트리의 key 전체를 정렬 순서대로 압축해서 흘려보내고(encode), 받은 흐름으로 바로 트리를 만듦(decode)
+// 배열(n * sizeof(key_t))을 통째로 만들지 않고 작은 버퍼 하나로 처리
+// 형식 = 헤더 [magic][version][count][첫 key] + 블록들
+//   블록 = 이웃 key 차이 128개(마지막은 남은 만큼)를 모두 담는 최소 비트 수 b (1바이트) + 차이마다 b비트씩
+//   key가 촘촘할수록 b가 작아짐 (연속 key면 128개에 17바이트)
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t count;
+  int64_t first;
+} keystream_header_t;
+
+// 쓸 바이트를 넘겨받아 처리, 실패면 0이 아닌 값
+typedef int (*keystream_write_t)(void *ctx, const void *buf, size_t len);
+// buf에 len바이트까지 채우고 채운 수를 반환 (끝이면 0, 실패면 음수), read(2)와 같은 약속
+typedef ssize_t (*keystream_read_t)(void *ctx, void *buf, size_t len);
+
+// 살아 있는 key 전체를 오름차순으로 인코딩해서 write에 넘김, 실패면 -1
+int rbtree_encode(const rbtree *, keystream_write_t write, void *ctx);
+int rbtree_encode_fd(const rbtree *, int fd);
+
+// 빈 트리에 흐름을 디코딩하면서 rbtree_build로 O(n)에 채움
+// 흐름의 마지막 바이트까지만 읽으므로 파이프/소켓에서 뒤에 이어지는 데이터는 그대로 남음
+// 형식이 틀렸거나 중간에 끊기면 트리는 빈 채로 -1
+int rbtree_decode(rbtree *, keystream_read_t read, void *ctx);
+int rbtree_decode_fd(rbtree *, int fd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _KEYSTREAM_H_
@@ -0,0 +1,180 @@
+#include "node_arena.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#define NODE_ARENA_CHUNK (2u << 20)  // huge page 하나
+#define NODE_ARENA_ALIGN 8
+
+#ifdef __linux__
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+/*
+ * 2MB 경계에 맞춘 익명 매핑: 넉넉히 잡고 앞뒤를 잘라냄 (THP는 정렬된 2MB 구간에만 적용)
+ */
+static void* map_aligned(size_t bytes)
+{
+    char* p = (char*)mmap(NULL, bytes * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+
+    char* aligned = (char*)(((uintptr_t)p + bytes - 1) & ~(uintptr_t)(bytes - 1));
+    if (aligned > p)
+    {
+        munmap(p, (size_t)(aligned - p));
+    }
+    munmap(aligned + bytes, (size_t)(p + bytes * 2 - (aligned + bytes)));
+    return aligned;
+}
+
+// 이 스레드가 도는 CPU의 NUMA 노드를 우선 (아직 페이지를 건드리지 않았으니 첫 접근부터 적용)
+static int bind_local(void* chunk, size_t bytes)
+{
+    unsigned int cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0 || node >= 64) return -1;
+
+    unsigned long mask = 1ul << node;
+    return (int)syscall(SYS_mbind, chunk, bytes, MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0);
+}
+#endif
+
+static void* chunk_alloc(node_arena* arena)
+{
+    void* chunk = NULL;
+#ifdef __linux__
+#ifdef MAP_HUGETLB
+    if (arena->flags & NODE_ARENA_HUGETLB)
+    {
+        chunk = mmap(NULL, NODE_ARENA_CHUNK, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (chunk == MAP_FAILED)
+        {
+            chunk = NULL;  // 예약된 huge page가 없음 -> THP로
+        }
+        else
+        {
+            arena->stats.hugetlb_chunks++;
+        }
+    }
+#endif
+    if (!chunk)
+    {
+        chunk = map_aligned(NODE_ARENA_CHUNK);
+        if (!chunk) return NULL;
+#ifdef MADV_HUGEPAGE
+        if ((arena->flags & (NODE_ARENA_THP | NODE_ARENA_HUGETLB)) &&
+            madvise(chunk, NODE_ARENA_CHUNK, MADV_HUGEPAGE) == 0)
+        {
+            arena->stats.thp_chunks++;
+        }
+#endif
+    }
+    if ((arena->flags & NODE_ARENA_NUMA_LOCAL) && bind_local(chunk, NODE_ARENA_CHUNK) == 0)
+    {
+        arena->stats.numa_chunks++;
+    }
+#else
+    chunk = aligned_alloc(NODE_ARENA_CHUNK, NODE_ARENA_CHUNK);
+    if (!chunk) return NULL;
+#endif
+    return chunk;
+}
+
+static void chunk_free(void* chunk)
+{
+#ifdef __linux__
+    munmap(chunk, NODE_ARENA_CHUNK);
+#else
+    free(chunk);
+#endif
+}
+
+node_arena* node_arena_new(int flags)
+{
+    node_arena* arena = (node_arena*)calloc(1, sizeof(node_arena));
+    if (arena)
+    {
+        arena->flags = flags;
+    }
+    return arena;
+}
+
+void node_arena_delete(node_arena* arena)
+{
+    if (!arena) return;
+
+    for (size_t i = 0; i < arena->stats.chunks; ++i)
+    {
+        chunk_free(arena->chunk_list[i]);
+    }
+    free(arena->chunk_list);
+    free(arena);
+}
+
+/*
+ * 해제된 칸이 있으면 그것부터, 없으면 chunk에서 잘라냄
+ * 새 칸은 아직 페이지를 건드리지 않았으므로 처음 쓰는(삽입하는) 스레드 쪽 메모리에 놓임 (first touch)
+ */
+static void* arena_alloc(void* ctx, size_t size)
+{
+    node_arena* arena = (node_arena*)ctx;
+    size = (size + NODE_ARENA_ALIGN - 1) & ~(size_t)(NODE_ARENA_ALIGN - 1);
+    if (arena->slot_size == 0)
+    {
+        arena->slot_size = size;
+    }
+    if (size != arena->slot_size) return NULL;
+
+    if (arena->free_list)
+    {
+        void* slot = arena->free_list;
+        arena->free_list = *(void**)slot;
+        return slot;
+    }
+
+    if (!arena->cursor || arena->cursor + size > arena->limit)
+    {
+        if (arena->stats.chunks == arena->chunk_cap)
+        {
+            size_t cap = arena->chunk_cap ? arena->chunk_cap * 2 : 16;
+            void** grown = (void**)realloc(arena->chunk_list, cap * sizeof(void*));
+            if (!grown) return NULL;
+            arena->chunk_list = grown;
+            arena->chunk_cap = cap;
+        }
+
+        char* chunk = (char*)chunk_alloc(arena);
+        if (!chunk) return NULL;
+
+        arena->chunk_list[arena->stats.chunks++] = chunk;
+        arena->stats.bytes += NODE_ARENA_CHUNK;
+        arena->cursor = chunk;
+        arena->limit = chunk + NODE_ARENA_CHUNK;
+    }
+
+    void* slot = arena->cursor;
+    arena->cursor += size;
+    return slot;
+}
+
+static void arena_dealloc(void* ctx, void* ptr, size_t size)
+{
+    node_arena* arena = (node_arena*)ctx;
+    (void)size;
+    *(void**)ptr = arena->free_list;
+    arena->free_list = ptr;
+}
+
+int node_arena_attach(node_arena* arena, rbtree* tree)
+{
+    if (!arena || !tree) return -1;
+
+    rbtree_allocator_t allocator = {arena_alloc, arena_dealloc, arena};
+    return rbtree_set_allocator(tree, &allocator);
+}
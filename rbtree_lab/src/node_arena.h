@@ -0,0 +1,51 @@
+#ifndef _NODE_ARENA_H_
+#define _NODE_ARENA_H_
+
+#include "rbtree.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 노드를 2MB chunk에 빽빽하게 모아 두는 할당자 (rbtree_set_allocator 훅)
+// calloc은 노드마다 흩어진 4K 페이지에 놓여 큰 트리의 탐색이 거의 매번 TLB 미스
+// -> chunk를 huge page로 받으면 노드 5만 개쯤이 TLB 항목 하나를 같이 씀
+// 시스템이 지원하지 않는 옵션은 조용히 건너뛰고 일반 페이지로 동작 (어떻게 됐는지는 stats로 확인)
+
+enum {
+  NODE_ARENA_THP = 1 << 0,         // madvise(MADV_HUGEPAGE)로 transparent huge page 요청
+  NODE_ARENA_HUGETLB = 1 << 1,     // 예약된 huge page(MAP_HUGETLB)를 먼저 시도, 없으면 THP로
+  NODE_ARENA_NUMA_LOCAL = 1 << 2,  // chunk를 받은 스레드의 NUMA 노드를 우선하도록 mbind
+};
+
+typedef struct {
+  size_t chunks;
+  size_t hugetlb_chunks;  // MAP_HUGETLB로 받은 chunk
+  size_t thp_chunks;      // madvise(MADV_HUGEPAGE)가 받아들여진 chunk
+  size_t numa_chunks;     // mbind가 성공한 chunk
+  size_t bytes;
+} node_arena_stats_t;
+
+typedef struct node_arena {
+  int flags;
+  size_t slot_size;  // 처음 할당한 크기 (한 arena는 한 가지 노드 크기만)
+  char *cursor;      // 지금 chunk에서 아직 안 쓴 부분
+  char *limit;
+  void *free_list;   // 해제된 칸 (첫 워드로 연결)
+  void **chunk_list;
+  size_t chunk_cap;
+  node_arena_stats_t stats;
+} node_arena;
+
+node_arena *node_arena_new(int flags);
+// 이 arena를 쓰는 트리를 모두 해제한 뒤에 부름
+void node_arena_delete(node_arena *);
+
+// 빈 트리의 노드 할당을 arena로 (rbtree_set_allocator), 실패하면 -1
+int node_arena_attach(node_arena *, rbtree *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _NODE_ARENA_H_
@@ -0,0 +1,362 @@
+#include "rbtree.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+
+/*
+ * rbtree.h 핵심 API를 정수 key 전용 radix trie로 구현한 비교용 backend (librbtree-radix.a)
+ * key를 부호 비트를 뒤집은 32비트 값으로 보고 6비트씩 잘라 6단계로 내려감 (맨 위는 2비트만 씀)
+ *   - trie 노드 = 어떤 자식이 있는지 나타내는 64비트 bitmap + 있는 자식만 모은 배열
+ *     (자식 d의 위치 = bitmap에서 d 아래 비트 수), 마지막 단계의 자식은 그 key의 node_t
+ *   - find/insert는 key 길이만큼(6단계) 내려가므로 트리 크기와 상관없이 메모리 접근 수가 일정
+ * 같은 key가 여러 개일 수 있고 노드 포인터는 서로 달라야 해서, 노드들은 skip list backend처럼 key 순 연결 리스트로도 엮음:
+ *   root = 첫 노드, right = 다음 노드, parent = 이전 노드, left = 항상 nil
+ *   trie에는 같은 key 중 마지막 노드를 둠 -> 같은 key는 그 뒤에 (트리 구현처럼 오른쪽으로)
+ */
+
+#define RADIX_BITS 6
+#define RADIX_LEVELS 6  // 6 * 6 = 36 >= 32
+#define RADIX_FANOUT (1 << RADIX_BITS)
+
+typedef struct radix_node {
+  uint64_t bitmap;
+  unsigned int cap;
+  void* child[];
+} radix_node_t;
+
+// tree->aux
+typedef struct {
+  radix_node_t* root;
+  node_t* tail;
+} radix_head_t;
+
+static inline uint32_t radix_key(key_t key)
+{
+    return (uint32_t)key ^ 0x80000000u;
+}
+
+static inline unsigned int digit(uint32_t u, int level)
+{
+    return (u >> (RADIX_BITS * (RADIX_LEVELS - 1 - level))) & (RADIX_FANOUT - 1);
+}
+
+static inline unsigned int slot_of(const radix_node_t* x, unsigned int d)
+{
+    return (unsigned int)__builtin_popcountll(x->bitmap & ((1ull << d) - 1));
+}
+
+// 가장 큰 key 쪽으로 끝까지 내려감
+static node_t* radix_last(const radix_node_t* x, int level)
+{
+    for (; level < RADIX_LEVELS - 1; ++level)
+    {
+        x = (const radix_node_t*)x->child[__builtin_popcountll(x->bitmap) - 1];
+    }
+    return (node_t*)x->child[__builtin_popcountll(x->bitmap) - 1];
+}
+
+static radix_node_t* radix_node_new(unsigned int cap)
+{
+    radix_node_t* x = (radix_node_t*)malloc(sizeof(radix_node_t) + cap * sizeof(void*));
+    if (x)
+    {
+        x->bitmap = 0;
+        x->cap = cap;
+    }
+    return x;
+}
+
+static void radix_free(radix_node_t* x, int level)
+{
+    if (level < RADIX_LEVELS - 1)
+    {
+        for (int i = 0; i < __builtin_popcountll(x->bitmap); ++i)
+        {
+            radix_free((radix_node_t*)x->child[i], level + 1);
+        }
+    }
+    free(x);
+}
+
+/*
+ * *ref 노드의 d 자리에 child를 넣음, 배열이 차 있으면 두 배로 늘려서 *ref를 바꿈
+ */
+static int radix_add(radix_node_t** ref, unsigned int d, void* child)
+{
+    radix_node_t* x = *ref;
+    unsigned int n = (unsigned int)__builtin_popcountll(x->bitmap);
+    if (n == x->cap)
+    {
+        unsigned int cap = x->cap * 2 < RADIX_FANOUT ? x->cap * 2 : RADIX_FANOUT;
+        radix_node_t* grown = (radix_node_t*)realloc(x, sizeof(radix_node_t) + cap * sizeof(void*));
+        if (!grown) return -1;
+
+        grown->cap = cap;
+        *ref = x = grown;
+    }
+
+    unsigned int s = slot_of(x, d);
+    for (unsigned int i = n; i > s; --i)
+    {
+        x->child[i] = x->child[i - 1];
+    }
+    x->child[s] = child;
+    x->bitmap |= 1ull << d;
+    return 0;
+}
+
+static void radix_remove(radix_node_t* x, unsigned int d)
+{
+    unsigned int n = (unsigned int)__builtin_popcountll(x->bitmap);
+    for (unsigned int i = slot_of(x, d); i + 1 < n; ++i)
+    {
+        x->child[i] = x->child[i + 1];
+    }
+    x->bitmap &= ~(1ull << d);
+}
+
+rbtree* new_rbtree(void)
+{
+    rbtree* tree = (rbtree*)calloc(1, sizeof(rbtree));
+    node_t* nil = (node_t*)calloc(1, sizeof(node_t));
+    radix_head_t* head = (radix_head_t*)calloc(1, sizeof(radix_head_t));
+    if (!tree || !nil || !head)
+    {
+        free(tree);
+        free(nil);
+        free(head);
+        return NULL;
+    }
+
+    nil->color = RBTREE_BLACK;
+    nil->left = nil;
+    nil->right = nil;
+    nil->parent = nil;
+    head->tail = nil;
+
+    tree->nil = nil;
+    tree->root = nil;
+    tree->spare = nil;
+    tree->node_size = sizeof(node_t);
+    tree->aux = head;
+    return tree;
+}
+
+void delete_rbtree(rbtree* tree)
+{
+    if (!tree) return;
+
+    radix_head_t* head = (radix_head_t*)tree->aux;
+    for (node_t* x = tree->root; x != tree->nil;)
+    {
+        node_t* next = x->right;
+        free(x);
+        x = next;
+    }
+    if (head->root)
+    {
+        radix_free(head->root, 0);
+    }
+    free(head);
+    free(tree->nil);
+    free(tree);
+}
+
+node_t* rbtree_find(const rbtree* tree, const key_t key)
+{
+    const radix_head_t* head = (const radix_head_t*)tree->aux;
+    uint32_t u = radix_key(key);
+    const radix_node_t* x = head->root;
+    if (!x) return NULL;
+
+    for (int level = 0;; ++level)
+    {
+        unsigned int d = digit(u, level);
+        if (!(x->bitmap >> d & 1)) return NULL;
+        if (level == RADIX_LEVELS - 1) return (node_t*)x->child[slot_of(x, d)];
+
+        x = (const radix_node_t*)x->child[slot_of(x, d)];
+    }
+}
+
+/*
+ * trie에 node를 key u로 넣고 리스트에서 node 앞에 올 노드를 *prev에 돌려줌, 할당 실패면 -1
+ * 처음 보는 key면 내려가면서 거친 노드들에서 key보다 작은 쪽 자식이 있는 가장 깊은 곳을 찾아
+ * 그 안의 가장 큰 key(의 마지막 노드)가 앞 노드가 됨
+ */
+static int radix_place(radix_head_t* head, uint32_t u, node_t* node, node_t** prev)
+{
+    radix_node_t** ref = &head->root;
+    int level = 0;
+    for (;; ++level)
+    {
+        radix_node_t* x = *ref;
+        unsigned int d = digit(u, level);
+        uint64_t below = x->bitmap & ((1ull << d) - 1);
+        if (below)
+        {
+            // 더 깊은 곳에서 또 찾으면 그쪽이 더 가까움
+            void* c = x->child[__builtin_popcountll(below) - 1];
+            *prev = level == RADIX_LEVELS - 1 ? (node_t*)c : radix_last((radix_node_t*)c, level + 1);
+        }
+        if (!(x->bitmap >> d & 1)) break;
+
+        void** slot = &x->child[slot_of(x, d)];
+        if (level == RADIX_LEVELS - 1)
+        {
+            // 같은 key가 있음: 그 마지막 노드 뒤에 두고 trie가 새 노드를 가리키게 함
+            *prev = (node_t*)*slot;
+            *slot = node;
+            return 0;
+        }
+        ref = (radix_node_t**)slot;
+    }
+
+    // level 아래는 새로 만듦: 새 노드들을 먼저 엮은 뒤 마지막에 기존 trie에 붙임
+    void* child = node;
+    int l = RADIX_LEVELS - 1;
+    for (; l > level; --l)
+    {
+        radix_node_t* x = radix_node_new(1);
+        if (!x) break;
+
+        x->child[0] = child;
+        x->bitmap = 1ull << digit(u, l);
+        child = x;
+    }
+    if (l == level && radix_add(ref, digit(u, level), child) == 0) return 0;
+
+    if (child != node)
+    {
+        radix_free((radix_node_t*)child, l + 1);
+    }
+    return -1;
+}
+
+node_t* rbtree_insert(rbtree* tree, const key_t key)
+{
+    radix_head_t* head = (radix_head_t*)tree->aux;
+    node_t* node = (node_t*)calloc(1, sizeof(node_t));
+    if (!node) return NULL;
+
+    node_t* prev = tree->nil;
+    if ((!head->root && !(head->root = radix_node_new(1))) || radix_place(head, radix_key(key), node, &prev) != 0)
+    {
+        free(node);
+        return NULL;
+    }
+
+    node->key = key;
+    node->left = tree->nil;
+    node->parent = prev;
+    node->right = (prev == tree->nil) ? tree->root : prev->right;
+    if (prev == tree->nil)
+    {
+        tree->root = node;
+    }
+    else
+    {
+        prev->right = node;
+    }
+    if (node->right == tree->nil)
+    {
+        head->tail = node;
+    }
+    else
+    {
+        node->right->parent = node;
+    }
+
+    tree->size++;
+    return node;
+}
+
+node_t* rbtree_min(const rbtree* tree)
+{
+    return tree->root;
+}
+
+node_t* rbtree_max(const rbtree* tree)
+{
+    return ((const radix_head_t*)tree->aux)->tail;
+}
+
+/*
+ * trie가 node를 가리킬 때만 trie를 고침: 앞 노드가 같은 key면 그쪽으로 바꾸고, 아니면 key를 빼고 빈 trie 노드를 정리
+ */
+int rbtree_erase(rbtree* tree, node_t* node)
+{
+    if (!tree || node == tree->nil) return 0;
+
+    radix_head_t* head = (radix_head_t*)tree->aux;
+    uint32_t u = radix_key(node->key);
+    radix_node_t* path[RADIX_LEVELS];
+    radix_node_t* x = head->root;
+    for (int level = 0; level < RADIX_LEVELS - 1; ++level)
+    {
+        path[level] = x;
+        x = (radix_node_t*)x->child[slot_of(x, digit(u, level))];
+    }
+    path[RADIX_LEVELS - 1] = x;
+
+    void** leaf = &x->child[slot_of(x, digit(u, RADIX_LEVELS - 1))];
+    if (*leaf == node)
+    {
+        if (node->parent != tree->nil && node->parent->key == node->key)
+        {
+            *leaf = node->parent;
+        }
+        else
+        {
+            // 비는 노드는 위로 올라가며 해제 (루트는 남겨 둠)
+            int level = RADIX_LEVELS - 1;
+            radix_remove(path[level], digit(u, level));
+            for (; level > 0 && path[level]->bitmap == 0; --level)
+            {
+                free(path[level]);
+                radix_remove(path[level - 1], digit(u, level - 1));
+            }
+        }
+    }
+
+    if (node->parent == tree->nil)
+    {
+        tree->root = node->right;
+    }
+    else
+    {
+        node->parent->right = node->right;
+    }
+    if (node->right == tree->nil)
+    {
+        head->tail = node->parent;
+    }
+    else
+    {
+        node->right->parent = node->parent;
+    }
+
+    tree->size--;
+    free(node);
+    return 0;
+}
+
+node_t* rbtree_next(const rbtree* tree, const node_t* node)
+{
+    return node->right;
+}
+
+node_t* rbtree_prev(const rbtree* tree, const node_t* node)
+{
+    return node == tree->nil ? rbtree_max(tree) : node->parent;
+}
+
+int rbtree_to_array(const rbtree* tree, key_t* arr, const size_t n)
+{
+    size_t i = 0;
+    for (node_t* x = tree->root; x != tree->nil && i < n; x = x->right)
+    {
+        arr[i++] = x->key;
+    }
+    return (int)i;
+}
@@ -3,8 +3,18 @@
 // #endif
 
 #include "rbtree.h"
+#include "bloom.h"
+#include "hash_index.h"
+#include "trace.h"
+#include <pthread.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 
 /*
@@ -14,8 +24,20 @@
  */
 rbtree* new_rbtree(void)
 {
+    return new_rbtree_augmented(sizeof(node_t), NULL);
+}
+
+/*
+ * augment 트리 생성
+ * 노드는 node_size 만큼 할당되고(node_t가 맨 앞), 구조가 바뀔 때마다 update로 부가 정보를 다시 계산
+ * 회전은 두 노드만, 삽입/삭제는 변경 지점부터 루트까지의 경로만 갱신
+ */
+rbtree* new_rbtree_augmented(size_t node_size, rbtree_update_t update)
+{
+    if (node_size < sizeof(node_t)) return NULL;
+
     rbtree* tree = (rbtree*)calloc(1, sizeof(rbtree));
-    node_t* nil = (node_t*)calloc(1, sizeof(node_t));
+    node_t* nil = (node_t*)calloc(1, node_size);
     nil->color = RBTREE_BLACK;
  
     nil->left = nil;
@@ -24,32 +46,249 @@ rbtree* new_rbtree(void)
 
     tree->nil = nil;
     tree->root = tree->nil;
+    tree->spare = tree->nil;
+    tree->node_size = node_size;
+    tree->update = update;
     return tree;
 }
 
+static inline int in_block(const rbtree* tree, const node_t* node)
+{
+    return (const char*)node >= tree->block && (const char*)node < tree->block + tree->block_bytes;
+}
+
 /*
- * 트리의 노드 삭제(후위순회)
+ * 노드 하나 할당/해제 (할당자가 등록돼 있으면 그쪽으로)
  */
-static void delete_node(rbtree* tree, node_t* node)
+static node_t* node_malloc(rbtree* tree)
 {
-    if (node == tree->nil) return;
+    if (tree->allocator.alloc)
+    {
+        node_t* node = (node_t*)tree->allocator.alloc(tree->allocator.ctx, tree->node_size);
+        if (node)
+        {
+            memset(node, 0, tree->node_size);
+        }
+        return node;
+    }
+    return (node_t*)calloc(1, tree->node_size);
+}
 
-    delete_node(tree, node->left);
-    delete_node(tree, node->right);
+static void node_release(rbtree* tree, node_t* node)
+{
+    if (tree->allocator.dealloc)
+    {
+        tree->allocator.dealloc(tree->allocator.ctx, node, tree->node_size);
+        return;
+    }
     free(node);
 }
 
+/*
+ * 노드 메모리 반환
+ * compact 블록 안의 노드는 free할 수 없으니 free_list에 모아서 다음 삽입에 재사용
+ */
+static void free_node(rbtree* tree, node_t* node)
+{
+    if (in_block(tree, node))
+    {
+        node->right = tree->free_list;
+        tree->free_list = node;
+        return;
+    }
+    node_release(tree, node);
+}
+
+/*
+ * 버릴 서브트리 *pending에서 한 단계 진행 (parent 링크는 보지 않음)
+ * 루트에 왼쪽 자식이 있으면 우회전만 하고 NULL, 없으면 루트를 떼어서 반환 (오른쪽 자식이 새 루트)
+ * 우회전마다 루트의 왼쪽 사슬이 하나씩 줄어서 노드 n개를 다 떼는 데 2n단계 이하
+ */
+static node_t* unlink_step(const rbtree* tree, node_t** pending)
+{
+    node_t* node = *pending;
+    node_t* left = node->left;
+
+    if (left != tree->nil)
+    {
+        //        [node]          [left]
+        //    [left]      ->            [node]
+        //        [2]                [2]
+        node->left = left->right;
+        left->right = node;
+        *pending = left;
+        return NULL;
+    }
+
+    *pending = node->right;
+    return node;
+}
+
+/*
+ * 트리를 조금씩 해제: 노드 떼기/회전을 합쳐 budget 단계까지만 하고 반환 (해제되는 노드는 budget개 이하)
+ * 남은 일이 있으면 1, 트리 구조체까지 다 해제했으면 0
+ * 처음 부른 뒤로는 tree를 다른 함수에 넘기면 안 됨
+ * 블록 안의 노드는 블록째로 한 번에 해제하므로 건너뜀
+ */
+int rbtree_destroy_step(rbtree* tree, size_t budget)
+{
+    if (!tree) return 0;
+
+    for (; budget > 0; --budget)
+    {
+        node_t* node;
+        if (tree->root != tree->nil)
+        {
+            node = unlink_step(tree, &tree->root);
+        }
+        else if (tree->spare != tree->nil)
+        {
+            node = unlink_step(tree, &tree->spare);
+        }
+        else if (tree->free_list)
+        {
+            node = tree->free_list;
+            tree->free_list = node->right;
+        }
+        else
+        {
+            if (tree->trace) rbtree_trace_stop(tree);
+            hash_index_free(tree->index);
+            bloom_free(tree->bloom);
+            free(tree->block);
+            free(tree->nil);
+            free(tree);
+            return 0;
+        }
+
+        if (node && !in_block(tree, node))
+        {
+            node_release(tree, node);
+        }
+    }
+    return 1;
+}
 
 /*
  * 트리 및 nil 노드 메모리 해제
+ * 재귀 없이 한 번에 끝까지 (깊은 트리도 스택 걱정 없음)
  */
 void delete_rbtree(rbtree* tree)
+{
+    rbtree_destroy_step(tree, SIZE_MAX);
+}
+
+static void* destroy_thread(void* arg)
+{
+    delete_rbtree((rbtree*)arg);
+    return NULL;
+}
+
+/*
+ * 해제를 백그라운드 스레드에 넘기고 바로 반환
+ * 등록된 할당자는 다른 스레드에서 불려도 안전해야 함
+ * 스레드를 못 만들면 -1 (tree는 그대로라 호출자가 rbtree_destroy_step으로 나눠서 해제)
+ */
+int rbtree_destroy_async(rbtree* tree)
+{
+    if (!tree) return 0;
+
+    pthread_attr_t attr;
+    pthread_t thread;
+    if (pthread_attr_init(&attr) != 0) return -1;
+
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&thread, &attr, destroy_thread, tree);
+    pthread_attr_destroy(&attr);
+    return err ? -1 : 0;
+}
+
+/*
+ * 모든 노드를 지우지만 메모리는 트리에 남겨서 다음 삽입에 재사용
+ * 노드들은 통째로 spare로 넘기고 rbtree_alloc_node가 하나씩 떼어 씀 (분할상환 O(1))
+ * 이미 spare가 있으면 노드 하나를 떼어서 두 덩어리를 그 아래에 붙임
+ */
+void rbtree_clear(rbtree* tree)
 {
     if (!tree) return;
 
-    delete_node(tree, tree->root);
-    free(tree->nil);
-    free(tree);
+    if (tree->root != tree->nil)
+    {
+        if (tree->spare == tree->nil)
+        {
+            tree->spare = tree->root;
+        }
+        else
+        {
+            node_t* top = NULL;
+            while (!top)
+            {
+                top = unlink_step(tree, &tree->root);
+            }
+            top->left = tree->root;
+            top->right = tree->spare;
+            tree->spare = top;
+        }
+    }
+
+    tree->root = tree->nil;
+    tree->nil->parent = tree->nil;
+    tree->min_cache = NULL;
+    tree->size = 0;
+    tree->dead_count = 0;
+    if (tree->index)
+    {
+        hash_index_clear(tree->index);
+    }
+    if (tree->bloom)
+    {
+        bloom_reset(tree->bloom, tree->bloom->capacity);  // 크기가 같아서 실패하지 않음
+    }
+}
+
+/*
+ * spare/free_list에 남은 노드를 할당자에 돌려줌 (블록 노드는 블록째로 해제되므로 버림)
+ */
+static void release_spare(rbtree* tree)
+{
+    while (tree->spare != tree->nil)
+    {
+        node_t* node = unlink_step(tree, &tree->spare);
+        if (node && !in_block(tree, node))
+        {
+            node_release(tree, node);
+        }
+    }
+    while (tree->free_list)
+    {
+        node_t* node = tree->free_list;
+        tree->free_list = node->right;
+        if (!in_block(tree, node))
+        {
+            node_release(tree, node);
+        }
+    }
+}
+
+/*
+ * 노드 할당자 등록 (빈 트리에서만)
+ * NULL을 넘기면 기본값(calloc/free)으로 돌아감
+ */
+int rbtree_set_allocator(rbtree* tree, const rbtree_allocator_t* allocator)
+{
+    if (!tree || tree->root != tree->nil || tree->spare != tree->nil || tree->block) return -1;
+
+    if (allocator && (!allocator->alloc || !allocator->dealloc)) return -1;
+
+    if (allocator)
+    {
+        tree->allocator = *allocator;
+    }
+    else
+    {
+        memset(&tree->allocator, 0, sizeof(tree->allocator));
+    }
+    return 0;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
@@ -102,6 +341,13 @@ static void left_rotate(rbtree* tree, node_t* x)
 
     y->left = x;
     x->parent = y;
+
+    // 아래로 내려간 x부터 다시 계산
+    if (tree->update)
+    {
+        tree->update(tree, x);
+        tree->update(tree, y);
+    }
 }
 
 static void right_rotate(rbtree* tree, node_t* y)
@@ -149,6 +395,25 @@ static void right_rotate(rbtree* tree, node_t* y)
 
     x->right = y;
     y->parent = x;
+
+    if (tree->update)
+    {
+        tree->update(tree, y);
+        tree->update(tree, x);
+    }
+}
+
+/*
+ * node부터 루트까지 augment 값 갱신
+ * 삽입/삭제로 서브트리 구성이 바뀐 경로만 다시 계산하면 됨
+ */
+static void propagate(rbtree* tree, node_t* node)
+{
+    while (node != tree->nil)
+    {
+        tree->update(tree, node);
+        node = node->parent;
+    }
 }
 
 // Case1) p = red, u = red			: p,u = black, pp = red 위로반복
@@ -255,15 +520,145 @@ static void insert_fixup(rbtree* tree, node_t* node)
 }
 
 
-node_t* rbtree_insert(rbtree* tree, const key_t key)
+/*
+ * key만 채운 새 노드 할당 (augment 영역은 0으로 초기화)
+ * 호출자가 augment 값을 채운 뒤 rbtree_insert_node로 연결
+ */
+node_t* rbtree_alloc_node(rbtree* tree, const key_t key)
 {
-    node_t* node = (node_t*)calloc(1, sizeof(node_t));
+    node_t* node;
+
+    if (tree->free_list)
+    {
+        node = tree->free_list;
+        tree->free_list = node->right;
+        memset(node, 0, tree->node_size);
+    }
+    else if (tree->spare != tree->nil)
+    {
+        // rbtree_clear로 남겨둔 노드
+        node = NULL;
+        while (!node)
+        {
+            node = unlink_step(tree, &tree->spare);
+        }
+        memset(node, 0, tree->node_size);
+    }
+    else
+    {
+        node = node_malloc(tree);
+        if (!node) return NULL;
+    }
 
     node->key = key;
     node->color = RBTREE_RED;
     node->left = tree->nil;
     node->right = tree->nil;
     node->parent = tree->nil;
+    return node;
+}
+
+static node_t* find_state(const rbtree* tree, node_t* node, const key_t key, unsigned int dead);
+static node_t* erase_node(rbtree* tree, node_t* node);
+static void bloom_note_insert(rbtree* tree, const key_t key);
+static void bloom_note_erase(rbtree* tree);
+static node_t* tree_successor(const rbtree* tree, node_t* node);
+static node_t* tree_min(const rbtree* tree);
+static node_t* tree_max(const rbtree* tree);
+
+/*
+ * 용량이 찬 트리에 삽입: 최솟값보다 크지 않으면 버리고(nil, 할당 실패의 NULL과 구별), 크면 최솟값 노드를 떼어서 새 key로 다시 연결
+ * 최솟값 노드는 왼쪽 자식이 없어서 자기 자신이 그대로 떨어짐 -> 해제/할당 없음
+ */
+static node_t* replace_min(rbtree* tree, const key_t key)
+{
+    node_t* min = tree->min_cache;
+    if (!min)
+    {
+        min = tree_min(tree);
+    }
+    if (key <= min->key)
+    {
+        tree->min_cache = min;
+        return tree->nil;
+    }
+
+    // 최솟값 다음 노드는 삭제로 자리가 바뀌지 않음
+    node_t* next = tree_successor(tree, min);
+    node_t* node = erase_node(tree, min);
+
+    memset(node, 0, tree->node_size);
+    node->key = key;
+    node->left = tree->nil;
+    node->right = tree->nil;
+    node->parent = tree->nil;
+
+    tree->min_cache = (next != tree->nil && next->key <= key) ? next : node;
+    return rbtree_insert_node(tree, node);
+}
+
+/*
+ * 최대 capacity개만 유지하는 top-K 모드 (0이면 제한 없음)
+ * 가득 차면 rbtree_insert가 최솟값 노드를 재사용해서 교체하므로 정상 상태에서는 할당이 없음
+ * 지금 capacity보다 많으면 작은 것부터 지움, lazy erase와는 같이 못 씀
+ */
+int rbtree_set_capacity(rbtree* tree, size_t capacity)
+{
+    if (!tree || tree->lazy_ratio > 0) return -1;
+
+    tree->capacity = capacity;
+    while (capacity && tree->size > capacity)
+    {
+        free_node(tree, erase_node(tree, tree_min(tree)));
+    }
+    tree->min_cache = NULL;
+    return 0;
+}
+
+
+static node_t* insert_key(rbtree* tree, const key_t key)
+{
+    if (tree->capacity && tree->size >= tree->capacity)
+    {
+        return replace_min(tree, key);
+    }
+
+    // 지웠다가 다시 넣는 경우: 같은 key의 dead 노드를 살려서 할당/재조정 없이 끝냄
+    if (tree->dead_count > 0)
+    {
+        node_t* node = find_state(tree, tree->root, key, 1);
+        if (node)
+        {
+            node->dead = 0;
+            tree->dead_count--;
+            if (tree->bloom)
+            {
+                bloom_note_insert(tree, key);
+            }
+            if (tree->index && !hash_index_get(tree->index, key) && hash_index_put(tree->index, key, node) != 0)
+            {
+                rbtree_disable_index(tree);
+            }
+            return node;
+        }
+    }
+
+    return rbtree_insert_node(tree, rbtree_alloc_node(tree, key));
+}
+
+node_t* rbtree_insert(rbtree* tree, const key_t key)
+{
+    node_t* node = insert_key(tree, key);
+    if (tree->trace) trace_record(tree->trace, TRACE_INSERT, key, node != NULL && node != tree->nil);
+    return node;
+}
+
+/*
+ * 이미 할당된 노드를 트리에 연결
+ */
+node_t* rbtree_insert_node(rbtree* tree, node_t* node)
+{
+    if (!node) return NULL;
 
     // 삽입 위치를 찾기위함
     //              [y]
@@ -285,101 +680,406 @@ node_t* rbtree_insert(rbtree* tree, const key_t key)
         }
     }
 
-    node->parent = y;
+    rbtree_link_node(tree, y, y != tree->nil && node->key < y->key, node);
+    if (tree->min_cache && node->key < tree->min_cache->key)
+    {
+        tree->min_cache = node;
+    }
+
+    // 같은 key가 이미 색인돼 있으면 그대로 둠 (find는 아무 노드나 돌려주면 됨)
+    if (tree->index && !hash_index_get(tree->index, node->key) && hash_index_put(tree->index, node->key, node) != 0)
+    {
+        rbtree_disable_index(tree);
+    }
+
+    return node;
+}
+
+/*
+ * 위치를 이미 찾은 노드를 parent의 빈 자식 자리에 연결하고 재조정
+ * parent가 nil이면 루트로, key_t가 아닌 key로 정렬하는 트리는 직접 내려가서 이걸 부름
+ */
+void rbtree_link_node(rbtree* tree, node_t* parent, int is_left, node_t* node)
+{
+    node->color = RBTREE_RED;
+    node->parent = parent;
 
-    if (y == tree->nil)
+    if (parent == tree->nil)
     {
         tree->root = node;
     }
-    else if (node->key < y->key)
+    else if (is_left)
     {
-        y->left = node;
+        parent->left = node;
     }
     else
     {
-        y->right = node;
+        parent->right = node;
     }
 
     node->left = tree->nil;
     node->right = tree->nil;
+    tree->size++;
+
+    // 회전 전에 경로를 먼저 맞춰 둬야 회전에서 두 노드만 다시 계산해도 됨
+    if (tree->update)
+    {
+        propagate(tree, node);
+    }
     insert_fixup(tree, node);
 
-    return node;
+    if (tree->bloom)
+    {
+        bloom_note_insert(tree, node->key);
+    }
 }
 
 /*
  * 트리에서 key 값으로 노드 검색
  * BST 탐색 방식으로 진행
  */
-node_t* rbtree_find(const rbtree* tree, const key_t key)
+static node_t* tree_find(const rbtree* tree, const key_t key)
 {
-    if (!tree) return NULL;
-
     node_t* now = tree->root;
 
     while (now != tree->nil)
     {
         if (key == now->key)
         {
-            return now;
+            // dead면 같은 key의 다른 노드를 찾아봄 (양쪽 서브트리에 있을 수 있음)
+            return now->dead ? find_state(tree, now, key, 0) : now;
         }
         now = (key < now->key ? now->left : now->right);
     }
     return NULL;
 }
 
-//////////////////////////////////////////////////////////////////////////////////////////
-
 /*
- * 트리에서 최소값 노드 반환.
- * 왼쪽으로 쭉
+ * node 서브트리에서 key가 같고 dead 상태가 주어진 값인 노드
+ * 같은 key인데 상태가 다르면 양쪽을 다 봐야 하지만, 그 외에는 보통 탐색처럼 한 갈래로만 내려감
  */
-node_t* rbtree_min(const rbtree* tree)
+static node_t* find_state(const rbtree* tree, node_t* node, const key_t key, unsigned int dead)
 {
-    if (!tree) return NULL;
-    node_t* now = tree->root;
-
-    if (now == tree->nil) return tree->nil;
-
-    while (now->left != tree->nil)
+    while (node != tree->nil)
     {
-        now = now->left;
-    }
+        if (key != node->key)
+        {
+            node = (key < node->key ? node->left : node->right);
+            continue;
+        }
+        if (node->dead == dead) return node;
 
-    return now;
+        node_t* hit = find_state(tree, node->left, key, dead);
+        if (hit) return hit;
+        node = node->right;
+    }
+    return NULL;
 }
 
 /*
- * 트리에서 최대값 노드 반환.
- * 오른쪽으로 쭉
+ * Bloom filter가 없다고 하면 바로 NULL
+ * 색인이 켜져 있으면 해시 한 번, 아니면 트리 탐색
  */
-node_t* rbtree_max(const rbtree* tree)
+node_t* rbtree_find(const rbtree* tree, const key_t key)
 {
     if (!tree) return NULL;
-    node_t* now = tree->root;
-
-    if (now == tree->nil) return tree->nil;
 
-    while (now->right != tree->nil)
+    node_t* node;
+    if (tree->bloom && !bloom_maybe(tree->bloom, key))
     {
-        now = now->right;
+        node = NULL;
     }
-
-    return now;
+    else
+    {
+        node = tree->index ? hash_index_get(tree->index, key) : tree_find(tree, key);
+    }
+    if (tree->trace) trace_record(tree->trace, TRACE_FIND, key, node != NULL);
+    return node;
 }
 
 /*
- * 삭제 대체 노드(석섹서) 찾기
- * 오른쪽 서브트리의 최소값 or 부모로 올라가서 최초로 왼쪽 자식이 아닌 부모를 찾음
+ * 색인에서 key 항목을 트리에 남은 같은 key 노드로 다시 맞춤 (없으면 제거)
  */
-static node_t* tree_successor(const rbtree* tree, node_t* node)
+static void index_refresh(rbtree* tree, const key_t key)
 {
-    if (!tree || node == tree->nil) return NULL;
+    node_t* node = tree_find(tree, key);
 
-    // 1. node의 오른쪽 서브트리가 있으면
-    if (node->right != tree->nil)
+    if (!node)
     {
-        node_t* now = node->right;
+        hash_index_remove(tree->index, key);
+    }
+    else if (hash_index_put(tree->index, key, node) != 0)
+    {
+        rbtree_disable_index(tree);
+    }
+}
+
+static void index_build(const rbtree* tree, hash_index* idx, node_t* node, int* err)
+{
+    if (node == tree->nil || *err) return;
+
+    index_build(tree, idx, node->left, err);
+    if (!hash_index_get(idx, node->key) && hash_index_put(idx, node->key, node) != 0)
+    {
+        *err = 1;
+    }
+    index_build(tree, idx, node->right, err);
+}
+
+/*
+ * exact-match 해시 색인 켜기
+ * 켜져 있는 동안 insert/erase가 같이 갱신하고 rbtree_find는 O(1) 기대 시간
+ * min/max/to_array 같은 순서 연산은 그대로 트리를 씀
+ */
+int rbtree_enable_index(rbtree* tree)
+{
+    if (!tree) return -1;
+    if (tree->index) return 0;
+
+    hash_index* idx = hash_index_new(0);
+    int err = idx ? 0 : 1;
+    if (idx)
+    {
+        index_build(tree, idx, tree->root, &err);
+    }
+    if (err)
+    {
+        hash_index_free(idx);
+        return -1;
+    }
+
+    tree->index = idx;
+    return 0;
+}
+
+void rbtree_disable_index(rbtree* tree)
+{
+    if (!tree) return;
+
+    hash_index_free(tree->index);
+    tree->index = NULL;
+}
+
+/*
+ * 살아 있는 key로 필터를 다시 채움 (expected개 크기), 메모리가 없으면 필터를 끔
+ */
+static void bloom_rebuild(rbtree* tree, size_t expected)
+{
+    if (bloom_reset(tree->bloom, expected) != 0)
+    {
+        rbtree_disable_bloom(tree);
+        return;
+    }
+
+    node_t* now = tree->root;
+    while (now != tree->nil && now->left != tree->nil)
+    {
+        now = now->left;
+    }
+    for (; now != tree->nil; now = tree_successor(tree, now))
+    {
+        if (!now->dead)
+        {
+            bloom_add(tree->bloom, now->key);
+        }
+    }
+}
+
+/*
+ * 용량을 넘으면 오탐이 늘어나므로 두 배 크기로 다시 만듦 (hash table 키우기처럼 분할 상환 O(1))
+ */
+static void bloom_note_insert(rbtree* tree, const key_t key)
+{
+    if (tree->bloom->count >= tree->bloom->capacity)
+    {
+        bloom_rebuild(tree, 2 * (tree->size - tree->dead_count));
+    }
+    else
+    {
+        bloom_add(tree->bloom, key);
+    }
+}
+
+/*
+ * 지운 key의 비트는 남아서 오탐만 늘림 -> 넣은 것의 절반 넘게 지워지면 다시 만듦
+ * 다시 만드는 비용 O(n)은 그 사이의 n/2번 넘는 erase로 나뉨
+ */
+static void bloom_note_erase(rbtree* tree)
+{
+    if (++tree->bloom->stale * 2 > tree->bloom->count)
+    {
+        bloom_rebuild(tree, tree->size - tree->dead_count);
+    }
+}
+
+/*
+ * 없는 key를 rbtree_find가 트리를 내려가지 않고 거르도록 blocked Bloom filter 켜기
+ * key 하나에 캐시 라인 하나만 보며 오탐은 1% 안팎, 메모리는 key당 2~4바이트
+ */
+int rbtree_enable_bloom(rbtree* tree)
+{
+    if (!tree) return -1;
+    if (tree->bloom) return 0;
+
+    tree->bloom = bloom_new(tree->size);
+    if (!tree->bloom) return -1;
+
+    bloom_rebuild(tree, tree->size);
+    return tree->bloom ? 0 : -1;
+}
+
+void rbtree_disable_bloom(rbtree* tree)
+{
+    if (!tree) return;
+
+    bloom_free(tree->bloom);
+    tree->bloom = NULL;
+}
+
+/*
+ * 여러 key를 한 번에 검색 (group prefetch)
+ * key 하나의 탐색은 레벨마다 앞 노드를 읽어야 다음 주소를 아는 의존 load라서 캐시 미스가 그대로 직렬로 쌓임
+ * RBTREE_BATCH_GROUP개의 탐색을 번갈아 한 레벨씩 내려가면서 다음 노드를 prefetch 해두면
+ * 서로 독립인 미스들이 겹쳐서 처리됨
+ * out[i]는 keys[i]의 노드 또는 NULL (rbtree_find와 같은 결과)
+ */
+static void find_batch(const rbtree* tree, const key_t* keys, size_t n, node_t** out)
+{
+    if (tree->index)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = hash_index_get(tree->index, keys[i]);
+        }
+        return;
+    }
+
+    node_t* now[RBTREE_BATCH_GROUP];
+    size_t idx[RBTREE_BATCH_GROUP];
+
+    for (size_t base = 0; base < n; base += RBTREE_BATCH_GROUP)
+    {
+        size_t active = (n - base < RBTREE_BATCH_GROUP) ? n - base : RBTREE_BATCH_GROUP;
+
+        for (size_t g = 0; g < active; ++g)
+        {
+            now[g] = tree->root;
+            idx[g] = base + g;
+        }
+
+        // 끝난 탐색은 마지막 칸과 바꿔서 빼고, 남은 것들만 한 레벨씩 진행
+        while (active > 0)
+        {
+            for (size_t g = 0; g < active;)
+            {
+                node_t* node = now[g];
+                key_t key = keys[idx[g]];
+
+                if (node == tree->nil || key == node->key)
+                {
+                    if (node == tree->nil)
+                    {
+                        out[idx[g]] = NULL;
+                    }
+                    else
+                    {
+                        out[idx[g]] = node->dead ? tree_find(tree, key) : node;
+                    }
+                    --active;
+                    now[g] = now[active];
+                    idx[g] = idx[active];
+                    continue;
+                }
+
+                node = (key < node->key) ? node->left : node->right;
+                __builtin_prefetch(node);
+                now[g] = node;
+                ++g;
+            }
+        }
+    }
+}
+
+void rbtree_find_batch(const rbtree* tree, const key_t* keys, size_t n, node_t** out)
+{
+    if (!tree) return;
+
+    find_batch(tree, keys, n, out);
+    // 기록은 find를 n번 부른 것과 같은 모양으로
+    for (size_t i = 0; tree->trace && i < n; ++i)
+    {
+        trace_record(tree->trace, TRACE_FIND, keys[i], out[i] != NULL);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+
+/*
+ * 트리에서 최소값 노드 반환.
+ * 왼쪽으로 쭉
+ */
+static node_t* tree_min(const rbtree* tree)
+{
+    node_t* now = tree->root;
+
+    if (now == tree->nil) return tree->nil;
+
+    while (now->left != tree->nil)
+    {
+        now = now->left;
+    }
+
+    return now->dead ? rbtree_next(tree, now) : now;
+}
+
+/*
+ * 트리에서 최대값 노드 반환.
+ * 오른쪽으로 쭉
+ */
+static node_t* tree_max(const rbtree* tree)
+{
+    node_t* now = tree->root;
+
+    if (now == tree->nil) return tree->nil;
+
+    while (now->right != tree->nil)
+    {
+        now = now->right;
+    }
+
+    return now->dead ? rbtree_prev(tree, now) : now;
+}
+
+node_t* rbtree_min(const rbtree* tree)
+{
+    if (!tree) return NULL;
+
+    node_t* node = tree_min(tree);
+    if (tree->trace) trace_record(tree->trace, TRACE_MIN, 0, node != tree->nil);
+    return node;
+}
+
+node_t* rbtree_max(const rbtree* tree)
+{
+    if (!tree) return NULL;
+
+    node_t* node = tree_max(tree);
+    if (tree->trace) trace_record(tree->trace, TRACE_MAX, 0, node != tree->nil);
+    return node;
+}
+
+/*
+ * 삭제 대체 노드(석섹서) 찾기
+ * 오른쪽 서브트리의 최소값 or 부모로 올라가서 최초로 왼쪽 자식이 아닌 부모를 찾음
+ */
+static node_t* tree_successor(const rbtree* tree, node_t* node)
+{
+    if (!tree || node == tree->nil) return NULL;
+
+    // 1. node의 오른쪽 서브트리가 있으면
+    if (node->right != tree->nil)
+    {
+        node_t* now = node->right;
 
         while (now->left != tree->nil)
         {
@@ -401,6 +1101,63 @@ static node_t* tree_successor(const rbtree* tree, node_t* node)
     return y;
 }
 
+/*
+ * 석세서의 대칭
+ */
+static node_t* tree_predecessor(const rbtree* tree, node_t* node)
+{
+    if (node->left != tree->nil)
+    {
+        node_t* now = node->left;
+
+        while (now->right != tree->nil)
+        {
+            now = now->right;
+        }
+
+        return now;
+    }
+
+    node_t* y = node->parent;
+
+    while (y != tree->nil && node == y->left)
+    {
+        node = y;
+        y = y->parent;
+    }
+
+    return y;
+}
+
+/*
+ * 중위순회 기준 다음/이전 노드, 끝이면 tree->nil (dead 노드는 건너뜀)
+ * rbtree_prev(tree, tree->nil)은 최대값 노드 (반복자의 end()에서 한 칸 뒤로)
+ */
+node_t* rbtree_next(const rbtree* tree, const node_t* node)
+{
+    node_t* now = tree_successor(tree, (node_t*)node);
+
+    while (now && now != tree->nil && now->dead)
+    {
+        now = tree_successor(tree, now);
+    }
+    return now;
+}
+
+node_t* rbtree_prev(const rbtree* tree, const node_t* node)
+{
+    if (!tree) return NULL;
+    if (node == tree->nil) return tree_max(tree);
+
+    node_t* now = tree_predecessor(tree, (node_t*)node);
+
+    while (now != tree->nil && now->dead)
+    {
+        now = tree_predecessor(tree, now);
+    }
+    return now;
+}
+
 /*
  * 삭제 후 트리 규칙 복구
  * Case 1) 삭제할 노드가 red : 걍 삭제함(erase_fixup을 적용안함)
@@ -571,51 +1328,312 @@ static void erase_fixup(rbtree* tree, node_t* x)
 }
 
 /*
- * 1. 삭제 대상 노드(node)가 자식이 0개 또는 1개면 node가 직접 삭제됨.
- *    -> 자식이 2개면 석세서를 찾아 node의 key값만 교체하고 node_erase를 삭제.
- * 2. 삭제를 위해 node_erase의 자식(x)와 부모 연결을 갱신.
- * 3. 실제 삭제는 항상 자식이 0개 또는 1개인 노드(y)에서 발생
+ * u 자리에 v를 연결 (v가 nil이어도 부모를 기록)
+ */
+static void transplant(rbtree* tree, node_t* u, node_t* v)
+{
+    if (u->parent == tree->nil)
+    {
+        tree->root = v;
+    }
+    else if (u == u->parent->left)
+    {
+        u->parent->left = v;
+    }
+    else
+    {
+        u->parent->right = v;
+    }
+    v->parent = u->parent;
+}
+
+/*
+ * 1. 삭제 대상 노드(node)가 자식이 0개 또는 1개면 자식(x)을 node 자리에 연결
+ * 2. 자식이 2개면 석세서(y)를 제자리에서 떼어 node 자리로 옮기고 node의 색을 물려받게 함
+ *    -> key를 옮기지 않으므로 node 말고 다른 노드의 포인터는 전부 그대로 유효
+ * 3. 구조상 빠진 색은 y가 원래 있던 자리(x)에서 재조정
+ * 트리에서 떼어낸 node를 해제하지 않고 반환
+ */
+static node_t* erase_node(rbtree* tree, node_t* node)
+{
+    key_t key = node->key;
+
+    // y: 구조상 빠지는 자리의 노드 (자식이 둘이면 석세서), x: y 자리를 채우는 y의 자식
+    node_t* y = (node->left == tree->nil || node->right == tree->nil) ? node : tree_successor(tree, node);
+    node_t* x = (y->left != tree->nil) ? y->left : y->right;
+    color_t removed_color = y->color;
+
+    if (y == node)
+    {
+        transplant(tree, node, x);
+    }
+    else
+    {
+        if (y->parent == node)
+        {
+            x->parent = y;  // x가 nil이어도 erase_fixup이 부모를 따라가야 하므로 기록
+        }
+        else
+        {
+            // 석세서를 제자리에서 떼어냄 (석세서는 왼쪽 자식이 없음)
+            transplant(tree, y, x);
+            y->right = node->right;
+            y->right->parent = y;
+        }
+        transplant(tree, node, y);
+        y->left = node->left;
+        y->left->parent = y;
+        y->color = node->color;
+    }
+
+    // x의 부모부터 위로 augment 갱신 (옮겨진 y도 이 경로 위에 있음)
+    if (tree->update)
+    {
+        propagate(tree, x->parent);
+    }
+
+    // 빠진 자리가 BLACK이면 재조정
+    if (removed_color == RBTREE_BLACK)
+    {
+        erase_fixup(tree, x);
+    }
+
+    // 색인이 지운 노드를 가리키면 남은 같은 key 노드로
+    if (tree->index && hash_index_get(tree->index, key) == node)
+    {
+        index_refresh(tree, key);
+    }
+
+    if (node->dead)
+    {
+        tree->dead_count--;
+    }
+    tree->size--;
+    if (tree->bloom)
+    {
+        bloom_note_erase(tree);
+    }
+    return node;
+}
+
+/*
+ * 노드 삭제 (lazy 모드면 dead 표시만)
  */
 int rbtree_erase(rbtree* tree, node_t* node)
 {
     if (!tree || node == tree->nil) return 0;
 
-    // node_erase: 실제로 삭제될 노드
-    node_t* node_erase = (node->left == tree->nil || node->right == tree->nil) ? node : tree_successor(tree, node);
+    key_t key = node->key;
+    if (tree->trace) trace_record(tree->trace, TRACE_ERASE, key, 1);
+
+    // lazy 모드: 표시만 하고 끝 (O(1)), 쌓이면 한 번에 재구성
+    if (tree->lazy_ratio > 0)
+    {
+        if (node->dead) return 0;
+
+        node->dead = 1;
+        tree->dead_count++;
+        if (tree->bloom)
+        {
+            bloom_note_erase(tree);
+        }
+        if (tree->index && hash_index_get(tree->index, key) == node)
+        {
+            index_refresh(tree, key);
+        }
+        if (tree->dead_count > tree->lazy_ratio * tree->size)
+        {
+            rbtree_purge(tree);
+        }
+        return 0;
+    }
+
+    tree->min_cache = NULL;
+    free_node(tree, erase_node(tree, node));
+    return 0;
+}
+
+/*
+ * 중위순서로 노드를 하나씩 받아서 완전 균형 트리 구성, O(n)
+ * 왼쪽 (n-1)/2개, 오른쪽 n/2개로 나누면 모든 nil의 깊이가 h 또는 h+1 (h = floor(log2 n))
+ * -> 깊이 h인 노드만 red, 나머지 black이면 black 높이가 모두 같음
+ */
+static node_t* build_inorder(rbtree* tree, size_t n, int depth, int red_depth, node_t* (*next)(void*), void* ctx)
+{
+    if (n == 0) return tree->nil;
 
-    // x: node_erase의 자식, node_erase를 대체할 녀석
-    node_t* x = (node_erase->left != tree->nil) ? node_erase->left : node_erase->right;
+    size_t left_n = (n - 1) / 2;
+    node_t* left = build_inorder(tree, left_n, depth + 1, red_depth, next, ctx);
+    node_t* node = next(ctx);
+    node_t* right = build_inorder(tree, n - 1 - left_n, depth + 1, red_depth, next, ctx);
 
-    // x의 부모를 node_erase의 부모로 연결
-    x->parent = node_erase->parent;
+    node->left = left;
+    node->right = right;
+    if (left != tree->nil) left->parent = node;
+    if (right != tree->nil) right->parent = node;
+    node->color = (depth == red_depth) ? RBTREE_RED : RBTREE_BLACK;
+    node->dead = 0;
 
-    // 트리의 root가 삭제되는 경우 root를 x로 교체
-    if (node_erase->parent == tree->nil)
+    if (tree->update)
     {
-        tree->root = x;
+        tree->update(tree, node);
     }
-    else if (node_erase == node_erase->parent->left)
+    return node;
+}
+
+static void build_tree(rbtree* tree, size_t n, node_t* (*next)(void*), void* ctx)
+{
+    int red_depth = 0;
+    while (((size_t)2 << red_depth) <= n)
     {
-        node_erase->parent->left = x;
+        red_depth++;
     }
-    else
+
+    tree->root = build_inorder(tree, n, 0, red_depth, next, ctx);
+    tree->root->parent = tree->nil;
+    tree->root->color = RBTREE_BLACK;
+    tree->size = n;
+}
+
+static node_t* array_source(void* ctx)
+{
+    node_t*** cursor = (node_t***)ctx;
+    return *(*cursor)++;
+}
+
+static node_t* list_source(void* ctx)
+{
+    node_t** head = (node_t**)ctx;
+    node_t* node = *head;
+    *head = node->right;
+    return node;
+}
+
+/*
+ * 빈 트리를 오름차순 key n개로 O(n)에 채움 (삽입/회전 없이 한 번에 균형 트리)
+ * next_key가 key를 하나씩 주고, 실패하면 0이 아닌 값을 반환
+ * 노드를 먼저 다 만들어 right로 엮은 뒤 연결하므로 중간에 실패하거나 순서가 틀리면 트리는 빈 채로 -1
+ */
+int rbtree_build(rbtree* tree, size_t n, int (*next_key)(void* ctx, key_t* key), void* ctx)
+{
+    if (!tree || tree->root != tree->nil) return -1;
+
+    node_t* head = NULL;
+    node_t* tail = NULL;
+    size_t made = 0;
+    for (; made < n; ++made)
     {
-        node_erase->parent->right = x;
+        key_t key;
+        if (next_key(ctx, &key) != 0 || (tail && key < tail->key)) break;
+
+        node_t* node = rbtree_alloc_node(tree, key);
+        if (!node) break;
+
+        if (tail)
+        {
+            tail->right = node;
+        }
+        else
+        {
+            head = node;
+        }
+        tail = node;
     }
 
-    // 삭제 대상이 석세서(node_erase)라면 node의 key값만 node_erase의 key로 복사
-    if (node_erase != node)
+    if (made < n)
     {
-        node->key = node_erase->key;
+        while (made-- > 0)
+        {
+            node_t* next = head->right;
+            free_node(tree, head);
+            head = next;
+        }
+        return -1;
     }
 
-    // 삭제된 노드가 BLACK면 재조정
-    if (node_erase->color == RBTREE_BLACK)
+    build_tree(tree, n, list_source, &head);
+    tree->dead_count = 0;
+    tree->min_cache = NULL;
+    if (tree->index)
     {
-        erase_fixup(tree, x);
+        rbtree_disable_index(tree);
+        rbtree_enable_index(tree);
+    }
+    if (tree->bloom)
+    {
+        bloom_rebuild(tree, n);
+    }
+    return 0;
+}
+
+/*
+ * dead 노드를 실제로 해제하고 살아있는 노드들로 트리를 한 번에 다시 만듦
+ * erase_fixup/회전을 삭제마다 하는 대신 O(n) 한 번으로 몰아서 처리
+ * 살아있는 노드의 주소는 그대로라 포인터/색인은 유효
+ */
+void rbtree_purge(rbtree* tree)
+{
+    if (!tree || tree->dead_count == 0) return;
+
+    node_t** nodes = (node_t**)malloc(tree->size * sizeof(node_t*));
+    if (!nodes) return;  // 메모리가 없으면 다음 기회에
+
+    size_t live = 0;
+    size_t dead = tree->size;
+    // 전체 중위순회: 살아있는 노드는 앞에서부터, dead 노드는 뒤에서부터 채움
+    node_t* now = tree->root;
+    if (now != tree->nil)
+    {
+        while (now->left != tree->nil)
+        {
+            now = now->left;
+        }
+    }
+    while (now != tree->nil)
+    {
+        if (now->dead)
+        {
+            nodes[--dead] = now;
+        }
+        else
+        {
+            nodes[live++] = now;
+        }
+        now = tree_successor(tree, now);
+    }
+
+    for (size_t i = dead; i < tree->size; ++i)
+    {
+        free_node(tree, nodes[i]);
+    }
+
+    node_t** cursor = nodes;
+    build_tree(tree, live, array_source, &cursor);
+    tree->dead_count = 0;
+    free(nodes);
+}
+
+/*
+ * lazy erase 모드 설정
+ * max_dead_ratio (0, 1]: rbtree_erase는 노드를 dead로 표시만 하고, dead 비율이 이 값을 넘으면 rbtree_purge
+ * 0 이하: 즉시 삭제 모드로 돌아감 (남은 dead 노드는 바로 정리)
+ * augment 트리는 dead 노드가 집계에 섞이므로, top-K 모드는 최솟값 교체와 섞이므로 지원 안 함
+ */
+int rbtree_set_lazy_erase(rbtree* tree, double max_dead_ratio)
+{
+    if (!tree || max_dead_ratio > 1) return -1;
+
+    if (max_dead_ratio <= 0)
+    {
+        rbtree_purge(tree);
+        if (tree->dead_count > 0) return -1;
+        tree->lazy_ratio = 0;
+        return 0;
     }
 
-    free(node_erase);
+    if (tree->update || tree->capacity) return -1;
+
+    tree->lazy_ratio = max_dead_ratio;
     return 0;
 }
 
@@ -624,11 +1642,12 @@ int rbtree_erase(rbtree* tree, node_t* node)
  */
 static void to_array_inorder(const rbtree* tree, node_t* node, key_t* arr, size_t* i, size_t n_size)
 {
-    if (node == tree->nil) return;
+    // 배열이 찼으면 나머지 서브트리는 볼 필요 없음
+    if (node == tree->nil || *i >= n_size) return;
 
     to_array_inorder(tree, node->left, arr, i, n_size);
 
-    if (*i < n_size)
+    if (*i < n_size && !node->dead)
     {
         // 여기서 arr[*i++]로 해버린 실수
         arr[(*i)++] = node->key;
@@ -643,10 +1662,353 @@ static void to_array_inorder(const rbtree* tree, node_t* node, key_t* arr, size_
 int rbtree_to_array(const rbtree* tree, key_t* arr, const size_t n)
 {
     size_t i = 0;
+    if (tree->trace) trace_record(tree->trace, TRACE_TO_ARRAY, (int64_t)n, 1);
     to_array_inorder(tree, tree->root, arr, &i, n);
     return (int)i;
 }
 
+/*
+ * 병렬 순회: 위쪽 몇 레벨에서 트리를 서브트리(task)로 나누고
+ * 1) 서브트리마다 살아 있는 노드 수를 세고 (병렬)
+ * 2) 앞에서부터 누적해서 각 서브트리의 시작 순번을 정한 뒤
+ * 3) 서브트리마다 겹치지 않는 구간을 채움 (병렬)
+ * task는 스레드들이 하나씩 가져가므로 서브트리 크기가 달라도 고르게 나뉨
+ */
+#define PARALLEL_MIN_NODES 65536      // 이보다 작으면 스레드 만드는 비용이 더 큼
+#define PARALLEL_TASKS_PER_THREAD 8
+#define PARALLEL_MAX_THREADS 256
+
+typedef struct {
+    node_t* node;
+    int whole;     // 1이면 node의 서브트리 전체, 0이면 node 하나 (나눈 위쪽 노드)
+    size_t count;  // 살아 있는 노드 수
+    size_t rank;   // 첫 노드의 순번
+} parallel_task_t;
+
+typedef struct {
+    const rbtree* tree;
+    parallel_task_t* tasks;
+    size_t task_count;
+    size_t next;   // 다음에 가져갈 task (원자적으로 증가)
+    int counting;  // 1이면 1단계, 0이면 3단계
+    key_t* arr;    // to_array면 출력 배열, 아니면 NULL
+    size_t limit;  // 이 순번부터는 내보내지 않음
+    rbtree_visit_t visit;
+    void* ctx;
+} parallel_job_t;
+
+static void split_tasks(const rbtree* tree, node_t* node, int depth, parallel_task_t* tasks, size_t* k)
+{
+    if (node == tree->nil) return;
+
+    if (depth == 0)
+    {
+        tasks[(*k)++] = (parallel_task_t){node, 1, 0, 0};
+        return;
+    }
+    split_tasks(tree, node->left, depth - 1, tasks, k);
+    tasks[(*k)++] = (parallel_task_t){node, 0, 0, 0};
+    split_tasks(tree, node->right, depth - 1, tasks, k);
+}
+
+static size_t count_live(const rbtree* tree, const node_t* node)
+{
+    size_t count = 0;
+    while (node != tree->nil)
+    {
+        count += count_live(tree, node->left) + !node->dead;
+        node = node->right;
+    }
+    return count;
+}
+
+static void emit_node(const parallel_job_t* job, node_t* node, size_t rank)
+{
+    if (job->arr)
+    {
+        job->arr[rank] = node->key;
+    }
+    else
+    {
+        job->visit(job->ctx, node, rank);
+    }
+}
+
+static void emit_inorder(const parallel_job_t* job, node_t* node, size_t* rank)
+{
+    while (node != job->tree->nil && *rank < job->limit)
+    {
+        emit_inorder(job, node->left, rank);
+        if (*rank < job->limit && !node->dead)
+        {
+            emit_node(job, node, (*rank)++);
+        }
+        node = node->right;
+    }
+}
+
+static void* parallel_worker(void* arg)
+{
+    parallel_job_t* job = (parallel_job_t*)arg;
+    for (;;)
+    {
+        size_t i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED);
+        if (i >= job->task_count) break;
+
+        parallel_task_t* task = &job->tasks[i];
+        if (job->counting)
+        {
+            task->count = task->whole ? count_live(job->tree, task->node) : !task->node->dead;
+        }
+        else if (task->rank < job->limit)
+        {
+            size_t rank = task->rank;
+            if (task->whole)
+            {
+                emit_inorder(job, task->node, &rank);
+            }
+            else if (!task->node->dead)
+            {
+                emit_node(job, task->node, rank);
+            }
+        }
+    }
+    return NULL;
+}
+
+// 부른 스레드도 같이 일함, 스레드를 못 만들면 있는 스레드로만 진행
+static void parallel_run(parallel_job_t* job, int threads)
+{
+    pthread_t ids[PARALLEL_MAX_THREADS];
+    int started = 0;
+
+    job->next = 0;
+    for (; started < threads - 1; ++started)
+    {
+        if (pthread_create(&ids[started], NULL, parallel_worker, job) != 0) break;
+    }
+    parallel_worker(job);
+    for (int t = 0; t < started; ++t)
+    {
+        pthread_join(ids[t], NULL);
+    }
+}
+
+// 내보낸 노드 수 반환, 메모리가 없으면 한 스레드로 처리
+static size_t parallel_inorder(parallel_job_t* job, int threads)
+{
+    const rbtree* tree = job->tree;
+    if (threads <= 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (int)online : 1;
+    }
+    if (threads > PARALLEL_MAX_THREADS)
+    {
+        threads = PARALLEL_MAX_THREADS;
+    }
+
+    // 나눌 깊이: 서브트리가 스레드당 PARALLEL_TASKS_PER_THREAD개쯤 되도록
+    int depth = 0;
+    if (threads > 1 && tree->size >= PARALLEL_MIN_NODES)
+    {
+        while (((size_t)1 << depth) < (size_t)threads * PARALLEL_TASKS_PER_THREAD)
+        {
+            depth++;
+        }
+    }
+
+    parallel_task_t* tasks = depth ? (parallel_task_t*)malloc(((size_t)2 << depth) * sizeof(parallel_task_t)) : NULL;
+    if (!tasks)
+    {
+        size_t rank = 0;
+        emit_inorder(job, tree->root, &rank);
+        return rank;
+    }
+
+    size_t k = 0;
+    split_tasks(tree, tree->root, depth, tasks, &k);
+    job->tasks = tasks;
+    job->task_count = k;
+
+    job->counting = 1;
+    parallel_run(job, threads);
+
+    size_t rank = 0;
+    for (size_t i = 0; i < k; ++i)
+    {
+        tasks[i].rank = rank;
+        rank += tasks[i].count;
+    }
+
+    job->counting = 0;
+    parallel_run(job, threads);
+
+    free(tasks);
+    return rank < job->limit ? rank : job->limit;
+}
+
+/*
+ * rbtree_to_array와 결과가 같음, threads가 0 이하면 온라인 코어 수
+ */
+int rbtree_to_array_parallel(const rbtree* tree, key_t* arr, const size_t n, int threads)
+{
+    if (tree->trace) trace_record(tree->trace, TRACE_TO_ARRAY, (int64_t)n, 1);
+
+    parallel_job_t job = {.tree = tree, .arr = arr, .limit = n};
+    return (int)parallel_inorder(&job, threads);
+}
+
+/*
+ * 살아 있는 모든 노드에 visit(ctx, node, 중위 순번) 호출, threads가 1이면 순서대로
+ * 여러 스레드면 서로 다른 노드에 동시에 불리므로 visit은 자기 노드/순번에 해당하는 것만 건드려야 함
+ * 순회하는 동안 트리를 바꾸면 안 됨
+ */
+void rbtree_foreach(const rbtree* tree, rbtree_visit_t visit, void* ctx, int threads)
+{
+    parallel_job_t job = {.tree = tree, .limit = SIZE_MAX, .visit = visit, .ctx = ctx};
+    parallel_inorder(&job, threads);
+}
+
+static size_t count_nodes(const rbtree* tree, const node_t* node)
+{
+    if (node == tree->nil) return 0;
+    return 1 + count_nodes(tree, node->left) + count_nodes(tree, node->right);
+}
+
+static int tree_height(const rbtree* tree, const node_t* node)
+{
+    if (node == tree->nil) return 0;
+
+    int l = tree_height(tree, node->left);
+    int r = tree_height(tree, node->right);
+    return 1 + (l > r ? l : r);
+}
+
+static void veb_order(const rbtree* tree, node_t* node, int height, node_t** order, size_t* i);
+
+/*
+ * node에서 depth만큼 내려간 노드들(아래쪽 서브트리의 루트)을 왼쪽부터 차례로 배치
+ */
+static void veb_bottom(const rbtree* tree, node_t* node, int depth, int height, node_t** order, size_t* i)
+{
+    if (node == tree->nil) return;
+
+    if (depth == 0)
+    {
+        veb_order(tree, node, height, order, i);
+        return;
+    }
+    veb_bottom(tree, node->left, depth - 1, height, order, i);
+    veb_bottom(tree, node->right, depth - 1, height, order, i);
+}
+
+/*
+ * van Emde Boas 순서
+ * 높이 h인 서브트리를 위쪽 h/2 레벨과 그 아래 서브트리들로 나눠서 각각을 재귀적으로 연속 배치
+ * 어떤 블록 크기(캐시 라인, 페이지)에서도 한 번의 탐색이 건드리는 블록 수가 O(log_B n)
+ */
+static void veb_order(const rbtree* tree, node_t* node, int height, node_t** order, size_t* i)
+{
+    if (node == tree->nil) return;
+
+    if (height == 1)
+    {
+        order[(*i)++] = node;
+        return;
+    }
+
+    int top = height / 2;
+    veb_order(tree, node, top, order, i);
+    veb_bottom(tree, node, top, height - top, order, i);
+}
+
+/*
+ * 모든 노드를 하나의 연속 블록에 vEB 순서로 다시 배치
+ * 이후에도 삽입/삭제 가능 (삭제된 블록 노드는 free_list로 재사용, 새 노드는 원래 할당자)
+ * 이전 노드/블록은 해제하고 glibc에서는 malloc_trim으로 OS에 반환
+ * 주의: 기존 node_t* 는 전부 무효가 됨
+ */
+int rbtree_compact(rbtree* tree)
+{
+    if (!tree) return -1;
+
+    // dead 노드나 재사용 대기 노드까지 옮길 필요는 없음
+    rbtree_purge(tree);
+    release_spare(tree);
+
+    size_t n = count_nodes(tree, tree->root);
+    char* old_block = tree->block;
+    size_t ns = tree->node_size;
+
+    node_t** order = NULL;
+    char* block = NULL;
+    if (n > 0)
+    {
+        order = (node_t**)malloc(n * sizeof(node_t*));
+        if (!order || posix_memalign((void**)&block, 64, n * ns) != 0)
+        {
+            free(order);
+            return -1;
+        }
+
+        size_t i = 0;
+        veb_order(tree, tree->root, tree_height(tree, tree->root), order, &i);
+
+        for (i = 0; i < n; ++i)
+        {
+            memcpy(block + i * ns, order[i], ns);
+        }
+
+        // 옛 노드의 parent 칸에 새 주소를 적어두고(forwarding) 그걸로 링크를 옮김
+        for (i = 0; i < n; ++i)
+        {
+            order[i]->parent = (node_t*)(block + i * ns);
+        }
+        for (i = 0; i < n; ++i)
+        {
+            node_t* node = (node_t*)(block + i * ns);
+            if (node->left != tree->nil) node->left = node->left->parent;
+            if (node->right != tree->nil) node->right = node->right->parent;
+            if (node->parent != tree->nil) node->parent = node->parent->parent;
+        }
+        tree->root = tree->root->parent;
+
+        // 이 시점의 tree->block은 아직 이전 블록
+        for (i = 0; i < n; ++i)
+        {
+            if (!in_block(tree, order[i]))
+            {
+                node_release(tree, order[i]);
+            }
+        }
+        free(order);
+    }
+    else
+    {
+        tree->root = tree->nil;
+    }
+
+    tree->block = block;
+    tree->block_bytes = n * ns;
+    tree->free_list = NULL;
+    tree->min_cache = NULL;
+    tree->nil->parent = tree->nil;
+    free(old_block);
+
+    // 노드 주소가 모두 바뀌었으니 색인도 다시 만듦
+    if (tree->index)
+    {
+        rbtree_disable_index(tree);
+        rbtree_enable_index(tree);
+    }
+
+#ifdef __GLIBC__
+    malloc_trim(0);
+#endif
+    return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void print_rbtree_rec(const rbtree* tree, node_t* node, int depth, char branch) {
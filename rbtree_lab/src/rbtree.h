@@ -3,30 +3,101 @@
 
 #include <stddef.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef enum { RBTREE_RED, RBTREE_BLACK } color_t;
 
 typedef int key_t;
 
 typedef struct node_t {
-  color_t color;
+  unsigned int color : 1;  // color_t, enum 비트필드는 부호가 구현마다 달라서 unsigned로 둠
+  unsigned int dead : 1;  // lazy erase로 표시만 된 노드 (find/순회에서 건너뜀)
   key_t key;
   struct node_t *parent, *left, *right;
 } node_t;
 
+struct rbtree;
+
+// 노드 메모리 할당자, size는 항상 tree->node_size
 typedef struct {
+  void *(*alloc)(void *ctx, size_t size);
+  void (*dealloc)(void *ctx, void *ptr, size_t size);
+  void *ctx;
+} rbtree_allocator_t;
+
+// augment 갱신 훅: node의 자식들이 최신이라고 보고 node의 부가 정보를 다시 계산
+typedef void (*rbtree_update_t)(const struct rbtree *, node_t *);
+
+typedef struct rbtree {
   node_t *root;
   node_t *nil;  // for sentinel
+  size_t node_size;        // node_t 뒤에 붙는 augment 영역까지 포함한 노드 크기
+  rbtree_update_t update;  // NULL이면 augment 없음
+  const void *aux;         // update 훅이 쓰는 트리별 데이터
+  char *block;             // rbtree_compact로 재배치된 노드 블록
+  size_t block_bytes;
+  node_t *free_list;       // block 안에서 삭제된 노드 (right로 연결)
+  node_t *spare;           // rbtree_clear로 비운 노드들 (재사용 대기, nil이면 없음)
+  struct hash_index *index;  // exact-match 색인 (NULL이면 꺼짐)
+  struct bloom_filter *bloom;  // 없는 key 거르기 (NULL이면 꺼짐)
+  struct rbtree_trace *trace;  // 호출 기록 (NULL이면 꺼짐, trace.h)
+  rbtree_allocator_t allocator;  // alloc이 NULL이면 calloc/free
+  size_t size;             // 연결된 노드 수 (dead 포함)
+  size_t dead_count;
+  double lazy_ratio;       // 0보다 크면 lazy erase, dead 비율이 이걸 넘으면 rbtree_purge
+  size_t capacity;         // 0보다 크면 top-K 모드 (가득 차면 최솟값 교체)
+  node_t *min_cache;       // top-K 모드에서 기억해 둔 최솟값 노드 (NULL이면 다시 찾음)
 } rbtree;
 
 rbtree *new_rbtree(void);
+rbtree *new_rbtree_augmented(size_t node_size, rbtree_update_t update);
 void delete_rbtree(rbtree *);
+int rbtree_destroy_step(rbtree *, size_t budget);
+int rbtree_destroy_async(rbtree *);
+void rbtree_clear(rbtree *);
+int rbtree_set_allocator(rbtree *, const rbtree_allocator_t *);
 
+// 할당 실패면 NULL, top-K 모드에서 최솟값보다 크지 않아서 버린 key면 tree->nil
 node_t *rbtree_insert(rbtree *, const key_t);
+node_t *rbtree_alloc_node(rbtree *, const key_t);
+node_t *rbtree_insert_node(rbtree *, node_t *);
+void rbtree_link_node(rbtree *, node_t *parent, int is_left, node_t *);
+int rbtree_set_capacity(rbtree *, size_t capacity);
 node_t *rbtree_find(const rbtree *, const key_t);
+
+#define RBTREE_BATCH_GROUP 16
+void rbtree_find_batch(const rbtree *, const key_t *, size_t, node_t **);
+
 node_t *rbtree_min(const rbtree *);
 node_t *rbtree_max(const rbtree *);
 int rbtree_erase(rbtree *, node_t *);
 
+int rbtree_set_lazy_erase(rbtree *, double max_dead_ratio);
+void rbtree_purge(rbtree *);
+int rbtree_build(rbtree *, size_t n, int (*next_key)(void *ctx, key_t *key), void *ctx);
+
+node_t *rbtree_next(const rbtree *, const node_t *);
+node_t *rbtree_prev(const rbtree *, const node_t *);
+
 int rbtree_to_array(const rbtree *, key_t *, const size_t);
 
+// 위쪽 레벨에서 나눈 서브트리들을 threads개 스레드로 나눠 순회 (0 이하면 코어 수)
+typedef void (*rbtree_visit_t)(void *ctx, node_t *node, size_t rank);
+int rbtree_to_array_parallel(const rbtree *, key_t *, const size_t, int threads);
+void rbtree_foreach(const rbtree *, rbtree_visit_t visit, void *ctx, int threads);
+
+int rbtree_compact(rbtree *);
+
+int rbtree_enable_index(rbtree *);
+void rbtree_disable_index(rbtree *);
+
+int rbtree_enable_bloom(rbtree *);
+void rbtree_disable_bloom(rbtree *);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif  // _RBTREE_H_
@@ -0,0 +1,243 @@
+#ifndef _RBTREE_HPP_
+#define _RBTREE_HPP_
+
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <utility>
+
+#include "rbtree.h"
+
+namespace rb {
+
+// rbtree를 그대로 감싼 header-only multiset
+// - 소유권은 move만 가능 (복사 금지)
+// - 반복자는 rbtree_next/rbtree_prev 기반 양방향 반복자라 range-for, std:: 알고리즘에 바로 사용
+// - std::pmr::memory_resource를 넘기면 노드 메모리를 거기서 할당
+class multiset {
+ public:
+  using key_type = key_t;
+  using value_type = key_t;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = const key_t &;
+  using const_reference = const key_t &;
+  using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+  class const_iterator {
+   public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = key_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const key_t *;
+    using reference = const key_t &;
+
+    const_iterator() = default;
+
+    reference operator*() const { return node_->key; }
+    pointer operator->() const { return &node_->key; }
+
+    const_iterator &operator++() {
+      node_ = rbtree_next(tree_, node_);
+      return *this;
+    }
+    const_iterator operator++(int) {
+      const_iterator old = *this;
+      ++*this;
+      return old;
+    }
+    const_iterator &operator--() {
+      node_ = rbtree_prev(tree_, node_);
+      return *this;
+    }
+    const_iterator operator--(int) {
+      const_iterator old = *this;
+      --*this;
+      return old;
+    }
+
+    bool operator==(const const_iterator &other) const { return node_ == other.node_; }
+    bool operator!=(const const_iterator &other) const { return node_ != other.node_; }
+
+    node_t *node() const { return node_; }
+
+   private:
+    friend class multiset;
+    const_iterator(const rbtree *tree, node_t *node) : tree_(tree), node_(node) {}
+
+    const rbtree *tree_ = nullptr;
+    node_t *node_ = nullptr;
+  };
+  using iterator = const_iterator;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using reverse_iterator = const_reverse_iterator;
+
+  multiset() : multiset(static_cast<std::pmr::memory_resource *>(nullptr)) {}
+
+  // resource가 NULL이면 rbtree 기본 할당(calloc/free)
+  explicit multiset(std::pmr::memory_resource *resource) : resource_(resource) { reset(); }
+  explicit multiset(const allocator_type &alloc) : multiset(alloc.resource()) {}
+
+  multiset(std::initializer_list<key_t> keys, std::pmr::memory_resource *resource = nullptr)
+      : multiset(resource) {
+    insert(keys.begin(), keys.end());
+  }
+
+  multiset(const multiset &) = delete;
+  multiset &operator=(const multiset &) = delete;
+
+  // 이동된 쪽은 소멸/대입만 가능
+  multiset(multiset &&other) noexcept
+      : tree_(std::exchange(other.tree_, nullptr)), resource_(other.resource_) {}
+
+  multiset &operator=(multiset &&other) noexcept {
+    if (this != &other) {
+      delete_rbtree(tree_);
+      tree_ = std::exchange(other.tree_, nullptr);
+      resource_ = other.resource_;
+    }
+    return *this;
+  }
+
+  ~multiset() { delete_rbtree(tree_); }
+
+  void swap(multiset &other) noexcept {
+    std::swap(tree_, other.tree_);
+    std::swap(resource_, other.resource_);
+  }
+
+  allocator_type get_allocator() const {
+    return allocator_type(resource_ ? resource_ : std::pmr::get_default_resource());
+  }
+
+  const_iterator begin() const { return const_iterator(tree_, rbtree_min(tree_)); }
+  const_iterator end() const { return const_iterator(tree_, tree_->nil); }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+  const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+  const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+  // native_handle()로 top-K/lazy erase를 켜도 맞도록 트리의 노드 수에서 바로 구함
+  bool empty() const { return size() == 0; }
+  size_type size() const { return tree_->size - tree_->dead_count; }
+
+  // top-K 모드에서 버려진 key면 end()
+  iterator insert(key_t key) {
+    node_t *node = rbtree_insert(tree_, key);
+    if (!node) throw std::bad_alloc();
+    return iterator(tree_, node);
+  }
+
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) insert(*first);
+  }
+
+  template <class... Args>
+  iterator emplace(Args &&...args) {
+    return insert(key_t(std::forward<Args>(args)...));
+  }
+
+  // 지운 원소의 다음 위치 반환
+  iterator erase(const_iterator pos) {
+    node_t *node = pos.node_;
+    // rbtree_erase는 지운 노드 말고 다른 노드를 옮기거나 해제하지 않으므로 미리 구한 다음 노드가 그대로 유효
+    node_t *next = rbtree_next(tree_, node);
+    rbtree_erase(tree_, node);
+    return iterator(tree_, next);
+  }
+
+  size_type erase(key_t key) {
+    size_type n = 0;
+    for (node_t *node = rbtree_find(tree_, key); node; node = rbtree_find(tree_, key)) {
+      rbtree_erase(tree_, node);
+      ++n;
+    }
+    return n;
+  }
+
+  // 노드 메모리는 트리에 남겨서 이후 insert에 재사용
+  void clear() noexcept {
+    rbtree_clear(tree_);
+  }
+
+  const_iterator find(key_t key) const {
+    node_t *node = rbtree_find(tree_, key);
+    return node ? const_iterator(tree_, node) : end();
+  }
+
+  bool contains(key_t key) const { return rbtree_find(tree_, key) != nullptr; }
+
+  // key 이상인 첫 원소
+  const_iterator lower_bound(key_t key) const {
+    node_t *res = tree_->nil;
+    for (node_t *node = tree_->root; node != tree_->nil;) {
+      if (node->key < key) {
+        node = node->right;
+      } else {
+        res = node;
+        node = node->left;
+      }
+    }
+    return const_iterator(tree_, res);
+  }
+
+  // key 초과인 첫 원소
+  const_iterator upper_bound(key_t key) const {
+    node_t *res = tree_->nil;
+    for (node_t *node = tree_->root; node != tree_->nil;) {
+      if (node->key <= key) {
+        node = node->right;
+      } else {
+        res = node;
+        node = node->left;
+      }
+    }
+    return const_iterator(tree_, res);
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(key_t key) const {
+    return {lower_bound(key), upper_bound(key)};
+  }
+
+  size_type count(key_t key) const {
+    auto range = equal_range(key);
+    return static_cast<size_type>(std::distance(range.first, range.second));
+  }
+
+  rbtree *native_handle() const { return tree_; }
+
+ private:
+  // C 코드 안으로 예외가 넘어가지 않도록 실패는 NULL로 돌려줌
+  static void *resource_alloc(void *ctx, std::size_t size) {
+    try {
+      return static_cast<std::pmr::memory_resource *>(ctx)->allocate(size, alignof(node_t));
+    } catch (...) {
+      return nullptr;
+    }
+  }
+
+  static void resource_dealloc(void *ctx, void *ptr, std::size_t size) {
+    static_cast<std::pmr::memory_resource *>(ctx)->deallocate(ptr, size, alignof(node_t));
+  }
+
+  void reset() {
+    tree_ = new_rbtree();
+    if (!tree_) throw std::bad_alloc();
+    if (resource_) {
+      rbtree_allocator_t allocator = {resource_alloc, resource_dealloc, resource_};
+      rbtree_set_allocator(tree_, &allocator);
+    }
+  }
+
+  rbtree *tree_ = nullptr;
+  std::pmr::memory_resource *resource_ = nullptr;
+};
+
+inline void swap(multiset &a, multiset &b) noexcept { a.swap(b); }
+
+}  // namespace rb
+
+#endif  // _RBTREE_HPP_
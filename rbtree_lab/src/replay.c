@@ -0,0 +1,194 @@
+#include "rbtree.h"
+#include "trace.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * rbtree_trace_start로 기록한 트레이스를 빈 트리에 다시 실행하고 처리량과 연산별 지연 출력
+ * ./replay [--paced] <trace>
+ *   기본: 기록된 순서대로 최대한 빨리
+ *   --paced: 기록된 시각에 맞춰 실행 (늦게 시작한 정도를 lag로 따로 보고)
+ * rbtree.h 핵심 API만 쓰므로 replay-<backend>로 다른 구현에도 그대로 돌릴 수 있음
+ */
+
+static const char* op_names[] = {"", "insert", "find", "erase", "min", "max", "to_array"};
+#define OP_COUNT 7
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u32(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// 정렬된 v에서 q 분위수
+static uint32_t percentile(const uint32_t* v, size_t n, double q)
+{
+    size_t i = (size_t)(q * (double)(n - 1) + 0.5);
+    return v[i];
+}
+
+// 기록 시각까지 기다림: 멀면 잠들고 가까우면 돌면서
+static void wait_until(uint64_t deadline)
+{
+    for (uint64_t now = now_ns(); now < deadline; now = now_ns())
+    {
+        if (deadline - now > 200000)
+        {
+            uint64_t sleep_ns = deadline - now - 100000;
+            struct timespec ts = {(time_t)(sleep_ns / 1000000000u), (long)(sleep_ns % 1000000000u)};
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+/*
+ * 시간을 재기 전 준비: erase는 지울 노드를 미리 찾아 둠 (없으면 NULL)
+ * 기록된 건 지운 노드의 key, 같은 key 노드끼리는 구별할 필요가 없음
+ */
+static node_t* prepare(rbtree* tree, const trace_op_t* op)
+{
+    return op->op == TRACE_ERASE ? rbtree_find(tree, (key_t)op->arg) : NULL;
+}
+
+/*
+ * 연산 하나 실행, 결과가 기록과 같으면 1
+ * erase는 prepare가 찾은 노드를 지우기만 해서 rbtree_erase 시간만 잼
+ */
+static int apply(rbtree* tree, const trace_op_t* op, node_t* target, key_t* arr, size_t arr_cap)
+{
+    node_t* node;
+    switch (op->op)
+    {
+    case TRACE_INSERT:
+        node = rbtree_insert(tree, (key_t)op->arg);
+        return (node != NULL && node != tree->nil) == op->hit;
+    case TRACE_FIND:
+        return (rbtree_find(tree, (key_t)op->arg) != NULL) == op->hit;
+    case TRACE_ERASE:
+        rbtree_erase(tree, target);
+        return 1;
+    case TRACE_MIN:
+        return (rbtree_min(tree) != tree->nil) == op->hit;
+    case TRACE_MAX:
+        return (rbtree_max(tree) != tree->nil) == op->hit;
+    case TRACE_TO_ARRAY:
+        rbtree_to_array(tree, arr, (size_t)op->arg < arr_cap ? (size_t)op->arg : arr_cap);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int paced = argc > 2 && strcmp(argv[1], "--paced") == 0;
+    if (argc != 2 + paced)
+    {
+        fprintf(stderr, "usage: %s [--paced] <trace>\n", argv[0]);
+        return 2;
+    }
+
+    trace_op_t* ops;
+    size_t n;
+    if (trace_load(argv[1 + paced], &ops, &n) != 0)
+    {
+        fprintf(stderr, "%s: cannot read trace\n", argv[1 + paced]);
+        return 1;
+    }
+
+    // to_array 버퍼는 트리가 가질 수 있는 최대 크기(insert 수)까지만
+    size_t inserts = 0, arr_cap = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        inserts += ops[i].op == TRACE_INSERT;
+        if (ops[i].op == TRACE_TO_ARRAY && (size_t)ops[i].arg > arr_cap) arr_cap = (size_t)ops[i].arg;
+    }
+    if (arr_cap > inserts) arr_cap = inserts;
+
+    key_t* arr = (key_t*)malloc((arr_cap + 1) * sizeof(key_t));
+    uint32_t* lat = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    uint32_t* lag = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    char* untimed = (char*)calloc(n + 1, 1);  // 지울 노드가 없던 erase (불일치로만 셈)
+    rbtree* tree = new_rbtree();
+    if (!arr || !lat || !lag || !untimed || !tree)
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t mismatches = 0;
+    uint64_t start = now_ns();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (paced)
+        {
+            wait_until(start + ops[i].ns);
+        }
+        node_t* target = prepare(tree, &ops[i]);
+        uint64_t t0 = now_ns();
+        if (ops[i].op == TRACE_ERASE && !target)
+        {
+            untimed[i] = 1;
+            mismatches++;
+        }
+        else
+        {
+            mismatches += !apply(tree, &ops[i], target, arr, arr_cap);
+        }
+        uint64_t t1 = now_ns();
+
+        lat[i] = (uint32_t)(t1 - t0 < UINT32_MAX ? t1 - t0 : UINT32_MAX);
+        uint64_t late = paced ? t0 - (start + ops[i].ns) : 0;
+        lag[i] = (uint32_t)(late < UINT32_MAX ? late : UINT32_MAX);
+    }
+    double elapsed = (now_ns() - start) * 1e-9;
+    double recorded = n ? ops[n - 1].ns * 1e-9 : 0;
+
+    printf("%zu ops in %.3f s (recorded %.3f s), %.2f Mops/s%s\n", n, elapsed, recorded,
+           elapsed > 0 ? n / elapsed * 1e-6 : 0.0, paced ? ", paced" : "");
+    printf("%-9s %10s %9s %9s %9s %9s %10s\n", "op", "count", "mean ns", "p50", "p99", "p99.9", "max");
+
+    // 연산 종류별로 모아서 정렬 (lag도 같은 방식으로)
+    uint32_t* sorted = (uint32_t*)malloc((n + 1) * sizeof(uint32_t));
+    for (int kind = 1; kind <= OP_COUNT && sorted; ++kind)
+    {
+        const uint32_t* src = kind < OP_COUNT ? lat : lag;
+        if (kind == OP_COUNT && !paced) break;
+
+        size_t m = 0;
+        double sum = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            if (kind < OP_COUNT && (ops[i].op != kind || untimed[i])) continue;
+            sorted[m++] = src[i];
+            sum += src[i];
+        }
+        if (m == 0) continue;
+
+        qsort(sorted, m, sizeof(uint32_t), cmp_u32);
+        printf("%-9s %10zu %9.1f %9u %9u %9u %10u\n", kind < OP_COUNT ? op_names[kind] : "lag", m, sum / m,
+               percentile(sorted, m, 0.5), percentile(sorted, m, 0.99), percentile(sorted, m, 0.999), sorted[m - 1]);
+    }
+    if (mismatches)
+    {
+        printf("%zu ops returned a different result than recorded\n", mismatches);
+    }
+
+    delete_rbtree(tree);
+    free(sorted);
+    free(untimed);
+    free(lag);
+    free(lat);
+    free(arr);
+    free(ops);
+    return 0;
+}
@@ -0,0 +1,526 @@
+#include "shmtree.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define SHMTREE_MAGIC 0x52425348u  // "RBSH"
+#define SHM_NIL 0
+
+// 인덱스 링크를 포인터처럼 쓰기 위한 줄임말 (seg가 있는 함수 안에서만)
+#define P(x) (seg->nodes[x].parent)
+#define L(x) (seg->nodes[x].left)
+#define R(x) (seg->nodes[x].right)
+#define C(x) (seg->nodes[x].color)
+#define K(x) (seg->nodes[x].key)
+
+static shmtree* map_segment(int fd, size_t bytes)
+{
+    void* addr = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return NULL;
+
+    shmtree* st = (shmtree*)malloc(sizeof(shmtree));
+    if (!st)
+    {
+        munmap(addr, bytes);
+        return NULL;
+    }
+    st->seg = (shm_segment_t*)addr;
+    st->bytes = bytes;
+    return st;
+}
+
+/*
+ * 세그먼트 생성 후 헤더, nil, 프로세스 공유 rwlock 초기화
+ * 노드 칸은 고정이라 capacity를 넘는 삽입은 실패
+ */
+shmtree* shmtree_create(const char* name, size_t capacity)
+{
+    if (capacity >= UINT32_MAX) return NULL;
+
+    size_t bytes = sizeof(shm_segment_t) + (capacity + 1) * sizeof(shm_node_t);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) return NULL;
+
+    if (ftruncate(fd, (off_t)bytes) != 0)
+    {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    shmtree* st = map_segment(fd, bytes);
+    if (!st)
+    {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    shm_segment_t* seg = st->seg;
+    pthread_rwlockattr_t attr;
+    pthread_rwlockattr_init(&attr);
+    pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_rwlock_init(&seg->lock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+
+    // ftruncate한 영역은 0으로 채워져 있음 -> nil(0번)은 이미 black, 링크 0
+    C(SHM_NIL) = RBTREE_BLACK;
+    seg->bytes = bytes;
+    seg->root = SHM_NIL;
+    seg->free_list = SHM_NIL;
+    seg->capacity = (uint32_t)(capacity + 1);
+    seg->used = 1;
+    seg->size = 0;
+
+    // 초기화가 끝난 뒤에 magic을 써서 open 쪽이 반쯤 만든 세그먼트를 쓰지 않게 함
+    __atomic_store_n(&seg->magic, SHMTREE_MAGIC, __ATOMIC_RELEASE);
+    return st;
+}
+
+shmtree* shmtree_open(const char* name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(shm_segment_t))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    shmtree* st = map_segment(fd, (size_t)sb.st_size);
+    if (!st) return NULL;
+
+    if (__atomic_load_n(&st->seg->magic, __ATOMIC_ACQUIRE) != SHMTREE_MAGIC || st->seg->bytes != st->bytes)
+    {
+        shmtree_close(st);
+        return NULL;
+    }
+    return st;
+}
+
+void shmtree_close(shmtree* st)
+{
+    if (!st) return;
+
+    munmap(st->seg, st->bytes);
+    free(st);
+}
+
+int shmtree_unlink(const char* name)
+{
+    return shm_unlink(name);
+}
+
+/*
+ * 세그먼트 안의 할당기: free list 먼저, 없으면 아직 안 쓴 칸
+ */
+static shm_ref_t node_alloc(shm_segment_t* seg)
+{
+    shm_ref_t x = seg->free_list;
+    if (x != SHM_NIL)
+    {
+        seg->free_list = R(x);
+        return x;
+    }
+    if (seg->used == seg->capacity) return SHM_NIL;
+
+    return seg->used++;
+}
+
+static void node_free(shm_segment_t* seg, shm_ref_t x)
+{
+    R(x) = seg->free_list;
+    seg->free_list = x;
+}
+
+/*
+ * 회전/재조정은 rbtree.c와 같고 포인터만 인덱스로 바뀜
+ */
+static void left_rotate(shm_segment_t* seg, shm_ref_t x)
+{
+    shm_ref_t y = R(x);
+
+    R(x) = L(y);
+    if (L(y) != SHM_NIL)
+    {
+        P(L(y)) = x;
+    }
+
+    P(y) = P(x);
+    if (P(x) == SHM_NIL)
+    {
+        seg->root = y;
+    }
+    else if (x == L(P(x)))
+    {
+        L(P(x)) = y;
+    }
+    else
+    {
+        R(P(x)) = y;
+    }
+
+    L(y) = x;
+    P(x) = y;
+}
+
+static void right_rotate(shm_segment_t* seg, shm_ref_t y)
+{
+    shm_ref_t x = L(y);
+
+    L(y) = R(x);
+    if (R(x) != SHM_NIL)
+    {
+        P(R(x)) = y;
+    }
+
+    P(x) = P(y);
+    if (P(y) == SHM_NIL)
+    {
+        seg->root = x;
+    }
+    else if (y == R(P(y)))
+    {
+        R(P(y)) = x;
+    }
+    else
+    {
+        L(P(y)) = x;
+    }
+
+    R(x) = y;
+    P(y) = x;
+}
+
+static void insert_fixup(shm_segment_t* seg, shm_ref_t z)
+{
+    while (C(P(z)) == RBTREE_RED)
+    {
+        shm_ref_t p = P(z);
+        shm_ref_t pp = P(p);
+
+        if (p == L(pp))
+        {
+            shm_ref_t u = R(pp);
+            if (C(u) == RBTREE_RED)
+            {
+                C(p) = RBTREE_BLACK;
+                C(u) = RBTREE_BLACK;
+                C(pp) = RBTREE_RED;
+                z = pp;
+                continue;
+            }
+            if (z == R(p))
+            {
+                z = p;
+                left_rotate(seg, z);
+            }
+            C(P(z)) = RBTREE_BLACK;
+            C(P(P(z))) = RBTREE_RED;
+            right_rotate(seg, P(P(z)));
+        }
+        else
+        {
+            shm_ref_t u = L(pp);
+            if (C(u) == RBTREE_RED)
+            {
+                C(p) = RBTREE_BLACK;
+                C(u) = RBTREE_BLACK;
+                C(pp) = RBTREE_RED;
+                z = pp;
+                continue;
+            }
+            if (z == L(p))
+            {
+                z = p;
+                right_rotate(seg, z);
+            }
+            C(P(z)) = RBTREE_BLACK;
+            C(P(P(z))) = RBTREE_RED;
+            left_rotate(seg, P(P(z)));
+        }
+    }
+    C(seg->root) = RBTREE_BLACK;
+}
+
+/*
+ * 쓰기 잠금을 잡고 삽입, 칸이 다 찼으면 -1
+ */
+int shmtree_insert(shmtree* st, const key_t key)
+{
+    shm_segment_t* seg = st->seg;
+    pthread_rwlock_wrlock(&seg->lock);
+
+    shm_ref_t z = node_alloc(seg);
+    if (z == SHM_NIL)
+    {
+        pthread_rwlock_unlock(&seg->lock);
+        return -1;
+    }
+
+    shm_ref_t y = SHM_NIL;
+    shm_ref_t x = seg->root;
+    while (x != SHM_NIL)
+    {
+        y = x;
+        x = (key < K(x)) ? L(x) : R(x);
+    }
+
+    K(z) = key;
+    C(z) = RBTREE_RED;
+    P(z) = y;
+    L(z) = SHM_NIL;
+    R(z) = SHM_NIL;
+    if (y == SHM_NIL)
+    {
+        seg->root = z;
+    }
+    else if (key < K(y))
+    {
+        L(y) = z;
+    }
+    else
+    {
+        R(y) = z;
+    }
+
+    insert_fixup(seg, z);
+    seg->size++;
+    pthread_rwlock_unlock(&seg->lock);
+    return 0;
+}
+
+static void erase_fixup(shm_segment_t* seg, shm_ref_t x)
+{
+    while (x != seg->root && C(x) == RBTREE_BLACK)
+    {
+        if (x == L(P(x)))
+        {
+            shm_ref_t s = R(P(x));
+            if (C(s) == RBTREE_RED)
+            {
+                C(s) = RBTREE_BLACK;
+                C(P(x)) = RBTREE_RED;
+                left_rotate(seg, P(x));
+                s = R(P(x));
+            }
+
+            if (C(L(s)) == RBTREE_BLACK && C(R(s)) == RBTREE_BLACK)
+            {
+                C(s) = RBTREE_RED;
+                x = P(x);
+            }
+            else
+            {
+                if (C(R(s)) == RBTREE_BLACK)
+                {
+                    C(L(s)) = RBTREE_BLACK;
+                    C(s) = RBTREE_RED;
+                    right_rotate(seg, s);
+                    s = R(P(x));
+                }
+                C(s) = C(P(x));
+                C(P(x)) = RBTREE_BLACK;
+                C(R(s)) = RBTREE_BLACK;
+                left_rotate(seg, P(x));
+                x = seg->root;
+            }
+        }
+        else
+        {
+            shm_ref_t s = L(P(x));
+            if (C(s) == RBTREE_RED)
+            {
+                C(s) = RBTREE_BLACK;
+                C(P(x)) = RBTREE_RED;
+                right_rotate(seg, P(x));
+                s = L(P(x));
+            }
+
+            if (C(R(s)) == RBTREE_BLACK && C(L(s)) == RBTREE_BLACK)
+            {
+                C(s) = RBTREE_RED;
+                x = P(x);
+            }
+            else
+            {
+                if (C(L(s)) == RBTREE_BLACK)
+                {
+                    C(R(s)) = RBTREE_BLACK;
+                    C(s) = RBTREE_RED;
+                    left_rotate(seg, s);
+                    s = L(P(x));
+                }
+                C(s) = C(P(x));
+                C(P(x)) = RBTREE_BLACK;
+                C(L(s)) = RBTREE_BLACK;
+                right_rotate(seg, P(x));
+                x = seg->root;
+            }
+        }
+    }
+    C(x) = RBTREE_BLACK;
+}
+
+static shm_ref_t find_ref(const shm_segment_t* seg, const key_t key)
+{
+    shm_ref_t x = seg->root;
+    while (x != SHM_NIL && K(x) != key)
+    {
+        x = (key < K(x)) ? L(x) : R(x);
+    }
+    return x;
+}
+
+/*
+ * key 하나를 지움, 없으면 -1
+ * 노드 핸들을 밖에 내주지 않으므로 자식이 둘이면 석세서의 key를 옮겨서 지움
+ */
+int shmtree_erase(shmtree* st, const key_t key)
+{
+    shm_segment_t* seg = st->seg;
+    pthread_rwlock_wrlock(&seg->lock);
+
+    shm_ref_t z = find_ref(seg, key);
+    if (z == SHM_NIL)
+    {
+        pthread_rwlock_unlock(&seg->lock);
+        return -1;
+    }
+
+    shm_ref_t y = z;
+    if (L(z) != SHM_NIL && R(z) != SHM_NIL)
+    {
+        y = R(z);
+        while (L(y) != SHM_NIL)
+        {
+            y = L(y);
+        }
+    }
+
+    shm_ref_t x = (L(y) != SHM_NIL) ? L(y) : R(y);
+    P(x) = P(y);  // x가 nil이어도 erase_fixup이 부모를 따라가야 하므로 기록
+    if (P(y) == SHM_NIL)
+    {
+        seg->root = x;
+    }
+    else if (y == L(P(y)))
+    {
+        L(P(y)) = x;
+    }
+    else
+    {
+        R(P(y)) = x;
+    }
+
+    if (y != z)
+    {
+        K(z) = K(y);
+    }
+    if (C(y) == RBTREE_BLACK)
+    {
+        erase_fixup(seg, x);
+    }
+
+    node_free(seg, y);
+    seg->size--;
+    pthread_rwlock_unlock(&seg->lock);
+    return 0;
+}
+
+/*
+ * 중위순서 key로 완전 균형 트리 구성 (rbtree_purge와 같은 색칠)
+ * 칸을 순서대로 할당하므로 노드가 key 순서로 연속 배치됨
+ */
+static shm_ref_t load_inorder(shm_segment_t* seg, const key_t** keys, size_t n, int depth, int red_depth)
+{
+    if (n == 0) return SHM_NIL;
+
+    size_t left_n = (n - 1) / 2;
+    shm_ref_t left = load_inorder(seg, keys, left_n, depth + 1, red_depth);
+    shm_ref_t x = seg->used++;
+    K(x) = *(*keys)++;
+    shm_ref_t right = load_inorder(seg, keys, n - 1 - left_n, depth + 1, red_depth);
+
+    L(x) = left;
+    R(x) = right;
+    if (left != SHM_NIL) P(left) = x;
+    if (right != SHM_NIL) P(right) = x;
+    C(x) = (depth == red_depth) ? RBTREE_RED : RBTREE_BLACK;
+    return x;
+}
+
+/*
+ * 빈 트리에 정렬된 key n개를 O(n)에 적재 (시작 시 대량 적재용)
+ * 비어 있지 않거나 칸이 모자라면 -1
+ */
+int shmtree_load(shmtree* st, const key_t* sorted, size_t n)
+{
+    shm_segment_t* seg = st->seg;
+    pthread_rwlock_wrlock(&seg->lock);
+
+    if (seg->size != 0 || n > (size_t)(seg->capacity - seg->used))
+    {
+        pthread_rwlock_unlock(&seg->lock);
+        return -1;
+    }
+
+    int red_depth = 0;
+    while (((size_t)2 << red_depth) <= n)
+    {
+        red_depth++;
+    }
+
+    seg->root = load_inorder(seg, &sorted, n, 0, red_depth);
+    P(seg->root) = SHM_NIL;
+    C(seg->root) = RBTREE_BLACK;
+    C(SHM_NIL) = RBTREE_BLACK;
+    seg->size = n;
+    pthread_rwlock_unlock(&seg->lock);
+    return 0;
+}
+
+/*
+ * 있으면 1, 없으면 0 (읽기 잠금이라 여러 프로세스가 동시에 검색 가능)
+ */
+int shmtree_find(const shmtree* st, const key_t key)
+{
+    shm_segment_t* seg = st->seg;
+    pthread_rwlock_rdlock(&seg->lock);
+    int found = find_ref(seg, key) != SHM_NIL;
+    pthread_rwlock_unlock(&seg->lock);
+    return found;
+}
+
+static void to_array_inorder(const shm_segment_t* seg, shm_ref_t x, key_t* arr, size_t* i, size_t n)
+{
+    if (x == SHM_NIL) return;
+
+    to_array_inorder(seg, L(x), arr, i, n);
+    if (*i < n)
+    {
+        arr[(*i)++] = K(x);
+    }
+    to_array_inorder(seg, R(x), arr, i, n);
+}
+
+int shmtree_to_array(const shmtree* st, key_t* arr, const size_t n)
+{
+    shm_segment_t* seg = st->seg;
+    size_t i = 0;
+
+    pthread_rwlock_rdlock(&seg->lock);
+    to_array_inorder(seg, seg->root, arr, &i, n);
+    pthread_rwlock_unlock(&seg->lock);
+    return (int)i;
+}
+
+size_t shmtree_size(const shmtree* st)
+{
+    return (size_t)__atomic_load_n(&st->seg->size, __ATOMIC_RELAXED);
+}
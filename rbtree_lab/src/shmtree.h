@@ -0,0 +1,60 @@
+#ifndef _SHMTREE_H_
+#define _SHMTREE_H_
+
+#include "rbtree.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// POSIX 공유 메모리 세그먼트 안에 통째로 들어가는 red-black tree
+// 프로세스마다 매핑 주소가 다르므로 링크는 포인터 대신 nodes[] 인덱스 (0 = nil)
+typedef uint32_t shm_ref_t;
+
+typedef struct {
+  shm_ref_t parent, left, right;
+  uint32_t color;  // color_t
+  key_t key;
+} shm_node_t;
+
+typedef struct {
+  uint64_t magic;
+  uint64_t bytes;
+  pthread_rwlock_t lock;  // 프로세스 간 공유 (쓰기 1명, 읽기 여러 명)
+  shm_ref_t root;
+  shm_ref_t free_list;    // 삭제된 칸, right로 연결
+  uint32_t capacity;      // nodes[] 칸 수 (0번은 nil)
+  uint32_t used;          // 한 번이라도 할당된 칸 수
+  uint64_t size;
+  shm_node_t nodes[];
+} shm_segment_t;
+
+typedef struct {
+  shm_segment_t *seg;
+  size_t bytes;
+} shmtree;
+
+// capacity개까지 넣을 수 있는 세그먼트 생성 (이미 있으면 실패)
+shmtree *shmtree_create(const char *name, size_t capacity);
+// 다른 프로세스가 만든 세그먼트에 붙음
+shmtree *shmtree_open(const char *name);
+// 매핑만 해제 (세그먼트는 shmtree_unlink 전까지 남음)
+void shmtree_close(shmtree *);
+int shmtree_unlink(const char *name);
+
+int shmtree_insert(shmtree *, const key_t);
+int shmtree_erase(shmtree *, const key_t);
+int shmtree_load(shmtree *, const key_t *sorted, size_t n);
+
+int shmtree_find(const shmtree *, const key_t);
+int shmtree_to_array(const shmtree *, key_t *, const size_t);
+size_t shmtree_size(const shmtree *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _SHMTREE_H_
@@ -0,0 +1,268 @@
+#include "rbtree.h"
+#include <stdlib.h>
+
+
+/*
+ * rbtree.h 핵심 API를 skip list로 구현한 비교용 backend (librbtree-skiplist.a)
+ * 노드 = node_t + 층마다의 다음 노드, 층 수는 확률 1/4로 하나씩 늘어남
+ * 트리 필드와 맞추기 위해 0층 연결을 node_t에도 둠:
+ *   root = 첫 노드, right = 다음 노드, parent = 이전 노드, left = 항상 nil
+ * 그래서 중위순회/이웃 이동은 트리 구현과 같은 모양으로 동작
+ */
+
+#define SKIP_MAX_LEVEL 32
+
+typedef struct {
+    node_t node;
+    int level;
+    node_t* next[];  // next[0] == node.right
+} skip_node_t;
+
+// 모든 층의 시작 (tree->aux)
+typedef struct {
+    int level;
+    node_t* next[SKIP_MAX_LEVEL];
+} skip_head_t;
+
+#define NEXT(x, i) (((skip_node_t*)(x))->next[i])
+
+rbtree* new_rbtree(void)
+{
+    rbtree* tree = (rbtree*)calloc(1, sizeof(rbtree));
+    node_t* nil = (node_t*)calloc(1, sizeof(skip_node_t));
+    skip_head_t* head = (skip_head_t*)calloc(1, sizeof(skip_head_t));
+    if (!tree || !nil || !head)
+    {
+        free(tree);
+        free(nil);
+        free(head);
+        return NULL;
+    }
+
+    nil->color = RBTREE_BLACK;
+    nil->left = nil;
+    nil->right = nil;
+    nil->parent = nil;
+    for (int i = 0; i < SKIP_MAX_LEVEL; ++i)
+    {
+        head->next[i] = nil;
+    }
+    head->level = 1;
+
+    tree->nil = nil;
+    tree->root = nil;
+    tree->spare = nil;
+    tree->node_size = sizeof(skip_node_t);
+    tree->aux = head;
+    return tree;
+}
+
+void delete_rbtree(rbtree* tree)
+{
+    if (!tree) return;
+
+    node_t* x = tree->root;
+    while (x != tree->nil)
+    {
+        node_t* next = x->right;
+        free(x);
+        x = next;
+    }
+    free((void*)tree->aux);
+    free(tree->nil);
+    free(tree);
+}
+
+// 호출자의 key 생성기(xorshift 등)와 맞물리지 않도록 카운터를 섞는 splitmix 방식
+static unsigned long long skip_rng;
+
+static int random_level(void)
+{
+    unsigned long long z = (skip_rng += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+
+    // 하위 2비트씩 보고 둘 다 0이면 한 층 더 (확률 1/4)
+    unsigned long long bits = z;
+    int level = 1;
+    while (level < SKIP_MAX_LEVEL && (bits & 3) == 0)
+    {
+        level++;
+        bits >>= 2;
+    }
+    return level;
+}
+
+// 층 i에서 x 다음 (x가 NULL이면 head 다음)
+static inline node_t* next_at(const skip_head_t* head, node_t* x, int i)
+{
+    return x ? NEXT(x, i) : head->next[i];
+}
+
+static inline void set_next(skip_head_t* head, node_t* x, int i, node_t* node)
+{
+    if (x)
+    {
+        NEXT(x, i) = node;
+    }
+    else
+    {
+        head->next[i] = node;
+    }
+}
+
+/*
+ * 같은 key는 기존 것들 뒤에 (트리 구현처럼 오른쪽으로)
+ */
+node_t* rbtree_insert(rbtree* tree, const key_t key)
+{
+    skip_head_t* head = (skip_head_t*)tree->aux;
+    int level = random_level();
+    skip_node_t* node = (skip_node_t*)calloc(1, sizeof(skip_node_t) + level * sizeof(node_t*));
+    if (!node) return NULL;
+
+    if (level > head->level)
+    {
+        head->level = level;
+    }
+
+    node_t* update[SKIP_MAX_LEVEL];
+    node_t* x = NULL;  // NULL = head
+    for (int i = head->level - 1; i >= 0; --i)
+    {
+        for (node_t* n = next_at(head, x, i); n != tree->nil && n->key <= key; n = next_at(head, x, i))
+        {
+            x = n;
+        }
+        update[i] = x;
+    }
+
+    node->node.key = key;
+    node->node.left = tree->nil;
+    node->level = level;
+    for (int i = 0; i < level; ++i)
+    {
+        node->next[i] = next_at(head, update[i], i);
+        set_next(head, update[i], i, &node->node);
+    }
+
+    node_t* prev = update[0] ? update[0] : tree->nil;
+    node->node.right = node->next[0];
+    node->node.parent = prev;
+    if (node->next[0] != tree->nil)
+    {
+        node->next[0]->parent = &node->node;
+    }
+    if (prev == tree->nil)
+    {
+        tree->root = &node->node;
+    }
+    else
+    {
+        prev->right = &node->node;
+    }
+
+    tree->size++;
+    return &node->node;
+}
+
+node_t* rbtree_find(const rbtree* tree, const key_t key)
+{
+    const skip_head_t* head = (const skip_head_t*)tree->aux;
+    node_t* x = NULL;
+    for (int i = head->level - 1; i >= 0; --i)
+    {
+        for (node_t* n = next_at(head, x, i); n != tree->nil && n->key < key; n = next_at(head, x, i))
+        {
+            x = n;
+        }
+    }
+
+    node_t* n = next_at(head, x, 0);
+    return (n != tree->nil && n->key == key) ? n : NULL;
+}
+
+node_t* rbtree_min(const rbtree* tree)
+{
+    return tree->root;
+}
+
+node_t* rbtree_max(const rbtree* tree)
+{
+    const skip_head_t* head = (const skip_head_t*)tree->aux;
+    node_t* x = tree->nil;
+    for (int i = head->level - 1; i >= 0; --i)
+    {
+        for (node_t* n = next_at(head, x == tree->nil ? NULL : x, i); n != tree->nil; n = NEXT(n, i))
+        {
+            x = n;
+        }
+    }
+    return x;
+}
+
+/*
+ * 같은 key가 여러 개일 수 있으므로 key로 내려가되, node가 있는 층에서는 node를 만날 때까지 진행
+ */
+int rbtree_erase(rbtree* tree, node_t* node)
+{
+    if (!tree || node == tree->nil) return 0;
+
+    skip_head_t* head = (skip_head_t*)tree->aux;
+    int level = ((skip_node_t*)node)->level;
+    node_t* x = NULL;
+    for (int i = head->level - 1; i >= 0; --i)
+    {
+        for (node_t* n = next_at(head, x, i); n != tree->nil && n != node && (n->key < node->key || i < level);
+             n = next_at(head, x, i))
+        {
+            x = n;
+        }
+        if (i < level)
+        {
+            set_next(head, x, i, NEXT(node, i));
+        }
+    }
+    while (head->level > 1 && head->next[head->level - 1] == tree->nil)
+    {
+        head->level--;
+    }
+
+    if (node->parent == tree->nil)
+    {
+        tree->root = node->right;
+    }
+    else
+    {
+        node->parent->right = node->right;
+    }
+    if (node->right != tree->nil)
+    {
+        node->right->parent = node->parent;
+    }
+
+    tree->size--;
+    free(node);
+    return 0;
+}
+
+node_t* rbtree_next(const rbtree* tree, const node_t* node)
+{
+    return node->right;
+}
+
+node_t* rbtree_prev(const rbtree* tree, const node_t* node)
+{
+    return node == tree->nil ? rbtree_max(tree) : node->parent;
+}
+
+int rbtree_to_array(const rbtree* tree, key_t* arr, const size_t n)
+{
+    size_t i = 0;
+    for (node_t* x = tree->root; x != tree->nil && i < n; x = x->right)
+    {
+        arr[i++] = x->key;
+    }
+    return (int)i;
+}
@@ -0,0 +1,304 @@
+#include "strtree.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+#define STRTREE_CHUNK_BYTES (64 * 1024)
+
+struct strtree_chunk {
+    struct strtree_chunk* next;
+    size_t used;
+    size_t cap;
+    unsigned char data[];
+};
+
+// 탐색 중에 계속 쓰는 key 정보 (앞부분은 미리 정수로 바꿔 둠)
+typedef struct {
+    unsigned long long head[2];
+    const unsigned char* bytes;
+    size_t len;
+} probe_t;
+
+/*
+ * 8바이트를 big-endian 정수로 읽기: 정수 대소가 곧 바이트 사전순
+ */
+static inline unsigned long long load_be64(const unsigned char* p)
+{
+    unsigned long long v;
+    memcpy(&v, p, sizeof(v));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+static void make_probe(probe_t* probe, const void* key, size_t len)
+{
+    unsigned char prefix[STRTREE_INLINE] = { 0 };
+    memcpy(prefix, key, len < STRTREE_INLINE ? len : STRTREE_INLINE);
+
+    probe->head[0] = load_be64(prefix);
+    probe->head[1] = load_be64(prefix + 8);
+    probe->bytes = (const unsigned char*)key;
+    probe->len = len;
+}
+
+/*
+ * memcmp + 길이 순서
+ * 앞 16바이트에서 갈리면 노드 밖 메모리를 읽지 않음 (0 채움 때문에 같아 보여도 길이로 마무리됨)
+ */
+static int compare(const probe_t* probe, const strnode_t* node)
+{
+    unsigned long long h = load_be64(node->prefix);
+    if (probe->head[0] != h) return probe->head[0] < h ? -1 : 1;
+
+    h = load_be64(node->prefix + 8);
+    if (probe->head[1] != h) return probe->head[1] < h ? -1 : 1;
+
+    if (probe->len > STRTREE_INLINE && node->len > STRTREE_INLINE)
+    {
+        size_t m = (probe->len < node->len ? probe->len : node->len) - STRTREE_INLINE;
+        int c = memcmp(probe->bytes + STRTREE_INLINE, node->bytes + STRTREE_INLINE, m);
+        if (c) return c;
+    }
+    return (probe->len > node->len) - (probe->len < node->len);
+}
+
+strtree* new_strtree(void)
+{
+    strtree* st = (strtree*)calloc(1, sizeof(strtree));
+    if (!st) return NULL;
+
+    st->tree = new_rbtree_augmented(sizeof(strnode_t), NULL);
+    if (!st->tree)
+    {
+        free(st);
+        return NULL;
+    }
+    return st;
+}
+
+void delete_strtree(strtree* st)
+{
+    if (!st) return;
+
+    while (st->chunks)
+    {
+        struct strtree_chunk* next = st->chunks->next;
+        free(st->chunks);
+        st->chunks = next;
+    }
+    delete_rbtree(st->tree);
+    free(st);
+}
+
+/*
+ * key 길이(> STRTREE_INLINE)의 크기 class, 자리 크기는 2^k와 1.5 * 2^k 중 len 이상인 가장 작은 값
+ * 24, 32, 48, 64, 96, ... 65536까지 class 24개 (낭비는 1/3 이하)
+ */
+static size_t key_class(size_t len, size_t* bytes)
+{
+    // 2^k < len <= 2^(k+1), len > 16이라 k >= 4
+    size_t k = 63 - __builtin_clzll(len - 1);
+    size_t mid = ((size_t)1 << k) + ((size_t)1 << (k - 1));
+
+    if (len <= mid)
+    {
+        *bytes = mid;
+        return 2 * (k - 4);
+    }
+    *bytes = (size_t)1 << (k + 1);
+    return 2 * (k - 4) + 1;
+}
+
+/*
+ * arena에서 len 바이트 할당 (bump), 큰 key는 전용 chunk
+ */
+static unsigned char* arena_alloc(strtree* st, size_t len)
+{
+    if (len <= STRTREE_CHUNK_BYTES)
+    {
+        size_t c = key_class(len, &len);
+        unsigned char* p = st->free_keys[c];
+        if (p)
+        {
+            // 빈 자리 앞에 다음 빈 자리 포인터가 있음
+            memcpy(&st->free_keys[c], p, sizeof(p));
+            return p;
+        }
+    }
+
+    struct strtree_chunk* chunk = st->chunks;
+
+    if (!chunk || chunk->cap - chunk->used < len)
+    {
+        size_t cap = len > STRTREE_CHUNK_BYTES ? len : STRTREE_CHUNK_BYTES;
+        chunk = (struct strtree_chunk*)malloc(sizeof(struct strtree_chunk) + cap);
+        if (!chunk) return NULL;
+
+        chunk->used = 0;
+        chunk->cap = cap;
+        // 큰 전용 chunk는 현재 chunk 뒤에 끼워서 남은 공간을 계속 씀
+        if (st->chunks && len > STRTREE_CHUNK_BYTES)
+        {
+            chunk->next = st->chunks->next;
+            st->chunks->next = chunk;
+        }
+        else
+        {
+            chunk->next = st->chunks;
+            st->chunks = chunk;
+        }
+    }
+
+    unsigned char* p = chunk->data + chunk->used;
+    chunk->used += len;
+    return p;
+}
+
+/*
+ * arena_alloc으로 받은 자리 반납
+ * class 목록에 넣고, 전용 chunk는 목록에서 빼서 해제 (chunk 수만큼 걸리지만 긴 key 복사보다 작음)
+ */
+static void arena_free(strtree* st, unsigned char* p, size_t len)
+{
+    if (len <= STRTREE_CHUNK_BYTES)
+    {
+        size_t c = key_class(len, &len);
+        memcpy(p, &st->free_keys[c], sizeof(p));
+        st->free_keys[c] = p;
+        return;
+    }
+
+    struct strtree_chunk** link = &st->chunks;
+    while ((*link)->data != p)
+    {
+        link = &(*link)->next;
+    }
+
+    struct strtree_chunk* chunk = *link;
+    *link = chunk->next;
+    free(chunk);
+}
+
+/*
+ * key 복사본을 만들어 삽입 (같은 key도 하나 더 추가)
+ * 16바이트 이하는 노드 안에만 저장
+ */
+strnode_t* strtree_insert(strtree* st, const void* key, size_t len)
+{
+    probe_t probe;
+    make_probe(&probe, key, len);
+
+    // arena를 먼저 잡아서 노드 할당 뒤 실패할 일이 없게 함 (노드 할당이 실패하면 자리를 돌려줌)
+    unsigned char* bytes = NULL;
+    if (len > STRTREE_INLINE)
+    {
+        unsigned char* copy = arena_alloc(st, len);
+        if (!copy) return NULL;
+
+        memcpy(copy, key, len);
+        bytes = copy;
+        probe.bytes = copy;
+    }
+
+    strnode_t* node = (strnode_t*)rbtree_alloc_node(st->tree, 0);
+    if (!node)
+    {
+        if (bytes) arena_free(st, bytes, len);
+        return NULL;
+    }
+
+    memcpy(node->prefix, key, len < STRTREE_INLINE ? len : STRTREE_INLINE);
+    node->len = len;
+    node->bytes = bytes;
+
+    node_t* nil = st->tree->nil;
+    node_t* y = nil;
+    node_t* x = st->tree->root;
+    int c = 0;
+
+    while (x != nil)
+    {
+        y = x;
+        c = compare(&probe, (strnode_t*)x);
+        x = (c < 0) ? x->left : x->right;
+    }
+
+    rbtree_link_node(st->tree, y, c < 0, &node->node);
+    return node;
+}
+
+strnode_t* strtree_find(const strtree* st, const void* key, size_t len)
+{
+    probe_t probe;
+    make_probe(&probe, key, len);
+
+    node_t* nil = st->tree->nil;
+    node_t* x = st->tree->root;
+
+    while (x != nil)
+    {
+        int c = compare(&probe, (strnode_t*)x);
+        if (c == 0) return (strnode_t*)x;
+
+        x = (c < 0) ? x->left : x->right;
+    }
+    return NULL;
+}
+
+/*
+ * key 이상인 첫 노드, 없으면 NULL
+ */
+strnode_t* strtree_lower_bound(const strtree* st, const void* key, size_t len)
+{
+    probe_t probe;
+    make_probe(&probe, key, len);
+
+    node_t* nil = st->tree->nil;
+    node_t* x = st->tree->root;
+    node_t* res = NULL;
+
+    while (x != nil)
+    {
+        if (compare(&probe, (strnode_t*)x) <= 0)
+        {
+            res = x;
+            x = x->left;
+        }
+        else
+        {
+            x = x->right;
+        }
+    }
+    return (strnode_t*)res;
+}
+
+/*
+ * 긴 key의 arena 자리는 다음 삽입이 재사용하도록 돌려줌
+ */
+int strtree_erase(strtree* st, strnode_t* node)
+{
+    if (node->len > STRTREE_INLINE)
+    {
+        arena_free(st, (unsigned char*)node->bytes, node->len);
+    }
+    return rbtree_erase(st->tree, &node->node);
+}
+
+strnode_t* strtree_min(const strtree* st)
+{
+    node_t* node = rbtree_min(st->tree);
+    return node == st->tree->nil ? NULL : (strnode_t*)node;
+}
+
+strnode_t* strtree_next(const strtree* st, const strnode_t* node)
+{
+    node_t* next = rbtree_next(st->tree, &node->node);
+    return next == st->tree->nil ? NULL : (strnode_t*)next;
+}
+
+const unsigned char* strtree_key(const strnode_t* node)
+{
+    return node->len > STRTREE_INLINE ? node->bytes : node->prefix;
+}
@@ -0,0 +1,41 @@
+#ifndef _STRTREE_H_
+#define _STRTREE_H_
+
+#include "rbtree.h"
+
+#define STRTREE_INLINE 16
+#define STRTREE_KEY_CLASSES 24
+
+// 가변 길이 byte string key 노드 (64바이트 = 캐시 라인 하나)
+// 앞 STRTREE_INLINE 바이트는 노드 안에 있어서 대부분의 비교가 다른 메모리를 안 건드리고 끝남
+typedef struct {
+  node_t node;                            // node.key는 쓰지 않음
+  unsigned char prefix[STRTREE_INLINE];   // key 앞부분, 짧으면 0으로 채움
+  size_t len;
+  const unsigned char *bytes;             // len > STRTREE_INLINE일 때 arena에 있는 전체 key
+} strnode_t;
+
+struct strtree_chunk;
+
+typedef struct {
+  rbtree *tree;
+  struct strtree_chunk *chunks;  // key 문자열 arena (트리를 지울 때 한 번에 해제)
+  // 지운 key 자리, 크기 class별 목록 (arena 자리는 class 크기로 올려 잡아서 같은 class면 그대로 재사용)
+  // chunk 크기보다 긴 key는 전용 chunk라 지울 때 바로 해제
+  unsigned char *free_keys[STRTREE_KEY_CLASSES];
+} strtree;
+
+strtree *new_strtree(void);
+void delete_strtree(strtree *);
+
+strnode_t *strtree_insert(strtree *, const void *key, size_t len);
+strnode_t *strtree_find(const strtree *, const void *key, size_t len);
+strnode_t *strtree_lower_bound(const strtree *, const void *key, size_t len);
+int strtree_erase(strtree *, strnode_t *);
+
+strnode_t *strtree_min(const strtree *);
+strnode_t *strtree_next(const strtree *, const strnode_t *);
+
+const unsigned char *strtree_key(const strnode_t *);
+
+#endif  // _STRTREE_H_
@@ -0,0 +1,194 @@
+#include "trace.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+
+#define TRACE_MAGIC 0x52425452u  // "RBTR"
+#define TRACE_VERSION 1
+#define TRACE_BUFFER (1 << 20)
+#define TRACE_HIT 0x80
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+} trace_header_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static unsigned char* put_varint(unsigned char* p, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+// 끝을 넘으면 NULL
+static const unsigned char* get_varint(const unsigned char* p, const unsigned char* end, uint64_t* v)
+{
+    uint64_t x = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7)
+    {
+        unsigned char b = *p++;
+        x |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+        {
+            *v = x;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// 음수 key도 짧게: 0, -1, 1, -2, ... -> 0, 1, 2, 3, ...
+static inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static inline int has_key(int op) { return op == TRACE_INSERT || op == TRACE_FIND || op == TRACE_ERASE; }
+
+int rbtree_trace_start(rbtree* tree, const char* path)
+{
+    if (!tree || tree->trace) return -1;
+
+    rbtree_trace* trace = (rbtree_trace*)calloc(1, sizeof(rbtree_trace));
+    if (!trace) return -1;
+
+    trace->fp = fopen(path, "wb");
+    trace_header_t header = {TRACE_MAGIC, TRACE_VERSION};
+    if (!trace->fp || setvbuf(trace->fp, NULL, _IOFBF, TRACE_BUFFER) != 0 ||
+        fwrite(&header, sizeof(header), 1, trace->fp) != 1)
+    {
+        if (trace->fp) fclose(trace->fp);
+        free(trace);
+        return -1;
+    }
+
+    trace->start_ns = now_ns();
+    trace->last_ns = trace->start_ns;
+    tree->trace = trace;
+    return 0;
+}
+
+int rbtree_trace_stop(rbtree* tree)
+{
+    if (!tree || !tree->trace) return -1;
+
+    rbtree_trace* trace = tree->trace;
+    tree->trace = NULL;
+    int err = trace->error;
+    if (fclose(trace->fp) != 0) err = 1;
+    free(trace);
+    return err ? -1 : 0;
+}
+
+/*
+ * 레코드 하나를 stdio 버퍼에 붙임 (대부분 3~7바이트)
+ * 쓰기 오류는 기록해 두고 rbtree_trace_stop에서 알림, 트리 연산은 그대로 진행
+ */
+void trace_record(rbtree_trace* trace, int op, int64_t arg, int hit)
+{
+    unsigned char rec[1 + 10 + 10];
+    uint64_t now = now_ns();
+
+    unsigned char* p = rec;
+    *p++ = (unsigned char)(op | (hit ? TRACE_HIT : 0));
+    p = put_varint(p, now - trace->last_ns);
+    if (has_key(op))
+    {
+        p = put_varint(p, zigzag(arg));
+    }
+    else if (op == TRACE_TO_ARRAY)
+    {
+        p = put_varint(p, (uint64_t)arg);
+    }
+
+    trace->last_ns = now;
+    trace->count++;
+    if (fwrite(rec, 1, (size_t)(p - rec), trace->fp) != (size_t)(p - rec))
+    {
+        trace->error = 1;
+    }
+}
+
+int trace_load(const char* path, trace_op_t** out, size_t* n)
+{
+    FILE* fp = fopen(path, "rb");
+    if (!fp) return -1;
+
+    unsigned char* data = NULL;
+    size_t len = 0, cap = 0;
+    for (;;)
+    {
+        if (len == cap)
+        {
+            cap = cap ? cap * 2 : TRACE_BUFFER;
+            unsigned char* grown = (unsigned char*)realloc(data, cap);
+            if (!grown)
+            {
+                free(data);
+                fclose(fp);
+                return -1;
+            }
+            data = grown;
+        }
+        size_t got = fread(data + len, 1, cap - len, fp);
+        if (got == 0) break;
+        len += got;
+    }
+    fclose(fp);
+
+    trace_header_t header;
+    if (len < sizeof(header) || (memcpy(&header, data, sizeof(header)), header.magic != TRACE_MAGIC) ||
+        header.version != TRACE_VERSION)
+    {
+        free(data);
+        return -1;
+    }
+
+    // 레코드는 최소 2바이트
+    size_t max_ops = (len - sizeof(header)) / 2 + 1;
+    trace_op_t* ops = (trace_op_t*)malloc(max_ops * sizeof(trace_op_t));
+    if (!ops)
+    {
+        free(data);
+        return -1;
+    }
+
+    const unsigned char* p = data + sizeof(header);
+    const unsigned char* end = data + len;
+    size_t count = 0;
+    uint64_t t = 0;
+    while (p < end)
+    {
+        trace_op_t op = {*p & ~TRACE_HIT, (*p & TRACE_HIT) != 0, 0, 0};
+        if (op.op < TRACE_INSERT || op.op > TRACE_TO_ARRAY) break;
+
+        uint64_t delta, arg = 0;
+        const unsigned char* q = get_varint(p + 1, end, &delta);
+        if (q && (has_key(op.op) || op.op == TRACE_TO_ARRAY))
+        {
+            q = get_varint(q, end, &arg);
+        }
+        if (!q) break;  // 잘린 꼬리
+
+        t += delta;
+        op.ns = t;
+        op.arg = has_key(op.op) ? unzigzag(arg) : (int64_t)arg;
+        ops[count++] = op;
+        p = q;
+    }
+
+    free(data);
+    *out = ops;
+    *n = count;
+    return 0;
+}
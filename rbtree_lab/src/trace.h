@@ -0,0 +1,51 @@
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include "rbtree.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// 애플리케이션이 트리에 하는 호출(insert, find, erase, min, max, to_array)을 시각과 함께 파일에 기록
+// rbtree_trace_start로 켜면 해당 API 호출마다 기록, 설정 함수나 내부 호출은 기록하지 않음
+// 파일 = 헤더 + 레코드 [op|결과 1바이트][이전 레코드와의 시간 차 ns varint][key(zigzag)/n varint]
+// 기록한 트레이스는 src/replay로 어떤 라이브러리 빌드에든 다시 돌려볼 수 있음
+
+enum {
+  TRACE_INSERT = 1,
+  TRACE_FIND,
+  TRACE_ERASE,
+  TRACE_MIN,
+  TRACE_MAX,
+  TRACE_TO_ARRAY,
+};
+
+typedef struct rbtree_trace {
+  FILE *fp;
+  uint64_t start_ns;
+  uint64_t last_ns;
+  uint64_t count;
+  int error;
+} rbtree_trace;
+
+// 읽은 레코드 하나
+typedef struct {
+  int op;
+  int hit;       // find/min/max가 노드를 찾았는지, insert가 성공했는지
+  int64_t arg;   // key (to_array면 n)
+  uint64_t ns;   // 기록 시작부터의 시각
+} trace_op_t;
+
+// path에 기록 시작, 이미 켜져 있으면 -1
+int rbtree_trace_start(rbtree *, const char *path);
+// 남은 기록을 쓰고 닫음, 쓰는 중에 오류가 있었으면 -1
+int rbtree_trace_stop(rbtree *);
+
+// rbtree.c 내부용
+void trace_record(rbtree_trace *, int op, int64_t arg, int hit);
+
+// path의 레코드를 전부 읽음 (*out은 free로 해제), 형식이 틀리면 -1
+// 마지막 레코드가 잘려 있으면 거기까지만
+int trace_load(const char *path, trace_op_t **out, size_t *n);
+
+#endif  // _TRACE_H_
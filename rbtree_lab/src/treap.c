@@ -0,0 +1,93 @@
+#include "bst.h"
+
+
+/*
+ * rbtree.h 핵심 API를 treap으로 구현한 비교용 backend (librbtree-treap.a)
+ * key는 BST 순서, 노드마다 무작위 우선순위는 max-heap 순서 -> 기대 높이 O(log n)
+ * 삽입은 잎에 붙인 뒤 우선순위가 부모보다 크면 올라가고, 삭제는 자식 쪽으로 돌려 내린 뒤 떼어냄
+ */
+
+typedef struct {
+    node_t node;
+    unsigned int priority;
+} treap_node_t;
+
+#define PRIORITY(x) (((treap_node_t*)(x))->priority)
+
+BST_DEFINE_COMMON_API
+
+rbtree* new_rbtree(void)
+{
+    rbtree* tree = bst_new(sizeof(treap_node_t));
+    if (tree)
+    {
+        PRIORITY(tree->nil) = 0;  // 누구보다도 작음
+    }
+    return tree;
+}
+
+// 트리마다 상태를 둘 필요는 없어서 하나를 공유
+// 호출자가 key를 만들 때 흔히 쓰는 xorshift와 같은 수열이면 priority가 key와 맞물려 한쪽으로 쏠리므로
+// 카운터를 섞는 splitmix 방식을 씀
+static unsigned long long treap_rng;
+
+static unsigned int next_priority(void)
+{
+    unsigned long long z = (treap_rng += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (unsigned int)(z ^ (z >> 31)) | 1;  // nil(0)보다 항상 큼
+}
+
+node_t* rbtree_insert(rbtree* tree, const key_t key)
+{
+    treap_node_t* node = (treap_node_t*)calloc(1, sizeof(treap_node_t));
+    if (!node) return NULL;
+
+    node->node.key = key;
+    node->priority = next_priority();
+    bst_link_leaf(tree, &node->node);
+
+    node_t* x = &node->node;
+    while (x->parent != tree->nil && PRIORITY(x) > PRIORITY(x->parent))
+    {
+        if (x == x->parent->left)
+        {
+            bst_right_rotate(tree, x->parent, NULL);
+        }
+        else
+        {
+            bst_left_rotate(tree, x->parent, NULL);
+        }
+    }
+    return x;
+}
+
+int rbtree_erase(rbtree* tree, node_t* node)
+{
+    if (!tree || node == tree->nil) return 0;
+
+    // 우선순위가 큰 자식을 위로 올리면서 node를 자식이 하나 이하인 자리까지 내림
+    while (node->left != tree->nil && node->right != tree->nil)
+    {
+        if (PRIORITY(node->left) > PRIORITY(node->right))
+        {
+            bst_right_rotate(tree, node, NULL);
+        }
+        else
+        {
+            bst_left_rotate(tree, node, NULL);
+        }
+    }
+
+    node_t* child = (node->left != tree->nil) ? node->left : node->right;
+    if (child != tree->nil)
+    {
+        child->parent = node->parent;
+    }
+    bst_replace_child(tree, node->parent, node, child);
+
+    tree->size--;
+    free(node);
+    return 0;
+}
@@ -0,0 +1,429 @@
+#include "wal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+#define WAL_BATCH_MAGIC 0x57414c42u       // "WALB"
+#define WAL_CHECKPOINT_MAGIC 0x57414c43u  // "WALC"
+#define WAL_BATCH_BYTES (64 * 1024)
+#define WAL_RECORD_BYTES 5                // op 1바이트 + key 4바이트 (little-endian)
+#define WAL_CHECKPOINT_MIN (1024 * 1024)
+#define WAL_IO_KEYS 16384
+
+enum { WAL_OP_INSERT = 1, WAL_OP_ERASE = 2 };
+
+// batch 헤더 (뒤에 count개의 레코드)
+typedef struct {
+  uint32_t magic;
+  uint32_t count;
+  uint64_t generation;
+  uint32_t crc;  // 레코드 부분
+  uint32_t pad;
+} wal_batch_header_t;
+
+// checkpoint 헤더 (뒤에 count개의 key_t, 오름차순)
+typedef struct {
+  uint32_t magic;
+  uint32_t crc;  // key 부분
+  uint64_t generation;
+  uint64_t count;
+} wal_checkpoint_header_t;
+
+/*
+ * CRC-32 (IEEE), 처음 쓸 때 표를 만듦
+ */
+static uint32_t crc_table[256];
+
+static uint32_t crc32_update(uint32_t crc, const void* data, size_t len)
+{
+    if (!crc_table[1])
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            crc_table[i] = c;
+        }
+    }
+
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc = crc_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static char* join_path(const char* dir, const char* name)
+{
+    size_t len = strlen(dir) + strlen(name) + 2;
+    char* path = (char*)malloc(len);
+    if (path)
+    {
+        snprintf(path, len, "%s/%s", dir, name);
+    }
+    return path;
+}
+
+static int write_all(int fd, const void* data, size_t len)
+{
+    const char* p = (const char*)data;
+    while (len > 0)
+    {
+        ssize_t w = write(fd, p, len);
+        if (w < 0)
+        {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+// 끝까지 읽었으면 읽은 바이트 수, 오류면 -1
+static ssize_t read_all(int fd, void* data, size_t len)
+{
+    char* p = (char*)data;
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t r = read(fd, p + done, len - done);
+        if (r < 0)
+        {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (r == 0) break;
+        done += (size_t)r;
+    }
+    return (ssize_t)done;
+}
+
+/*
+ * checkpoint key를 조금씩 읽어서 rbtree_build에 넘기는 source
+ */
+typedef struct {
+    int fd;
+    key_t buf[WAL_IO_KEYS];
+    size_t pos;
+    size_t len;
+    uint64_t left;
+    uint32_t crc;
+} checkpoint_reader_t;
+
+static int checkpoint_next(void* ctx, key_t* key)
+{
+    checkpoint_reader_t* r = (checkpoint_reader_t*)ctx;
+    if (r->pos == r->len)
+    {
+        size_t want = r->left < WAL_IO_KEYS ? (size_t)r->left : WAL_IO_KEYS;
+        if (want == 0 || read_all(r->fd, r->buf, want * sizeof(key_t)) != (ssize_t)(want * sizeof(key_t))) return -1;
+
+        r->crc = crc32_update(r->crc, r->buf, want * sizeof(key_t));
+        r->left -= want;
+        r->pos = 0;
+        r->len = want;
+    }
+    *key = r->buf[r->pos++];
+    return 0;
+}
+
+/*
+ * checkpoint가 없으면 0 (세대 0, 빈 트리), 있으면 트리를 채우고 세대를 돌려줌, 깨졌으면 -1
+ */
+static int load_checkpoint(rbtree_wal* wal)
+{
+    char* path = join_path(wal->dir, "checkpoint");
+    if (!path) return -1;
+
+    int fd = open(path, O_RDONLY);
+    free(path);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+
+    wal_checkpoint_header_t header;
+    checkpoint_reader_t* reader = (checkpoint_reader_t*)calloc(1, sizeof(checkpoint_reader_t));
+    int err = !reader || read_all(fd, &header, sizeof(header)) != (ssize_t)sizeof(header) ||
+              header.magic != WAL_CHECKPOINT_MAGIC;
+    if (!err)
+    {
+        reader->fd = fd;
+        reader->left = header.count;
+        err = rbtree_build(wal->tree, (size_t)header.count, checkpoint_next, reader) != 0 ||
+              reader->crc != header.crc;
+        if (err)
+        {
+            rbtree_clear(wal->tree);
+        }
+    }
+    if (!err)
+    {
+        wal->generation = header.generation;
+    }
+
+    free(reader);
+    close(fd);
+    return err ? -1 : 0;
+}
+
+static void apply_record(rbtree* tree, const unsigned char* rec)
+{
+    uint32_t raw = (uint32_t)rec[1] | (uint32_t)rec[2] << 8 | (uint32_t)rec[3] << 16 | (uint32_t)rec[4] << 24;
+    key_t key = (key_t)raw;
+
+    if (rec[0] == WAL_OP_INSERT)
+    {
+        rbtree_insert(tree, key);
+    }
+    else
+    {
+        node_t* node = rbtree_find(tree, key);
+        if (node)
+        {
+            rbtree_erase(tree, node);
+        }
+    }
+}
+
+/*
+ * 로그를 앞에서부터 batch 단위로 검사하며 재생
+ * checkpoint보다 이전 세대의 batch는 이미 checkpoint에 들어 있으므로 건너뜀
+ * 잘렸거나 checksum이 틀린 batch에서 멈추고 그 뒤는 잘라냄 (마지막 batch를 쓰다 죽은 경우)
+ */
+static int replay_log(rbtree_wal* wal)
+{
+    size_t valid = 0;
+    unsigned char* records = (unsigned char*)malloc(WAL_BATCH_BYTES);
+    if (!records) return -1;
+
+    for (;;)
+    {
+        wal_batch_header_t header;
+        if (read_all(wal->log_fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) break;
+        if (header.magic != WAL_BATCH_MAGIC || header.count == 0 ||
+            (size_t)header.count * WAL_RECORD_BYTES > WAL_BATCH_BYTES) break;
+
+        size_t len = (size_t)header.count * WAL_RECORD_BYTES;
+        if (read_all(wal->log_fd, records, len) != (ssize_t)len || crc32_update(0, records, len) != header.crc) break;
+
+        if (header.generation >= wal->generation)
+        {
+            for (size_t i = 0; i < len; i += WAL_RECORD_BYTES)
+            {
+                apply_record(wal->tree, records + i);
+            }
+        }
+        valid += sizeof(header) + len;
+    }
+    free(records);
+
+    if (ftruncate(wal->log_fd, (off_t)valid) != 0 || lseek(wal->log_fd, (off_t)valid, SEEK_SET) < 0) return -1;
+
+    wal->log_bytes = valid;
+    return 0;
+}
+
+rbtree_wal* wal_open(const char* dir)
+{
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return NULL;
+
+    rbtree_wal* wal = (rbtree_wal*)calloc(1, sizeof(rbtree_wal));
+    if (!wal) return NULL;
+
+    wal->log_fd = -1;
+    wal->checkpoint_min = WAL_CHECKPOINT_MIN;
+    wal->dir = strdup(dir);
+    wal->tree = new_rbtree();
+    wal->batch = (unsigned char*)malloc(WAL_BATCH_BYTES);
+    char* log_path = wal->dir ? join_path(dir, "wal.log") : NULL;
+
+    int ok = wal->tree && wal->batch && log_path && load_checkpoint(wal) == 0;
+    if (ok)
+    {
+        wal->log_fd = open(log_path, O_RDWR | O_CREAT, 0644);
+        ok = wal->log_fd >= 0 && replay_log(wal) == 0;
+    }
+    free(log_path);
+
+    if (!ok)
+    {
+        if (wal->log_fd >= 0) close(wal->log_fd);
+        delete_rbtree(wal->tree);
+        free(wal->batch);
+        free(wal->dir);
+        free(wal);
+        return NULL;
+    }
+    return wal;
+}
+
+/*
+ * 모아 둔 batch를 로그 끝에 씀 (fsync는 안 함)
+ */
+static int flush_batch(rbtree_wal* wal)
+{
+    if (wal->batch_count == 0) return 0;
+
+    wal_batch_header_t header = { WAL_BATCH_MAGIC, (uint32_t)wal->batch_count, wal->generation,
+                                  crc32_update(0, wal->batch, wal->batch_len), 0 };
+    if (write_all(wal->log_fd, &header, sizeof(header)) != 0 || write_all(wal->log_fd, wal->batch, wal->batch_len) != 0)
+    {
+        return -1;
+    }
+
+    wal->log_bytes += sizeof(header) + wal->batch_len;
+    wal->batch_len = 0;
+    wal->batch_count = 0;
+    return 0;
+}
+
+static int append_record(rbtree_wal* wal, int op, const key_t key)
+{
+    if (wal->batch_len + WAL_RECORD_BYTES > WAL_BATCH_BYTES && flush_batch(wal) != 0) return -1;
+
+    uint32_t raw = (uint32_t)key;
+    unsigned char* rec = wal->batch + wal->batch_len;
+    rec[0] = (unsigned char)op;
+    rec[1] = (unsigned char)raw;
+    rec[2] = (unsigned char)(raw >> 8);
+    rec[3] = (unsigned char)(raw >> 16);
+    rec[4] = (unsigned char)(raw >> 24);
+    wal->batch_len += WAL_RECORD_BYTES;
+    wal->batch_count++;
+    return 0;
+}
+
+/*
+ * 로그가 checkpoint 하나만큼 커지면 새 checkpoint (쓰는 양이 변경량의 상수배로 유지됨)
+ * 변경을 트리에 반영한 뒤에 불러야 checkpoint에 빠지지 않음
+ */
+static void maybe_checkpoint(rbtree_wal* wal)
+{
+    size_t checkpoint_bytes = wal->tree->size * sizeof(key_t);
+    if (wal->log_bytes >= wal->checkpoint_min && wal->log_bytes >= checkpoint_bytes)
+    {
+        // 실패해도 로그는 그대로 남아 있으므로 다음 기회에 다시 시도
+        wal_checkpoint(wal);
+    }
+}
+
+/*
+ * 로그를 먼저 남기고 트리에 반영
+ */
+node_t* wal_insert(rbtree_wal* wal, const key_t key)
+{
+    if (append_record(wal, WAL_OP_INSERT, key) != 0) return NULL;
+
+    node_t* node = rbtree_insert(wal->tree, key);
+    maybe_checkpoint(wal);
+    return node;
+}
+
+int wal_erase(rbtree_wal* wal, node_t* node)
+{
+    if (!node || node == wal->tree->nil) return -1;
+    if (append_record(wal, WAL_OP_ERASE, node->key) != 0) return -1;
+
+    int err = rbtree_erase(wal->tree, node);
+    maybe_checkpoint(wal);
+    return err;
+}
+
+int wal_sync(rbtree_wal* wal)
+{
+    if (flush_batch(wal) != 0) return -1;
+
+    return fdatasync(wal->log_fd);
+}
+
+static int sync_dir(const char* dir)
+{
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return -1;
+
+    int err = fsync(fd);
+    close(fd);
+    return err;
+}
+
+/*
+ * 정렬된 key 전체를 checkpoint.tmp에 쓰고 fsync 후 rename으로 교체, 그 뒤 로그를 비움
+ * rename 뒤 로그를 비우기 전에 죽어도, 남은 batch는 세대가 낮아서 복구 때 건너뜀
+ */
+int wal_checkpoint(rbtree_wal* wal)
+{
+    if (flush_batch(wal) != 0) return -1;
+
+    char* tmp_path = join_path(wal->dir, "checkpoint.tmp");
+    char* path = join_path(wal->dir, "checkpoint");
+    key_t* buf = (key_t*)malloc(WAL_IO_KEYS * sizeof(key_t));
+    int fd = tmp_path ? open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+    int err = !path || !buf || fd < 0;
+
+    wal_checkpoint_header_t header = { WAL_CHECKPOINT_MAGIC, 0, wal->generation + 1, 0 };
+    if (!err)
+    {
+        err = lseek(fd, sizeof(header), SEEK_SET) < 0;
+    }
+
+    const rbtree* tree = wal->tree;
+    node_t* node = rbtree_min(tree);
+    while (!err && node != tree->nil)
+    {
+        size_t n = 0;
+        for (; n < WAL_IO_KEYS && node != tree->nil; node = rbtree_next(tree, node))
+        {
+            buf[n++] = node->key;
+        }
+        header.crc = crc32_update(header.crc, buf, n * sizeof(key_t));
+        header.count += n;
+        err = write_all(fd, buf, n * sizeof(key_t));
+    }
+
+    if (!err)
+    {
+        err = pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) || fsync(fd) != 0;
+    }
+    if (fd >= 0)
+    {
+        err = close(fd) != 0 || err;
+    }
+    if (!err)
+    {
+        err = rename(tmp_path, path) != 0 || sync_dir(wal->dir) != 0;
+    }
+    if (!err)
+    {
+        wal->generation = header.generation;
+        err = ftruncate(wal->log_fd, 0) != 0 || lseek(wal->log_fd, 0, SEEK_SET) < 0;
+        wal->log_bytes = 0;
+    }
+
+    free(buf);
+    free(path);
+    free(tmp_path);
+    return err ? -1 : 0;
+}
+
+int wal_close(rbtree_wal* wal)
+{
+    if (!wal) return 0;
+
+    int err = wal_sync(wal);
+    close(wal->log_fd);
+    delete_rbtree(wal->tree);
+    free(wal->batch);
+    free(wal->dir);
+    free(wal);
+    return err;
+}
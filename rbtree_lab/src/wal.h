@@ -0,0 +1,38 @@
+#ifndef _WAL_H_
+#define _WAL_H_
+
+#include "rbtree.h"
+
+#include <stdint.h>
+
+// rbtree_insert/rbtree_erase를 append-only 로그에 남기는 내구성 계층
+// 디렉터리 안에 checkpoint(정렬된 key 전체)와 wal.log(그 뒤의 변경)를 둠
+// - 변경은 batch로 모아서 쓰고, batch마다 checksum이 있어서 잘린 꼬리는 복구 때 버림
+// - wal_sync 이후의 변경만 내구성 보장 (group commit)
+// - 로그가 checkpoint 크기만큼 쌓이면 자동으로 checkpoint를 새로 쓰고 로그를 비움
+//   -> 디스크 I/O는 트리 크기가 아니라 변경량에 비례
+
+typedef struct {
+  rbtree *tree;
+  char *dir;
+  int log_fd;
+  uint64_t generation;    // 지금 로그가 이어 붙는 checkpoint 세대
+  unsigned char *batch;   // 아직 안 쓴 레코드
+  size_t batch_len;
+  size_t batch_count;
+  size_t log_bytes;       // wal.log 크기
+  size_t checkpoint_min;  // 로그가 이보다 작으면 자동 checkpoint 안 함
+} rbtree_wal;
+
+// dir의 checkpoint를 O(n)으로 읽고 로그 꼬리만 재생해서 트리 복구 (없으면 빈 트리)
+rbtree_wal *wal_open(const char *dir);
+// 남은 batch를 쓰고 fsync한 뒤 트리까지 해제
+int wal_close(rbtree_wal *);
+
+node_t *wal_insert(rbtree_wal *, const key_t);
+int wal_erase(rbtree_wal *, node_t *);
+
+int wal_sync(rbtree_wal *);
+int wal_checkpoint(rbtree_wal *);
+
+#endif  // _WAL_H_
@@ -0,0 +1,171 @@
+#include <assert.h>
+#include <dirent.h>
+#include <rbtree.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ../src/extsort를 만든 입력으로 실행하고 qsort 결과와 비교
+// -m 1 (노드 약 3만 개)에 입력을 그보다 훨씬 크게 잡아 run 여러 개 + -k 2로 여러 단계 merge를 지나감
+
+#define EXTSORT "../src/extsort"
+
+static char dir[] = "/tmp/test-extsort-XXXXXX";
+
+static int compare_key(const void *a, const void *b)
+{
+  const key_t x = *(const key_t *)a;
+  const key_t y = *(const key_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void write_file(const char *path, const void *data, const size_t bytes)
+{
+  FILE *fp = fopen(path, "wb");
+  assert(fp != NULL);
+  assert(fwrite(data, 1, bytes, fp) == bytes);
+  assert(fclose(fp) == 0);
+}
+
+static key_t *read_file(const char *path, size_t *n)
+{
+  FILE *fp = fopen(path, "rb");
+  assert(fp != NULL);
+  assert(fseek(fp, 0, SEEK_END) == 0);
+  const long bytes = ftell(fp);
+  assert(bytes >= 0 && bytes % sizeof(key_t) == 0);
+  rewind(fp);
+  key_t *keys = malloc(bytes + 1);
+  assert(fread(keys, 1, bytes, fp) == (size_t)bytes);
+  fclose(fp);
+  *n = bytes / sizeof(key_t);
+  return keys;
+}
+
+static int run(const char *args)
+{
+  char cmd[512];
+  snprintf(cmd, sizeof(cmd), "%s -T %s %s", EXTSORT, dir, args);
+  const int status = system(cmd);
+  assert(status != -1 && WIFEXITED(status));
+  return WEXITSTATUS(status);
+}
+
+// 임시 run 파일은 성공해도 실패해도 남지 않아야 함
+static void check_no_runs(void)
+{
+  DIR *d = opendir(dir);
+  assert(d != NULL);
+  for (struct dirent *e; (e = readdir(d));)
+  {
+    assert(strncmp(e->d_name, "extsort-", 8) != 0);
+  }
+  closedir(d);
+}
+
+// keys를 파일로 써서 정렬하고 출력이 qsort한 것과 같은지 확인
+static void test_sort(key_t *keys, const size_t n, const char *opts)
+{
+  char in[128], out[128], args[512];
+  snprintf(in, sizeof(in), "%s/in", dir);
+  snprintf(out, sizeof(out), "%s/out", dir);
+  write_file(in, keys, n * sizeof(key_t));
+  snprintf(args, sizeof(args), "%s %s %s", opts, in, out);
+  assert(run(args) == 0);
+  check_no_runs();
+
+  size_t m;
+  key_t *sorted = read_file(out, &m);
+  qsort(keys, n, sizeof(key_t), compare_key);
+  assert(m == n && memcmp(sorted, keys, n * sizeof(key_t)) == 0);
+  free(sorted);
+}
+
+int main(void)
+{
+  assert(mkdtemp(dir) != NULL);
+  const size_t n = 300000;
+  key_t *keys = malloc(n * sizeof(key_t));
+  unsigned int seed = 17;
+
+  // 무작위: run 여러 개, fan-in 2라서 여러 단계 merge
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = (key_t)(rand_r(&seed) - RAND_MAX / 2);
+  }
+  test_sort(keys, n, "-m 1 -k 2");
+  printf("1 OK\n");
+
+  // 정렬된 입력은 run 하나, 거꾸로면 run마다 메모리만큼
+  test_sort(keys, n, "-m 1 -k 2");
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    const key_t t = keys[i];
+    keys[i] = keys[n - 1 - i];
+    keys[n - 1 - i] = t;
+  }
+  test_sort(keys, n, "-m 1 -k 3");
+  printf("2 OK\n");
+
+  // 같은 key가 많음
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = rand_r(&seed) % 100;
+  }
+  test_sort(keys, n, "-m 1 -k 2");
+  printf("3 OK\n");
+
+  // 빈 입력, 메모리에 다 들어가는 입력
+  test_sort(keys, 0, "");
+  test_sort(keys, 1000, "");
+  printf("4 OK\n");
+
+  // 표준 입출력
+  char args[512];
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = (key_t)rand_r(&seed);
+  }
+  snprintf(args, sizeof(args), "%s/in", dir);
+  write_file(args, keys, n * sizeof(key_t));
+  snprintf(args, sizeof(args), "-m 1 - - < %s/in > %s/out", dir, dir);
+  assert(run(args) == 0);
+  snprintf(args, sizeof(args), "%s/out", dir);
+  size_t m;
+  key_t *sorted = read_file(args, &m);
+  qsort(keys, n, sizeof(key_t), compare_key);
+  assert(m == n && memcmp(sorted, keys, n * sizeof(key_t)) == 0);
+  free(sorted);
+  printf("5 OK\n");
+
+  // key 크기로 나누어떨어지지 않는 입력, 없는 파일, 잘못된 옵션은 실패 (임시 파일은 지움)
+  snprintf(args, sizeof(args), "%s/in", dir);
+  write_file(args, keys, n * sizeof(key_t) - 1);
+  snprintf(args, sizeof(args), "-m 1 %s/in %s/out 2>/dev/null", dir, dir);
+  assert(run(args) == 1);
+  check_no_runs();
+  snprintf(args, sizeof(args), "%s/missing %s/out 2>/dev/null", dir, dir);
+  assert(run(args) == 1);
+  assert(run("-k 1 - - 2>/dev/null") == 2);
+
+  // 입력과 출력이 같은 파일이면 입력을 자르지 않고 실패
+  snprintf(args, sizeof(args), "%s/in", dir);
+  write_file(args, keys, n * sizeof(key_t));
+  snprintf(args, sizeof(args), "%s/in %s/./in 2>/dev/null", dir, dir);
+  assert(run(args) == 1);
+  snprintf(args, sizeof(args), "%s/in", dir);
+  sorted = read_file(args, &m);
+  assert(m == n && memcmp(sorted, keys, n * sizeof(key_t)) == 0);
+  free(sorted);
+  printf("6 OK\n");
+
+  snprintf(args, sizeof(args), "%s/in", dir);
+  unlink(args);
+  snprintf(args, sizeof(args), "%s/out", dir);
+  unlink(args);
+  assert(rmdir(dir) == 0);
+  free(keys);
+  printf("Passed all tests!\n");
+}
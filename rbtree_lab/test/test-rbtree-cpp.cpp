@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <iterator>
+#include <memory_resource>
+#include <numeric>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+#include <rbtree.hpp>
+
+// counts bytes handed out so the test can see node storage going through it
+class counting_resource : public std::pmr::memory_resource {
+ public:
+  std::size_t live = 0;
+  std::size_t total = 0;
+
+ private:
+  void *do_allocate(std::size_t bytes, std::size_t align) override {
+    live += bytes;
+    total += bytes;
+    return std::pmr::new_delete_resource()->allocate(bytes, align);
+  }
+  void do_deallocate(void *p, std::size_t bytes, std::size_t align) override {
+    live -= bytes;
+    std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+};
+
+static_assert(!std::is_copy_constructible_v<rb::multiset>);
+static_assert(std::is_nothrow_move_constructible_v<rb::multiset>);
+static_assert(std::is_same_v<std::iterator_traits<rb::multiset::iterator>::iterator_category,
+                             std::bidirectional_iterator_tag>);
+
+// iteration, algorithms and lookups should agree with std::multiset
+void test_against_std() {
+  rb::multiset set;
+  std::multiset<int> ref;
+  assert(set.begin() == set.end());
+
+  for (int i = 0; i < 2000; i++) {
+    const int k = (i * 7919) % 503;
+    set.emplace(k);
+    ref.insert(k);
+  }
+  assert(set.size() == ref.size());
+  assert(std::equal(set.begin(), set.end(), ref.begin(), ref.end()));
+  assert(std::equal(set.rbegin(), set.rend(), ref.rbegin(), ref.rend()));
+  assert(std::is_sorted(set.begin(), set.end()));
+  assert(std::accumulate(set.begin(), set.end(), 0LL) == std::accumulate(ref.begin(), ref.end(), 0LL));
+  assert(*std::prev(set.end()) == *ref.rbegin());
+
+  long long sum = 0;
+  for (int k : set) sum += k;
+  assert(sum == std::accumulate(ref.begin(), ref.end(), 0LL));
+
+  for (int k = -5; k < 510; k += 3) {
+    assert(set.count(k) == ref.count(k));
+    assert(set.contains(k) == (ref.count(k) > 0));
+    auto lb = set.lower_bound(k);
+    auto rlb = ref.lower_bound(k);
+    assert((lb == set.end()) == (rlb == ref.end()));
+    if (lb != set.end()) assert(*lb == *rlb);
+  }
+
+  // erase while iterating: every other element
+  bool drop = true;
+  auto rit = ref.begin();
+  for (auto it = set.begin(); it != set.end();) {
+    if (drop) {
+      it = set.erase(it);
+      rit = ref.erase(rit);
+    } else {
+      ++it;
+      ++rit;
+    }
+    drop = !drop;
+  }
+  assert(std::equal(set.begin(), set.end(), ref.begin(), ref.end()));
+
+  assert(set.erase(17) == ref.erase(17));
+  assert(std::equal(set.begin(), set.end(), ref.begin(), ref.end()));
+}
+
+// moves should transfer the tree without copying and leave the source destructible
+void test_move() {
+  rb::multiset a{5, 3, 9, 3};
+  rbtree *handle = a.native_handle();
+  rb::multiset b(std::move(a));
+  assert(b.native_handle() == handle);
+  assert(b.size() == 4);
+
+  rb::multiset c;
+  c = std::move(b);
+  assert(c.native_handle() == handle);
+  std::vector<int> out(c.begin(), c.end());
+  assert((out == std::vector<int>{3, 3, 5, 9}));
+
+  c.clear();
+  assert(c.empty() && c.begin() == c.end());
+  c.insert(1);
+  assert(c.size() == 1 && *c.begin() == 1);
+}
+
+// node storage should come from the given memory_resource
+void test_pmr() {
+  counting_resource res;
+  {
+    rb::multiset set(&res);
+    for (int i = 0; i < 100; i++) set.insert(i);
+    assert(res.live == 100 * sizeof(node_t));
+    set.erase(set.find(50));
+    assert(res.live == 99 * sizeof(node_t));
+    // clear keeps the nodes for reuse
+    set.clear();
+    assert(set.empty() && res.live == 99 * sizeof(node_t));
+    set.insert(3);
+    assert(res.live == 99 * sizeof(node_t));
+  }
+  assert(res.live == 0);
+  assert(res.total == 100 * sizeof(node_t));
+}
+
+// modes enabled on the native handle should be reflected in insert/size
+void test_native_modes() {
+  rb::multiset top;
+  assert(rbtree_set_capacity(top.native_handle(), 3) == 0);
+  for (int i = 1; i <= 5; i++) top.insert(i);
+  assert(top.size() == 3 && *top.begin() == 3);
+  // a rejected key is not an allocation failure
+  assert(top.insert(2) == top.end());
+  assert(top.size() == 3);
+
+  rb::multiset lazy{1, 2, 2, 3};
+  assert(rbtree_set_lazy_erase(lazy.native_handle(), 1.0) == 0);
+  assert(lazy.erase(2) == 2);
+  assert(lazy.size() == 2 && !lazy.contains(2));
+  lazy.insert(2);
+  assert(lazy.size() == 3);
+}
+
+int main() {
+  test_against_std();
+  printf("1 OK\n");
+
+  test_move();
+  printf("2 OK\n");
+
+  test_pmr();
+  printf("3 OK\n");
+
+  test_native_modes();
+  printf("Passed all tests!\n");
+}
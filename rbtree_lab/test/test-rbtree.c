@@ -1,8 +1,28 @@
 #include <assert.h>
+#include <aggregate.h>
+#include <bloom.h>
+#include <ctree.h>
+#include <fcntl.h>
+#include <fctree.h>
+#include <ingest.h>
+#include <interval.h>
+#include <keystream.h>
+#include <limits.h>
+#include <node_arena.h>
+#include <pthread.h>
 #include <rbtree.h>
+#include <shmtree.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strtree.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <trace.h>
+#include <unistd.h>
+#include <wal.h>
 
 // new_rbtree should return rbtree struct with null root node
 void test_init(void)
@@ -306,7 +326,9 @@ void test_rb_constraints(const key_t arr[], const size_t n)
   insert_arr(t, arr, n);
   assert(t->root != NULL);
 
+#ifndef RBTREE_CORE_ONLY
   test_color_constraint(t);
+#endif
   test_search_constraint(t);
 
   delete_rbtree(t);
@@ -412,38 +434,1924 @@ void test_find_erase_rand(const size_t n, const unsigned int seed)
   delete_rbtree(t);
 }
 
-int main(void)
+static int comp_ptr(const void *p1, const void *p2)
 {
-  test_init();
-  printf("1 OK\n");
+  const uintptr_t a = (uintptr_t)*(node_t *const *)p1, b = (uintptr_t)*(node_t *const *)p2;
+  return (a > b) - (a < b);
+}
 
-  test_insert_single(1024);
-  printf("2 OK\n");
+// 노드를 지워도 나머지 노드 포인터는 그대로 유효하고 같은 key를 가리켜야 함
+void test_erase_keeps_handles(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  rbtree *t = new_rbtree();
+  node_t **handles = calloc(n, sizeof(node_t *));
+  key_t *keys = calloc(n, sizeof(key_t));
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = rand() % (key_t)n;  // 같은 key도 섞임
+    handles[i] = rbtree_insert(t, keys[i]);
+  }
 
-  test_find_single(512, 1024);
-  printf("3 OK\n");
+  size_t live = n;
+  while (live > n / 4)
+  {
+    const size_t j = rand() % live;
+    rbtree_erase(t, handles[j]);
+    handles[j] = handles[--live];
+    keys[j] = keys[live];
+    for (size_t k = 0; k < 8 && live > 0; ++k)
+    {
+      const size_t r = rand() % live;
+      assert(handles[r]->key == keys[r]);
+    }
+  }
 
-  test_erase_root(128);
-  printf("4 OK\n");
+  // 트리에 남은 노드 집합 == 지우지 않은 handle 집합
+  node_t **nodes = calloc(live, sizeof(node_t *));
+  size_t cnt = 0;
+  for (node_t *p = rbtree_min(t); p != t->nil; p = rbtree_next(t, p))
+  {
+    assert(cnt < live);
+    nodes[cnt++] = p;
+  }
+  assert(cnt == live);
+  qsort(nodes, live, sizeof(node_t *), comp_ptr);
+  qsort(handles, live, sizeof(node_t *), comp_ptr);
+  assert(memcmp(nodes, handles, live * sizeof(node_t *)) == 0);
+
+  free(nodes);
+  free(keys);
+  free(handles);
+  delete_rbtree(t);
+}
 
-  test_find_erase_fixed();
-  printf("5 OK\n");
+// 아래는 red-black 구현에만 있는 확장 기능 테스트
+// 다른 backend(-DRBTREE_CORE_ONLY)는 위의 핵심 API 테스트만, color 검사 없이 실행
+#ifndef RBTREE_CORE_ONLY
 
-  test_minmax_suite();
-  printf("6 OK\n");
+// max_hi should equal the largest hi in each subtree
+static key_t interval_check(const rbtree *t, const node_t *p)
+{
+  if (p == t->nil)
+  {
+    return -1;
+  }
+  const interval_t *iv = (const interval_t *)p;
+  key_t m = iv->hi;
+  const key_t l = interval_check(t, p->left);
+  const key_t r = interval_check(t, p->right);
+  if (l > m)
+  {
+    m = l;
+  }
+  if (r > m)
+  {
+    m = r;
+  }
+  assert(iv->max_hi == m);
+  return m;
+}
 
-  test_to_array_suite();
-  printf("7 OK\n");
+static void interval_query_check(const rbtree *t, interval_t **ivs,
+                                 const bool *alive, const size_t n,
+                                 interval_t **res, const key_t lo,
+                                 const key_t hi)
+{
+  size_t expected = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (alive[i] && ivs[i]->node.key < hi && ivs[i]->hi > lo)
+    {
+      expected++;
+    }
+  }
+  const size_t got = interval_overlap(t, lo, hi, res, n);
+  assert(got == expected);
+  for (size_t i = 0; i < got; i++)
+  {
+    assert(res[i]->node.key < hi && res[i]->hi > lo);
+    assert(i == 0 || res[i - 1]->node.key <= res[i]->node.key);
+  }
 
-  test_distinct_values();
-  printf("8 OK\n");
+  expected = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (alive[i] && ivs[i]->node.key <= lo && ivs[i]->hi > lo)
+    {
+      expected++;
+    }
+  }
+  assert(interval_stabbing(t, lo, res, n) == expected);
+}
 
-  test_duplicate_values();
-  printf("9 OK\n");
+// interval tree should keep max_hi through rotations and answer overlap
+// queries like a linear scan
+void test_interval_tree(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  rbtree *t = new_interval_tree();
+  interval_t **ivs = calloc(n, sizeof(interval_t *));
+  interval_t **res = calloc(n, sizeof(interval_t *));
+  bool *alive = calloc(n, sizeof(bool));
 
-  test_multi_instance();
-  printf("10 OK\n");
+  assert(interval_insert(t, 5, 5) == NULL);
+  for (size_t i = 0; i < n; i++)
+  {
+    const key_t lo = rand() % 1000;
+    ivs[i] = interval_insert(t, lo, lo + 1 + rand() % 50);
+    assert(ivs[i] != NULL);
+    alive[i] = true;
+  }
+  interval_check(t, t->root);
+  test_color_constraint(t);
+
+  for (key_t q = -10; q < 1100; q += 7)
+  {
+    interval_query_check(t, ivs, alive, n, res, q, q + rand() % 30 + 1);
+  }
+
+  // erase relinks the successor instead of copying it, so every other
+  // handle stays valid and only the erased one leaves the table
+  for (size_t r = 0; r < n / 2; r++)
+  {
+    const size_t got = interval_stabbing(t, rand() % 1000, res, n);
+    if (got == 0)
+    {
+      continue;
+    }
+    interval_t *victim = res[rand() % got];
+    size_t i = 0;
+    while (ivs[i] != victim)
+    {
+      i++;
+    }
+    assert(alive[i]);
+    rbtree_erase(t, &victim->node);
+    alive[i] = false;
+    interval_check(t, t->root);
+    test_color_constraint(t);
+  }
+
+  for (key_t q = -10; q < 1100; q += 13)
+  {
+    interval_query_check(t, ivs, alive, n, res, q, q + rand() % 30 + 1);
+  }
+
+  free(alive);
+  free(res);
+  free(ivs);
+  delete_rbtree(t);
+}
+
+static agg_t aggregate_scan(const rbtree_monoid_t *m, const key_t *arr,
+                            const size_t n, const key_t lo, const key_t hi)
+{
+  agg_t acc = m->identity;
+  for (size_t i = 0; i < n; i++)
+  {
+    if (arr[i] >= lo && arr[i] < hi)
+    {
+      acc = m->combine(acc, m->value(arr[i]));
+    }
+  }
+  return acc;
+}
+
+// range aggregates should match a scan over to_array while erasing
+void test_aggregate(const rbtree_monoid_t *m, const size_t n,
+                    const unsigned int seed)
+{
+  srand(seed);
+  rbtree *t = new_rbtree_aggregate(m);
+  assert(t != NULL);
+  for (size_t i = 0; i < n; i++)
+  {
+    rbtree_insert(t, rand() % 2000 - 1000);
+  }
+  test_color_constraint(t);
+
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (size_t round = 0; round < n / 2; round++)
+  {
+    const size_t cnt = rbtree_to_array(t, arr, n);
+    for (int q = 0; q < 8; q++)
+    {
+      const key_t lo = rand() % 2400 - 1200;
+      const key_t hi = lo + rand() % 600;
+      assert(rbtree_aggregate(t, lo, hi) == aggregate_scan(m, arr, cnt, lo, hi));
+    }
+    rbtree_erase(t, rbtree_find(t, arr[rand() % cnt]));
+  }
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  free(arr);
+  delete_rbtree(t);
+}
+
+void test_aggregate_suite()
+{
+  test_aggregate(&rbtree_monoid_sum, 400, 31);
+  test_aggregate(&rbtree_monoid_count, 400, 37);
+  test_aggregate(&rbtree_monoid_min, 400, 41);
+  test_aggregate(&rbtree_monoid_max, 400, 43);
+}
+
+// find_batch should return exactly what rbtree_find returns per key
+void test_find_batch(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  rbtree *t = new_rbtree();
+  key_t *keys = calloc(n, sizeof(key_t));
+  node_t **out = calloc(n, sizeof(node_t *));
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = rand() % (int)(2 * n);
+    if (i % 2 == 0)
+    {
+      rbtree_insert(t, keys[i]);
+    }
+  }
+
+  rbtree_find_batch(t, keys, n, out);
+  for (size_t i = 0; i < n; i++)
+  {
+    assert(out[i] == rbtree_find(t, keys[i]));
+  }
+
+  free(out);
+  free(keys);
+  delete_rbtree(t);
+}
+
+// compact should keep contents and constraints and leave the tree mutable
+void test_compact(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  rbtree *t = new_rbtree();
+  assert(rbtree_compact(t) == 0);
+
+  key_t *arr = calloc(n, sizeof(key_t));
+  key_t *res = calloc(n, sizeof(key_t));
+  for (size_t i = 0; i < n; i++)
+  {
+    arr[i] = rand() % 5000;
+    rbtree_insert(t, arr[i]);
+  }
+
+  for (int round = 0; round < 3; round++)
+  {
+    assert(rbtree_compact(t) == 0);
+    test_color_constraint(t);
+    test_search_constraint(t);
+    qsort(arr, n, sizeof(key_t), comp);
+    assert(rbtree_to_array(t, res, n) == (int)n);
+    for (size_t i = 0; i < n; i++)
+    {
+      assert(arr[i] == res[i]);
+    }
+
+    // churn: erase half (nodes go to the free list) and insert again
+    for (size_t i = 0; i < n; i += 2)
+    {
+      rbtree_erase(t, rbtree_find(t, arr[i]));
+      arr[i] = rand() % 5000;
+      rbtree_insert(t, arr[i]);
+    }
+    test_color_constraint(t);
+  }
+
+  free(res);
+  free(arr);
+  delete_rbtree(t);
+}
+
+static void collect_nodes(const rbtree *t, node_t *p, node_t **out, size_t *k)
+{
+  if (p == t->nil)
+  {
+    return;
+  }
+  collect_nodes(t, p->left, out, k);
+  out[(*k)++] = p;
+  collect_nodes(t, p->right, out, k);
+}
+
+// every key should map to a live node holding that key
+static void check_index(const rbtree *t, node_t **nodes, const key_t range)
+{
+  size_t cnt = 0;
+  collect_nodes(t, t->root, nodes, &cnt);
+  for (key_t k = 0; k < range; k++)
+  {
+    bool present = false;
+    for (size_t i = 0; i < cnt; i++)
+    {
+      present = present || nodes[i]->key == k;
+    }
+    node_t *p = rbtree_find(t, k);
+    assert((p != NULL) == present);
+    if (p != NULL)
+    {
+      assert(p->key == k);
+      bool live = false;
+      for (size_t i = 0; i < cnt; i++)
+      {
+        live = live || nodes[i] == p;
+      }
+      assert(live);
+    }
+  }
+}
+
+// the hash index should stay in sync through insert, erase and compact
+void test_hash_index(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  const key_t range = (key_t)n / 2;
+  rbtree *t = new_rbtree();
+  node_t **nodes = calloc(n, sizeof(node_t *));
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    rbtree_insert(t, rand() % range);
+  }
+  assert(rbtree_enable_index(t) == 0);
+  check_index(t, nodes, range);
+
+  for (size_t i = n / 2; i < n; i++)
+  {
+    rbtree_insert(t, rand() % range);
+  }
+  check_index(t, nodes, range);
+
+  for (size_t r = 0; r < n / 2; r++)
+  {
+    size_t cnt = 0;
+    collect_nodes(t, t->root, nodes, &cnt);
+    rbtree_erase(t, nodes[rand() % cnt]);
+    check_index(t, nodes, range);
+    if (r == n / 4)
+    {
+      assert(rbtree_compact(t) == 0);
+      check_index(t, nodes, range);
+    }
+  }
+  test_color_constraint(t);
+
+  rbtree_disable_index(t);
+  check_index(t, nodes, range);
+
+  free(nodes);
+  delete_rbtree(t);
+}
+
+// the tree built by purge should satisfy the rb constraints for any size
+void test_purge_shapes(void)
+{
+  for (size_t n = 1; n < 70; n++)
+  {
+    rbtree *t = new_rbtree();
+    assert(rbtree_set_lazy_erase(t, 1.0) == 0);
+    for (size_t i = 0; i < 2 * n; i++)
+    {
+      rbtree_insert(t, (key_t)i);
+    }
+    // erase the odd keys lazily then rebuild from the n survivors
+    for (size_t i = 1; i < 2 * n; i += 2)
+    {
+      rbtree_erase(t, rbtree_find(t, (key_t)i));
+    }
+    assert(t->dead_count == n);
+    rbtree_purge(t);
+    assert(t->dead_count == 0 && t->size == n);
+    test_color_constraint(t);
+    test_search_constraint(t);
+    delete_rbtree(t);
+  }
+}
+
+// lazily erased nodes should be invisible to find, min/max, next/prev and
+// to_array, and be reclaimed once the tombstone ratio is crossed
+void test_lazy_erase(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  const key_t range = (key_t)n / 4;
+  rbtree *t = new_rbtree();
+  assert(rbtree_set_lazy_erase(t, 0.25) == 0);
+
+  int *counts = calloc(range, sizeof(int));
+  key_t *res = calloc(5 * n, sizeof(key_t));
+  size_t total = 0;
+  for (size_t i = 0; i < n; i++)
+  {
+    const key_t k = rand() % range;
+    rbtree_insert(t, k);
+    counts[k]++;
+    total++;
+  }
+
+  bool purged = false;
+  for (size_t r = 0; r < 4 * n; r++)
+  {
+    const key_t k = rand() % range;
+    if (rand() % 2 && counts[k] > 0)
+    {
+      node_t *p = rbtree_find(t, k);
+      assert(p != NULL && p->key == k && !p->dead);
+      const size_t dead = t->dead_count;
+      rbtree_erase(t, p);
+      purged = purged || t->dead_count < dead;
+      counts[k]--;
+      total--;
+    }
+    else
+    {
+      node_t *p = rbtree_insert(t, k);
+      assert(p != NULL && p->key == k && !p->dead);
+      counts[k]++;
+      total++;
+    }
+    assert(t->dead_count <= 0.25 * t->size + 1);
+
+    if (r % 64 == 0)
+    {
+      for (key_t q = 0; q < range; q++)
+      {
+        assert((rbtree_find(t, q) != NULL) == (counts[q] > 0));
+      }
+      assert(rbtree_to_array(t, res, 5 * n) == (int)total);
+      size_t i = 0;
+      for (key_t q = 0; q < range; q++)
+      {
+        for (int c = 0; c < counts[q]; c++)
+        {
+          assert(res[i++] == q);
+        }
+      }
+      if (total > 0)
+      {
+        assert(rbtree_min(t)->key == res[0]);
+        assert(rbtree_max(t)->key == res[total - 1]);
+        i = 0;
+        for (node_t *p = rbtree_min(t); p != t->nil; p = rbtree_next(t, p))
+        {
+          assert(!p->dead && p->key == res[i++]);
+        }
+        assert(i == total);
+        for (node_t *p = rbtree_prev(t, t->nil); p != t->nil; p = rbtree_prev(t, p))
+        {
+          assert(!p->dead && p->key == res[--i]);
+        }
+      }
+      test_color_constraint(t);
+    }
+  }
+  assert(purged);
+
+  assert(rbtree_set_lazy_erase(t, 0) == 0);
+  assert(t->dead_count == 0 && t->size == total);
+  test_color_constraint(t);
+
+  free(res);
+  free(counts);
+  delete_rbtree(t);
+}
+
+typedef struct {
+  unsigned char bytes[40];
+  size_t len;
+} test_str_t;
+
+static int test_str_cmp(const void *a, const void *b)
+{
+  const test_str_t *x = (const test_str_t *)a;
+  const test_str_t *y = (const test_str_t *)b;
+  const size_t m = x->len < y->len ? x->len : y->len;
+  const int c = memcmp(x->bytes, y->bytes, m);
+  if (c) return c;
+  return (x->len > y->len) - (x->len < y->len);
+}
+
+// 앞 16바이트가 자주 겹치고, 0 바이트와 서로의 prefix인 key가 섞이도록 만든 key로 memcmp 순서와 비교
+void test_strtree(size_t n, unsigned int seed)
+{
+  srand(seed);
+  test_str_t *keys = calloc(n, sizeof(test_str_t));
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i].len = rand() % 40;
+    for (size_t j = 0; j < keys[i].len; j++)
+    {
+      // 앞부분은 거의 같은 값이라 prefix가 겹침
+      keys[i].bytes[j] = (j < 14 && rand() % 8) ? 'a' : rand() % 3;
+    }
+  }
+
+  strtree *st = new_strtree();
+  assert(st != NULL);
+  for (size_t i = 0; i < n; i++)
+  {
+    strnode_t *p = strtree_insert(st, keys[i].bytes, keys[i].len);
+    assert(p != NULL && p->len == keys[i].len);
+    assert(memcmp(strtree_key(p), keys[i].bytes, p->len) == 0);
+  }
+  test_color_constraint(st->tree);
+
+  qsort(keys, n, sizeof(test_str_t), test_str_cmp);
+  size_t i = 0;
+  for (strnode_t *p = strtree_min(st); p != NULL; p = strtree_next(st, p))
+  {
+    assert(p->len == keys[i].len && memcmp(strtree_key(p), keys[i].bytes, p->len) == 0);
+    i++;
+  }
+  assert(i == n);
+
+  for (i = 0; i < n; i++)
+  {
+    strnode_t *p = strtree_find(st, keys[i].bytes, keys[i].len);
+    assert(p != NULL && p->len == keys[i].len && memcmp(strtree_key(p), keys[i].bytes, p->len) == 0);
+
+    p = strtree_lower_bound(st, keys[i].bytes, keys[i].len);
+    assert(p != NULL && p->len == keys[i].len && memcmp(strtree_key(p), keys[i].bytes, p->len) == 0);
+  }
+
+  // 없는 key: 40바이트 이상은 만든 적이 없음
+  unsigned char missing[41];
+  memset(missing, 'a', sizeof(missing));
+  assert(strtree_find(st, missing, sizeof(missing)) == NULL);
+
+  // 절반 삭제 후에도 순서와 find가 유지되는지
+  for (i = 0; i < n; i += 2)
+  {
+    strnode_t *p = strtree_find(st, keys[i].bytes, keys[i].len);
+    assert(p != NULL);
+    strtree_erase(st, p);
+  }
+  test_color_constraint(st->tree);
+
+  size_t live = 0;
+  for (strnode_t *p = strtree_min(st), *prev = NULL; p != NULL; prev = p, p = strtree_next(st, p))
+  {
+    if (prev)
+    {
+      test_str_t a, b;
+      a.len = prev->len;
+      memcpy(a.bytes, strtree_key(prev), a.len);
+      b.len = p->len;
+      memcpy(b.bytes, strtree_key(p), b.len);
+      assert(test_str_cmp(&a, &b) <= 0);
+    }
+    live++;
+  }
+  assert(live == n / 2);
+
+  for (i = 1; i < n; i += 2)
+  {
+    assert(strtree_find(st, keys[i].bytes, keys[i].len) != NULL);
+  }
+
+  // 지운 긴 key 자리는 같은 크기 class의 다음 삽입이 다시 씀 (chunk보다 긴 key는 전용 chunk를 해제)
+  static unsigned char big[100000];
+  memset(big, 'z', sizeof(big));
+  for (i = 0; i < 2000; i++)
+  {
+    const size_t len = (i % 100 == 0) ? sizeof(big) - rand() % 100 : STRTREE_INLINE + 1 + rand() % 300;
+    strnode_t *p = strtree_insert(st, big, len);
+    assert(p != NULL && p->len == len && memcmp(strtree_key(p), big, len) == 0);
+    const unsigned char *bytes = strtree_key(p);
+    strtree_erase(st, p);
+
+    p = strtree_insert(st, big, len);
+    assert(p != NULL && memcmp(strtree_key(p), big, len) == 0);
+    assert(len > sizeof(big) / 2 || strtree_key(p) == bytes);
+    strtree_erase(st, p);
+  }
+  test_color_constraint(st->tree);
+
+  delete_strtree(st);
+  free(keys);
+}
+
+// 서브트리의 black 높이, 규칙이 깨지면 assert
+static int test_shm_black_height(const shm_segment_t *seg, shm_ref_t x, shm_ref_t parent)
+{
+  if (x == 0) return 1;
+  const shm_node_t *n = &seg->nodes[x];
+  assert(n->parent == parent);
+  if (n->color == RBTREE_RED)
+  {
+    assert(seg->nodes[n->left].color == RBTREE_BLACK && seg->nodes[n->right].color == RBTREE_BLACK);
+  }
+  const int l = test_shm_black_height(seg, n->left, x);
+  assert(l == test_shm_black_height(seg, n->right, x));
+  return l + (n->color == RBTREE_BLACK);
+}
+
+// 쓰는 프로세스가 갱신한 트리를 fork한 다른 프로세스가 이름으로 열어서 복사 없이 검색
+void test_shmtree(size_t n, unsigned int seed)
+{
+  char name[64];
+  snprintf(name, sizeof(name), "/rbtree-test-%d", (int)getpid());
+  shmtree_unlink(name);
+
+  srand(seed);
+  const key_t range = (key_t)(n / 2);
+  shmtree *st = shmtree_create(name, n);
+  assert(st != NULL);
+  assert(shmtree_create(name, n) == NULL);  // 이미 있음
+
+  int *counts = calloc(range, sizeof(int));
+  key_t *res = calloc(n, sizeof(key_t));
+  size_t total = 0;
+  for (size_t r = 0; r < 3 * n; r++)
+  {
+    const key_t k = rand() % range;
+    if (rand() % 3 == 0)
+    {
+      assert(shmtree_erase(st, k) == (counts[k] > 0 ? 0 : -1));
+      if (counts[k] > 0)
+      {
+        counts[k]--;
+        total--;
+      }
+    }
+    else if (total < n)
+    {
+      assert(shmtree_insert(st, k) == 0);
+      counts[k]++;
+      total++;
+    }
+    else
+    {
+      assert(shmtree_insert(st, k) == -1);  // 칸이 다 참
+    }
+  }
+  assert(shmtree_size(st) == total);
+  assert(st->seg->nodes[st->seg->root].color == RBTREE_BLACK);
+  test_shm_black_height(st->seg, st->seg->root, 0);
+
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0)
+  {
+    // 자식: 같은 세그먼트를 다른 주소에 매핑해도 인덱스 링크라 그대로 동작
+    shmtree *view = shmtree_open(name);
+    int ok = view != NULL && shmtree_size(view) == total;
+    for (key_t k = 0; ok && k < range; k++)
+    {
+      ok = shmtree_find(view, k) == (counts[k] > 0);
+    }
+    ok = ok && shmtree_insert(view, range) == 0;
+    shmtree_close(view);
+    _exit(ok ? 0 : 1);
+  }
+  int status;
+  assert(waitpid(pid, &status, 0) == pid);
+  assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // 자식이 넣은 key가 보여야 함
+  assert(shmtree_find(st, range) && shmtree_size(st) == total + 1);
+  assert(shmtree_erase(st, range) == 0);
+
+  assert(shmtree_to_array(st, res, n) == (int)total);
+  size_t i = 0;
+  for (key_t k = 0; k < range; k++)
+  {
+    for (int c = 0; c < counts[k]; c++)
+    {
+      assert(res[i++] == k);
+    }
+  }
+  shmtree_close(st);
+  assert(shmtree_unlink(name) == 0);
+
+  // 정렬된 key 대량 적재
+  st = shmtree_create(name, total);
+  assert(st != NULL);
+  assert(shmtree_load(st, res, total) == 0);
+  assert(shmtree_load(st, res, total) == -1);
+  test_shm_black_height(st->seg, st->seg->root, 0);
+  key_t *again = calloc(n, sizeof(key_t));
+  assert(shmtree_to_array(st, again, n) == (int)total);
+  for (i = 0; i < total; i++)
+  {
+    assert(again[i] == res[i]);
+  }
+  assert(shmtree_insert(st, 0) == -1);
+  assert(shmtree_erase(st, res[total / 2]) == 0);
+  assert(shmtree_insert(st, 0) == 0);  // 지운 칸 재사용
+  test_shm_black_height(st->seg, st->seg->root, 0);
+
+  shmtree_close(st);
+  assert(shmtree_unlink(name) == 0);
+  assert(shmtree_open(name) == NULL);
+
+  free(again);
+  free(res);
+  free(counts);
+}
+
+typedef struct {
+  size_t live;
+  size_t total;
+} test_alloc_count_t;
+
+static void *test_count_alloc(void *ctx, size_t size)
+{
+  test_alloc_count_t *c = (test_alloc_count_t *)ctx;
+  __atomic_add_fetch(&c->live, 1, __ATOMIC_RELAXED);
+  c->total++;
+  return malloc(size);
+}
+
+static void test_count_dealloc(void *ctx, void *ptr, size_t size)
+{
+  test_alloc_count_t *c = (test_alloc_count_t *)ctx;
+  __atomic_sub_fetch(&c->live, 1, __ATOMIC_RELAXED);
+  free(ptr);
+}
+
+static rbtree *test_counted_tree(test_alloc_count_t *c)
+{
+  rbtree *t = new_rbtree();
+  rbtree_allocator_t a = {test_count_alloc, test_count_dealloc, c};
+  assert(rbtree_set_allocator(t, &a) == 0);
+  return t;
+}
+
+// rbtree_destroy_step은 한 번에 budget개 이하만 해제, rbtree_clear는 노드를 재사용
+void test_destroy_clear(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  test_alloc_count_t c = {0, 0};
+  rbtree *t = test_counted_tree(&c);
+  for (size_t i = 0; i < n; i++)
+  {
+    rbtree_insert(t, rand() % n);
+  }
+  assert(c.live == n);
+
+  size_t calls = 0;
+  size_t before = c.live;
+  while (rbtree_destroy_step(t, 8))
+  {
+    assert(before - c.live <= 8);
+    before = c.live;
+    calls++;
+  }
+  assert(c.live == 0 && calls <= 2 * n / 8 + 1);
+
+  // clear 후 다시 넣으면 새로 할당하지 않음
+  c.total = 0;
+  t = test_counted_tree(&c);
+  rbtree_enable_index(t);
+  key_t *arr = calloc(n, sizeof(key_t));
+  for (size_t i = 0; i < n; i++)
+  {
+    arr[i] = rand() % n;
+    rbtree_insert(t, arr[i]);
+  }
+  rbtree_clear(t);
+  assert(t->root == t->nil && t->size == 0 && c.live == n);
+  assert(rbtree_min(t) == t->nil && rbtree_find(t, arr[0]) == NULL);
+  assert(rbtree_set_allocator(t, NULL) == -1);  // 남은 노드가 이 할당자 것
+
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    rbtree_insert(t, arr[i]);
+  }
+  assert(c.total == n);
+  test_color_constraint(t);
+  test_search_constraint(t);
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    node_t *p = rbtree_find(t, arr[i]);
+    assert(p != NULL && p->key == arr[i]);
+  }
+
+  // spare가 남은 상태에서 한 번 더 clear: 두 덩어리가 합쳐짐
+  rbtree_clear(t);
+  for (size_t i = 0; i < n; i++)
+  {
+    rbtree_insert(t, arr[i]);
+  }
+  assert(c.total == n && c.live == n);
+  rbtree_insert(t, 0);
+  assert(c.total == n + 1);
+
+  // compact는 남은 spare를 돌려주고 노드를 블록으로 옮김
+  rbtree_clear(t);
+  for (size_t i = 0; i < n / 4; i++)
+  {
+    rbtree_insert(t, arr[i]);
+  }
+  assert(rbtree_compact(t) == 0);
+  assert(c.live == 0);
+  test_color_constraint(t);
+  rbtree_clear(t);
+  for (size_t i = 0; i < n / 4; i++)
+  {
+    rbtree_insert(t, arr[i]);
+  }
+  assert(c.live == 0);  // 블록 노드 재사용
+  delete_rbtree(t);
+
+  // 백그라운드 해제
+  t = test_counted_tree(&c);
+  for (size_t i = 0; i < n; i++)
+  {
+    rbtree_insert(t, arr[i]);
+  }
+  assert(rbtree_destroy_async(t) == 0);
+  for (int spin = 0; spin < 10000 && __atomic_load_n(&c.live, __ATOMIC_RELAXED) > 0; spin++)
+  {
+    usleep(1000);
+  }
+  assert(__atomic_load_n(&c.live, __ATOMIC_RELAXED) == 0);
+
+  free(arr);
+}
+
+// 용량이 찬 뒤로는 할당 없이 가장 큰 k개만 유지
+void test_topk(const size_t n, const size_t k, const unsigned int seed)
+{
+  srand(seed);
+  test_alloc_count_t c = {0, 0};
+  rbtree *t = test_counted_tree(&c);
+  assert(rbtree_set_capacity(t, k) == 0);
+  assert(rbtree_set_lazy_erase(t, 0.5) == -1);
+  rbtree_enable_index(t);
+
+  key_t *stream = calloc(n, sizeof(key_t));
+  for (size_t i = 0; i < n; i++)
+  {
+    stream[i] = rand() % (4 * k);
+    node_t *p = rbtree_insert(t, stream[i]);
+    assert(p != NULL && (p == t->nil || p->key == stream[i]));
+    assert(t->size == (i + 1 < k ? i + 1 : k));
+  }
+  assert(c.total == k && c.live == k);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  qsort(stream, n, sizeof(key_t), comp);
+  key_t *res = calloc(k, sizeof(key_t));
+  assert(rbtree_to_array(t, res, k) == (int)k);
+  for (size_t i = 0; i < k; i++)
+  {
+    assert(res[i] == stream[n - k + i]);
+    assert(rbtree_find(t, res[i]) != NULL);
+  }
+  assert(rbtree_find(t, stream[0]) == NULL || stream[0] == stream[n - k]);
+
+  // 줄이면 작은 것부터 지움
+  assert(rbtree_set_capacity(t, k / 2) == 0);
+  assert(t->size == k / 2 && rbtree_min(t)->key == stream[n - k / 2]);
+  assert(rbtree_set_capacity(t, 0) == 0);
+  rbtree_insert(t, -1);
+  assert(t->size == k / 2 + 1);
+  delete_rbtree(t);
+
+  // 밖에서 지워도 최솟값을 다시 찾음
+  t = new_rbtree();
+  rbtree_set_capacity(t, 3);
+  rbtree_insert(t, 5);
+  rbtree_insert(t, 6);
+  rbtree_insert(t, 7);
+  assert(rbtree_insert(t, 5) == t->nil);
+  rbtree_erase(t, rbtree_find(t, 5));
+  rbtree_insert(t, 1);
+  rbtree_insert(t, 2);
+  rbtree_insert(t, 3);
+  const key_t expect[] = {3, 6, 7};
+  assert(rbtree_to_array(t, res, 3) == 3);
+  for (int i = 0; i < 3; i++)
+  {
+    assert(res[i] == expect[i]);
+  }
+  delete_rbtree(t);
+
+  free(res);
+  free(stream);
+}
+
+// counts만 보고 insert/erase를 정하므로 wal이 NULL이면 같은 순서의 기댓값만 계산
+static void test_wal_workload(rbtree_wal *wal, int *counts, const key_t range, const size_t ops, const unsigned int seed)
+{
+  srand(seed);
+  for (size_t r = 0; r < ops; r++)
+  {
+    const key_t k = rand() % range;
+    if (rand() % 3 == 0 && counts[k] > 0)
+    {
+      counts[k]--;
+      if (wal) assert(wal_erase(wal, rbtree_find(wal->tree, k)) == 0);
+    }
+    else
+    {
+      counts[k]++;
+      if (wal) assert(wal_insert(wal, k) != NULL);
+    }
+  }
+}
+
+static void test_wal_check(const rbtree *t, const int *counts, const key_t range)
+{
+  size_t total = 0;
+  for (key_t k = 0; k < range; k++)
+  {
+    total += counts[k];
+  }
+  assert(t->size == total);
+  key_t *res = calloc(total + 1, sizeof(key_t));
+  assert(rbtree_to_array(t, res, total + 1) == (int)total);
+  size_t i = 0;
+  for (key_t k = 0; k < range; k++)
+  {
+    for (int c = 0; c < counts[k]; c++)
+    {
+      assert(res[i++] == k);
+    }
+  }
+  test_color_constraint(t);
+  free(res);
+}
+
+static off_t test_file_size(const char *dir, const char *name)
+{
+  char path[256];
+  struct stat sb;
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  return stat(path, &sb) == 0 ? sb.st_size : -1;
+}
+
+// 동기화 후 죽은 프로세스의 로그를 checkpoint + 로그 꼬리로 복구
+void test_wal(const size_t ops, const unsigned int seed)
+{
+  char dir[] = "/tmp/rbtree-wal-XXXXXX";
+  assert(mkdtemp(dir) != NULL);
+  const key_t range = 500;
+  int *counts = calloc(range, sizeof(int));
+
+  rbtree_wal *wal = wal_open(dir);
+  assert(wal != NULL && wal->tree->size == 0);
+  assert(wal_close(wal) == 0);
+
+  pid_t pid = fork();
+  assert(pid >= 0);
+  if (pid == 0)
+  {
+    wal = wal_open(dir);
+    wal->checkpoint_min = 4096;  // 자동 checkpoint가 여러 번 일어나도록
+    test_wal_workload(wal, counts, range, ops, seed);
+    int ok = wal_sync(wal) == 0;
+    wal->checkpoint_min = SIZE_MAX;
+    wal_insert(wal, range);  // sync 전에 죽으면 사라짐
+    _exit(ok ? 0 : 1);
+  }
+  int status;
+  assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  test_wal_workload(NULL, counts, range, ops, seed);
+  assert(test_file_size(dir, "checkpoint") > 0);
+  assert(test_file_size(dir, "wal.log") < (off_t)(ops * 5));
+
+  wal = wal_open(dir);
+  assert(wal != NULL);
+  test_wal_check(wal->tree, counts, range);
+  assert(wal_close(wal) == 0);
+
+  // 쓰다 만 batch는 버리고 잘라냄
+  char path[256];
+  snprintf(path, sizeof(path), "%s/wal.log", dir);
+  const off_t log_size = test_file_size(dir, "wal.log");
+  FILE *fp = fopen(path, "ab");
+  fwrite("WALB\x05", 1, 5, fp);
+  fclose(fp);
+  wal = wal_open(dir);
+  assert(wal != NULL && test_file_size(dir, "wal.log") == log_size);
+  test_wal_check(wal->tree, counts, range);
+
+  // checksum이 틀린 batch 이후는 재생하지 않음
+  assert(wal_insert(wal, range) != NULL);
+  assert(wal_close(wal) == 0);
+  int fd = open(path, O_RDWR);
+  const off_t end = lseek(fd, 0, SEEK_END);
+  char byte;
+  assert(pread(fd, &byte, 1, end - 1) == 1);
+  byte ^= 0x40;
+  assert(pwrite(fd, &byte, 1, end - 1) == 1);
+  close(fd);
+  wal = wal_open(dir);
+  assert(wal != NULL && rbtree_find(wal->tree, range) == NULL);
+  test_wal_check(wal->tree, counts, range);
+
+  // checkpoint 후에는 로그가 비고 checkpoint만으로 복구
+  assert(wal_checkpoint(wal) == 0);
+  assert(test_file_size(dir, "wal.log") == 0);
+  assert(wal_close(wal) == 0);
+  wal = wal_open(dir);
+  test_wal_check(wal->tree, counts, range);
+  assert(wal_close(wal) == 0);
+
+  snprintf(path, sizeof(path), "%s/wal.log", dir);
+  unlink(path);
+  snprintf(path, sizeof(path), "%s/checkpoint", dir);
+  unlink(path);
+  assert(rmdir(dir) == 0);
+  free(counts);
+}
+
+// 트레이스에 있어야 할 레코드를 expected에 쌓음
+static void test_trace_expect(trace_op_t *expected, size_t *m, int op, int64_t arg, int hit)
+{
+  trace_op_t rec = {op, hit, arg, 0};
+  expected[(*m)++] = rec;
+}
+
+void test_trace(const size_t ops, const unsigned int seed)
+{
+  char path[] = "/tmp/rbtree-trace-XXXXXX";
+  int fd = mkstemp(path);
+  assert(fd >= 0);
+  close(fd);
+
+  const key_t range = 300;
+  int *counts = calloc(range, sizeof(int));
+  trace_op_t *expected = calloc(ops * 2 + 8, sizeof(trace_op_t));
+  key_t *arr = calloc(ops, sizeof(key_t));
+  size_t m = 0;
+
+  rbtree *t = new_rbtree();
+  rbtree_insert(t, range);  // 켜기 전 호출은 기록 안 됨
+  assert(rbtree_trace_start(t, path) == 0);
+  assert(rbtree_trace_start(t, path) == -1);
+
+  srand(seed);
+  for (size_t i = 0; i < ops; ++i)
+  {
+    const key_t key = rand() % range;
+    switch (rand() % 6)
+    {
+    case 0:
+    case 1:
+      assert(rbtree_insert(t, key) != NULL);
+      counts[key]++;
+      test_trace_expect(expected, &m, TRACE_INSERT, key, 1);
+      break;
+    case 2:
+      assert((rbtree_find(t, key) != NULL) == (counts[key] > 0));
+      test_trace_expect(expected, &m, TRACE_FIND, key, counts[key] > 0);
+      break;
+    case 3: {
+      node_t *p = rbtree_find(t, key);
+      test_trace_expect(expected, &m, TRACE_FIND, key, p != NULL);
+      if (p)
+      {
+        rbtree_erase(t, p);
+        counts[key]--;
+        test_trace_expect(expected, &m, TRACE_ERASE, key, 1);
+      }
+      break;
+    }
+    case 4:
+      rbtree_min(t);
+      rbtree_max(t);
+      test_trace_expect(expected, &m, TRACE_MIN, 0, 1);
+      test_trace_expect(expected, &m, TRACE_MAX, 0, 1);
+      break;
+    default:
+      rbtree_to_array(t, arr, i);
+      test_trace_expect(expected, &m, TRACE_TO_ARRAY, (int64_t)i, 1);
+      break;
+    }
+  }
+
+  // find_batch는 find를 차례로 부른 것처럼, 내부 호출(rbtree_prev(nil)의 max)은 기록 안 됨
+  const key_t batch[2] = {-1, range};
+  node_t *out[2];
+  rbtree_find_batch(t, batch, 2, out);
+  assert(out[0] == NULL && out[1] != NULL);
+  test_trace_expect(expected, &m, TRACE_FIND, -1, 0);
+  test_trace_expect(expected, &m, TRACE_FIND, range, 1);
+  assert(rbtree_prev(t, t->nil)->key == range);
+
+  assert(rbtree_trace_stop(t) == 0);
+  assert(rbtree_trace_stop(t) == -1);
+  rbtree_insert(t, 0);
+
+  trace_op_t *got;
+  size_t n;
+  assert(trace_load(path, &got, &n) == 0);
+  assert(n == m);
+  for (size_t i = 0; i < n; ++i)
+  {
+    assert(got[i].op == expected[i].op && got[i].arg == expected[i].arg && got[i].hit == expected[i].hit);
+    assert(i == 0 || got[i].ns >= got[i - 1].ns);
+  }
+  free(got);
+
+  // 잘린 마지막 레코드는 버림
+  struct stat st;
+  assert(stat(path, &st) == 0 && truncate(path, st.st_size - 1) == 0);
+  assert(trace_load(path, &got, &n) == 0 && n == m - 1);
+  free(got);
+
+  // 트레이스가 켜진 채로 해제하면 남은 기록을 쓰고 닫음
+  assert(rbtree_trace_start(t, path) == 0);
+  rbtree_find(t, 0);
+  delete_rbtree(t);
+  assert(trace_load(path, &got, &n) == 0 && n == 1 && got[0].op == TRACE_FIND && got[0].hit);
+  free(got);
+
+  unlink(path);
+  free(arr);
+  free(expected);
+  free(counts);
+}
+
+#define TEST_FC_THREADS 8
+#define TEST_FC_RANGE 200
+
+// 스레드마다 자기 key(key % 스레드 수 == id)만 다뤄서 결과를 혼자 확인할 수 있게 함
+typedef struct {
+  fctree *fc;
+  int id;
+  size_t ops;
+  unsigned int seed;
+  int counts[TEST_FC_RANGE];
+  int ok;
+} test_fc_worker_t;
+
+static void *test_fc_worker(void *arg)
+{
+  test_fc_worker_t *w = arg;
+  unsigned int seed = w->seed;
+  w->ok = 1;
+  for (size_t i = 0; i < w->ops; ++i)
+  {
+    const int k = rand_r(&seed) % TEST_FC_RANGE;
+    const key_t key = k * TEST_FC_THREADS + w->id;
+    switch (rand_r(&seed) % 3)
+    {
+    case 0:
+      w->ok &= fctree_insert(w->fc, key) == 0;
+      w->counts[k]++;
+      break;
+    case 1:
+      w->ok &= fctree_erase(w->fc, key) == (w->counts[k] > 0);
+      if (w->counts[k] > 0) w->counts[k]--;
+      break;
+    default:
+      w->ok &= fctree_find(w->fc, key) == (w->counts[k] > 0);
+      break;
+    }
+  }
+  return NULL;
+}
+
+void test_fctree(const size_t ops, const unsigned int seed)
+{
+  fctree *fc = new_fctree();
+  assert(fc != NULL);
+
+  test_fc_worker_t workers[TEST_FC_THREADS];
+  pthread_t threads[TEST_FC_THREADS];
+  for (int t = 0; t < TEST_FC_THREADS; ++t)
+  {
+    workers[t] = (test_fc_worker_t){.fc = fc, .id = t, .ops = ops, .seed = seed + t};
+    assert(pthread_create(&threads[t], NULL, test_fc_worker, &workers[t]) == 0);
+  }
+
+  size_t total = 0;
+  for (int t = 0; t < TEST_FC_THREADS; ++t)
+  {
+    assert(pthread_join(threads[t], NULL) == 0);
+    assert(workers[t].ok);
+    for (int k = 0; k < TEST_FC_RANGE; ++k)
+    {
+      total += workers[t].counts[k];
+    }
+  }
+
+  const rbtree *t = fctree_tree(fc);
+  assert(t->size == total);
+  test_search_constraint(t);
+  test_color_constraint(t);
+
+  key_t *arr = calloc(total + 1, sizeof(key_t));
+  assert(rbtree_to_array(t, arr, total) == (int)total);
+  for (size_t i = 0; i < total;)
+  {
+    const key_t key = arr[i];
+    const int expected = workers[key % TEST_FC_THREADS].counts[key / TEST_FC_THREADS];
+    assert(expected > 0);
+    for (int c = 0; c < expected; ++c, ++i)
+    {
+      assert(i < total && arr[i] == key);
+    }
+  }
+
+  free(arr);
+  delete_fctree(fc);
+}
+
+static void test_bloom_check(const rbtree *t, const int *counts, const key_t range)
+{
+  for (key_t k = 0; k < range; ++k)
+  {
+    assert((rbtree_find(t, k) != NULL) == (counts[k] > 0));
+    assert(counts[k] == 0 || bloom_maybe(t->bloom, k));
+  }
+}
+
+static int test_bloom_next(void *ctx, key_t *key)
+{
+  *key = (*(key_t *)ctx)++;
+  return 0;
+}
+
+void test_bloom(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  const key_t range = (key_t)n * 2;
+  int *counts = calloc(range, sizeof(int));
+  rbtree *t = new_rbtree();
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    const key_t k = rand() % range;
+    rbtree_insert(t, k);
+    counts[k]++;
+  }
+  assert(rbtree_enable_bloom(t) == 0 && t->bloom != NULL);
+  test_bloom_check(t, counts, range);
+
+  // 늘어나면 키우고, 많이 지우면 다시 만듦 (lazy erase 포함)
+  for (int phase = 0; phase < 2; ++phase)
+  {
+    if (phase == 1)
+    {
+      assert(rbtree_set_lazy_erase(t, 0.3) == 0);
+    }
+    for (size_t i = 0; i < 2 * n; i++)
+    {
+      const key_t k = rand() % range;
+      if (rand() % 2)
+      {
+        rbtree_insert(t, k);
+        counts[k]++;
+      }
+      else if (counts[k] > 0)
+      {
+        rbtree_erase(t, rbtree_find(t, k));
+        counts[k]--;
+      }
+      const key_t probe = rand() % range;
+      assert((rbtree_find(t, probe) != NULL) == (counts[probe] > 0));
+    }
+    test_bloom_check(t, counts, range);
+  }
+  assert(rbtree_set_lazy_erase(t, 0) == 0);
+  test_color_constraint(t);
+
+  // 넣은 적 없는 key는 대부분 걸러짐
+  size_t passed = 0;
+  for (key_t k = range; k < range + 100000; ++k)
+  {
+    passed += bloom_maybe(t->bloom, k);
+    assert(rbtree_find(t, k) == NULL);
+  }
+  assert(passed < 3000);
+
+  rbtree_clear(t);
+  memset(counts, 0, range * sizeof(int));
+  test_bloom_check(t, counts, range);
+  key_t next = 0;
+  assert(rbtree_build(t, (size_t)range / 2, test_bloom_next, &next) == 0);
+  for (key_t k = 0; k < range / 2; ++k)
+  {
+    counts[k] = 1;
+  }
+  test_bloom_check(t, counts, range);
+
+  rbtree_disable_bloom(t);
+  assert(t->bloom == NULL && rbtree_find(t, 0) != NULL);
+
+  free(counts);
+  delete_rbtree(t);
+}
+
+typedef struct {
+  key_t *out;
+  size_t calls;  // 여러 스레드가 더함
+} test_visit_t;
+
+static void test_visit(void *ctx, node_t *node, size_t rank)
+{
+  test_visit_t *v = ctx;
+  v->out[rank] = node->key;
+  __atomic_fetch_add(&v->calls, 1, __ATOMIC_RELAXED);
+}
+
+void test_parallel_export(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  rbtree *t = new_rbtree();
+  node_t **nodes = calloc(n, sizeof(node_t *));
+  for (size_t i = 0; i < n; i++)
+  {
+    nodes[i] = rbtree_insert(t, rand() % (key_t)(n / 2));
+  }
+  // dead 노드는 건너뛰어야 함
+  assert(rbtree_set_lazy_erase(t, 0.5) == 0);
+  for (size_t i = 0; i < n / 5; i++)
+  {
+    rbtree_erase(t, nodes[rand() % n]);
+  }
+
+  const size_t live = t->size - t->dead_count;
+  key_t *expected = calloc(live, sizeof(key_t));
+  key_t *got = calloc(live, sizeof(key_t));
+  assert(rbtree_to_array(t, expected, live) == (int)live);
+
+  const int threads[] = {1, 2, 3, 8, 0};
+  for (size_t k = 0; k < sizeof(threads) / sizeof(threads[0]); k++)
+  {
+    memset(got, 0, live * sizeof(key_t));
+    assert(rbtree_to_array_parallel(t, got, live, threads[k]) == (int)live);
+    assert(memcmp(got, expected, live * sizeof(key_t)) == 0);
+
+    // 배열이 작으면 앞부분만
+    memset(got, 0, live * sizeof(key_t));
+    assert(rbtree_to_array_parallel(t, got, live / 3, threads[k]) == (int)(live / 3));
+    assert(memcmp(got, expected, live / 3 * sizeof(key_t)) == 0 && got[live / 3] == 0);
+
+    test_visit_t v = {got, 0};
+    memset(got, 0, live * sizeof(key_t));
+    rbtree_foreach(t, test_visit, &v, threads[k]);
+    assert(v.calls == live && memcmp(got, expected, live * sizeof(key_t)) == 0);
+  }
+
+  rbtree *empty = new_rbtree();
+  assert(rbtree_to_array_parallel(empty, got, live, 4) == 0);
+  delete_rbtree(empty);
+
+  free(got);
+  free(expected);
+  free(nodes);
+  delete_rbtree(t);
+}
+
+void test_node_arena(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  node_arena *arena = node_arena_new(NODE_ARENA_THP | NODE_ARENA_NUMA_LOCAL);
+  assert(arena != NULL);
+  rbtree *t = new_rbtree();
+  assert(node_arena_attach(arena, t) == 0);
+
+  key_t *arr = calloc(n, sizeof(key_t));
+  node_t **nodes = calloc(n, sizeof(node_t *));
+  for (size_t i = 0; i < n; i++)
+  {
+    arr[i] = rand();
+    nodes[i] = rbtree_insert(t, arr[i]);
+  }
+  assert(arena->stats.chunks > 0 && arena->stats.bytes >= n * sizeof(node_t));
+
+  // 노드는 chunk 안에 연속으로 놓임
+  int adjacent = 0;
+  for (size_t i = 1; i < n; i++)
+  {
+    adjacent += (char *)nodes[i] - (char *)nodes[i - 1] == (ptrdiff_t)arena->slot_size;
+  }
+  assert(adjacent > (int)(n * 9 / 10));
+
+  // 지운 칸은 다시 씀
+  const size_t chunks = arena->stats.chunks;
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    rbtree_erase(t, nodes[i]);
+  }
+  for (size_t i = 0; i < n / 2; i++)
+  {
+    arr[i] = rand();
+    rbtree_insert(t, arr[i]);
+  }
+  assert(arena->stats.chunks == chunks);
+  test_color_constraint(t);
+  test_search_constraint(t);
+
+  key_t *res = calloc(n, sizeof(key_t));
+  assert(rbtree_to_array(t, res, n) == (int)n);
+  qsort(arr, n, sizeof(key_t), comp);
+  assert(memcmp(arr, res, n * sizeof(key_t)) == 0);
+
+  // 노드가 있는 트리에는 못 붙임
+  assert(node_arena_attach(arena, t) == -1);
+
+  delete_rbtree(t);
+  node_arena_delete(arena);
+  free(res);
+  free(nodes);
+  free(arr);
+}
+
+typedef struct {
+  rbtree_async *as;
+  int id;
+  size_t ops;
+  unsigned int seed;
+  int counts[TEST_FC_RANGE];
+  int ok;
+} test_async_worker_t;
+
+static void *test_async_worker(void *arg)
+{
+  test_async_worker_t *w = arg;
+  unsigned int seed = w->seed;
+  uint64_t last = 0;
+  w->ok = 1;
+  for (size_t i = 0; i < w->ops; ++i)
+  {
+    const int k = rand_r(&seed) % TEST_FC_RANGE;
+    const key_t key = k * TEST_FC_THREADS + w->id;
+    uint64_t seq;
+    if (rand_r(&seed) % 3 == 0 && w->counts[k] > 0)
+    {
+      seq = rbtree_erase_async(w->as, key);
+      w->counts[k]--;
+    }
+    else
+    {
+      seq = rbtree_insert_async(w->as, key);
+      w->counts[k]++;
+    }
+    w->ok &= seq > last;
+    last = seq;
+
+    if (i % 1000 == 999)
+    {
+      rbtree_async_wait(w->as, seq);
+      w->ok &= rbtree_async_applied(w->as) >= seq;
+    }
+  }
+  return NULL;
+}
+
+void test_async_ingest(const size_t ops, const unsigned int seed)
+{
+  rbtree *t = new_rbtree();
+  // 링을 작게 잡아서 가득 찼을 때 기다리는 경로도 지나가게 함
+  rbtree_async *as = rbtree_async_start(t, 64);
+  assert(as != NULL);
+
+  test_async_worker_t workers[TEST_FC_THREADS];
+  pthread_t threads[TEST_FC_THREADS];
+  for (int i = 0; i < TEST_FC_THREADS; ++i)
+  {
+    workers[i] = (test_async_worker_t){.as = as, .id = i, .ops = ops, .seed = seed + i};
+    assert(pthread_create(&threads[i], NULL, test_async_worker, &workers[i]) == 0);
+  }
+
+  size_t total = 0;
+  for (int i = 0; i < TEST_FC_THREADS; ++i)
+  {
+    assert(pthread_join(threads[i], NULL) == 0);
+    assert(workers[i].ok);
+    for (int k = 0; k < TEST_FC_RANGE; ++k)
+    {
+      total += workers[i].counts[k];
+    }
+  }
+
+  // 올리는 스레드가 없으면 flush 뒤에는 읽어도 됨
+  assert(rbtree_async_flush(as) == ops * TEST_FC_THREADS);
+  assert(rbtree_async_applied(as) == ops * TEST_FC_THREADS);
+  assert(t->size == total);
+
+  // stop 전에 남은 연산도 적용됨
+  const key_t extra = TEST_FC_RANGE * TEST_FC_THREADS;
+  rbtree_insert_async(as, extra);
+  rbtree_insert_async(as, extra);
+  rbtree_erase_async(as, extra);
+  rbtree_async_stop(as);
+  assert(t->size == total + 1 && rbtree_find(t, extra) != NULL);
+  test_search_constraint(t);
+  test_color_constraint(t);
+
+  key_t *arr = calloc(total + 1, sizeof(key_t));
+  assert(rbtree_to_array(t, arr, total) == (int)total);
+  for (size_t i = 0; i < total;)
+  {
+    const key_t key = arr[i];
+    const int expected = workers[key % TEST_FC_THREADS].counts[key / TEST_FC_THREADS];
+    assert(expected > 0);
+    for (int c = 0; c < expected; ++c, ++i)
+    {
+      assert(i < total && arr[i] == key);
+    }
+  }
+
+  free(arr);
+  delete_rbtree(t);
+
+  // 색인/lazy erase/top-K 모드가 켜진 트리도 rbtree_insert/rbtree_erase와 똑같이 적용
+  t = new_rbtree();
+  assert(rbtree_enable_index(t) == 0 && rbtree_set_lazy_erase(t, 0.9) == 0);
+  as = rbtree_async_start(t, 64);
+  for (key_t k = 0; k < 100; ++k)
+  {
+    rbtree_insert_async(as, k);
+  }
+  for (key_t k = 0; k < 100; k += 2)
+  {
+    rbtree_erase_async(as, k);
+  }
+  rbtree_async_stop(as);
+  assert(t->size - t->dead_count == 50);
+  for (key_t k = 0; k < 100; ++k)
+  {
+    assert((rbtree_find(t, k) != NULL) == (k % 2 == 1));
+  }
+  delete_rbtree(t);
+
+  t = new_rbtree();
+  assert(rbtree_set_capacity(t, 10) == 0);
+  as = rbtree_async_start(t, 64);
+  for (key_t k = 0; k < 100; ++k)
+  {
+    rbtree_insert_async(as, k);
+  }
+  rbtree_async_stop(as);
+  assert(t->size == 10 && rbtree_min(t)->key == 90 && rbtree_max(t)->key == 99);
+  delete_rbtree(t);
+}
+
+typedef struct {
+  unsigned char *data;
+  size_t len;
+  size_t cap;
+  size_t pos;
+  unsigned int seed;
+} test_stream_t;
+
+static int test_stream_write(void *ctx, const void *buf, size_t len)
+{
+  test_stream_t *s = ctx;
+  if (s->len + len > s->cap)
+  {
+    s->cap = (s->len + len) * 2;
+    s->data = realloc(s->data, s->cap);
+    assert(s->data != NULL);
+  }
+  memcpy(s->data + s->len, buf, len);
+  s->len += len;
+  return 0;
+}
+
+// 한 번에 1~7바이트씩만 줘서 블록이 버퍼 경계에 걸치는 경우도 지나가게 함
+static ssize_t test_stream_read(void *ctx, void *buf, size_t len)
+{
+  test_stream_t *s = ctx;
+  size_t r = 1 + rand_r(&s->seed) % 7;
+  if (r > len) r = len;
+  if (r > s->len - s->pos) r = s->len - s->pos;
+  memcpy(buf, s->data + s->pos, r);
+  s->pos += r;
+  return (ssize_t)r;
+}
+
+static void test_keystream_roundtrip(const rbtree *t, test_stream_t *s)
+{
+  s->len = 0;
+  s->pos = 0;
+  assert(rbtree_encode(t, test_stream_write, s) == 0);
+  // 흐름 뒤에 이어지는 데이터는 읽지 않고 남겨 둠
+  const size_t full = s->len;
+  assert(test_stream_write(s, "tail", 4) == 0);
+
+  const size_t n = t->size - t->dead_count;
+  rbtree *u = new_rbtree();
+  assert(rbtree_decode(u, test_stream_read, s) == 0);
+  assert(s->pos == full);
+  s->len = full;
+  assert(u->size == n);
+  test_search_constraint(u);
+  test_color_constraint(u);
+
+  key_t *a = calloc(n + 1, sizeof(key_t));
+  key_t *b = calloc(n + 1, sizeof(key_t));
+  assert(rbtree_to_array(t, a, n) == (int)n);
+  assert(rbtree_to_array(u, b, n) == (int)n);
+  assert(memcmp(a, b, n * sizeof(key_t)) == 0);
+
+  free(a);
+  free(b);
+  delete_rbtree(u);
+}
+
+void test_keystream(const size_t n, const unsigned int seed)
+{
+  srand(seed);
+  test_stream_t s = {.seed = seed};
+
+  // 빈 트리
+  rbtree *t = new_rbtree();
+  test_keystream_roundtrip(t, &s);
+
+  // 음수/양 끝 key, 중복, lazy erase로 죽은 노드 포함
+  assert(rbtree_set_lazy_erase(t, 1.0) == 0);
+  rbtree_insert(t, INT_MIN);
+  rbtree_insert(t, INT_MAX);
+  rbtree_insert(t, INT_MAX);
+  key_t *keys = calloc(n, sizeof(key_t));
+  for (size_t i = 0; i < n; i++)
+  {
+    keys[i] = rand() - RAND_MAX / 2;
+    rbtree_insert(t, keys[i]);
+  }
+  for (size_t i = 0; i < n; i += 4)
+  {
+    rbtree_erase(t, rbtree_find(t, keys[i]));
+  }
+  free(keys);
+  assert(t->dead_count > 0);
+  test_keystream_roundtrip(t, &s);
+
+  // 잘린 흐름, 틀린 magic, 비어 있지 않은 트리 -> 실패하고 트리는 그대로
+  rbtree *u = new_rbtree();
+  const size_t full = s.len;
+  s.len = full - 3;
+  s.pos = 0;
+  assert(rbtree_decode(u, test_stream_read, &s) == -1 && u->size == 0 && u->root == u->nil);
+  s.len = full;
+  s.pos = 0;
+  s.data[0] ^= 1;
+  assert(rbtree_decode(u, test_stream_read, &s) == -1 && u->size == 0);
+  s.data[0] ^= 1;
+  rbtree_insert(u, 1);
+  s.pos = 0;
+  assert(rbtree_decode(u, test_stream_read, &s) == -1 && u->size == 1);
+  delete_rbtree(u);
+  delete_rbtree(t);
+
+  // 촘촘한 key는 key_t 배열보다 훨씬 작음 (차이 1 -> 블록당 1비트)
+  t = new_rbtree();
+  for (size_t i = 0; i < n; i++)
+  {
+    rbtree_insert(t, (key_t)(i * 3 / 2));
+  }
+  test_keystream_roundtrip(t, &s);
+  assert(s.len < n * sizeof(key_t) / 8);
+
+  // 파일 디스크립터
+  FILE *fp = tmpfile();
+  assert(fp != NULL);
+  assert(rbtree_encode_fd(t, fileno(fp)) == 0);
+  assert(write(fileno(fp), "tail", 4) == 4);
+  assert(lseek(fileno(fp), 0, SEEK_SET) == 0);
+  u = new_rbtree();
+  assert(rbtree_decode_fd(u, fileno(fp)) == 0 && u->size == n);
+  char tail[8];
+  assert(read(fileno(fp), tail, sizeof(tail)) == 4 && memcmp(tail, "tail", 4) == 0);
+  assert(rbtree_min(u)->key == 0 && rbtree_max(u)->key == (key_t)((n - 1) * 3 / 2));
+  fclose(fp);
+
+  delete_rbtree(u);
+  delete_rbtree(t);
+  free(s.data);
+}
+
+#define TEST_CT_THREADS 8
+#define TEST_CT_RANGE 2000
+
+// test_fctree처럼 스레드마다 자기 key만 다룸, key가 서로 끼워져 있어서 같은 부분 트리를 같이 고침
+typedef struct {
+  ctree *ct;
+  int id;
+  size_t ops;
+  unsigned int seed;
+  int counts[TEST_CT_RANGE];
+  int ok;
+} test_ct_worker_t;
+
+static void *test_ct_worker(void *arg)
+{
+  test_ct_worker_t *w = arg;
+  unsigned int seed = w->seed;
+  w->ok = 1;
+  for (size_t i = 0; i < w->ops; ++i)
+  {
+    // 절반은 앞쪽 1/16에 몰아서 같은 노드 주변에서 자주 부딪히게 함
+    const int r = rand_r(&seed);
+    const int k = (r & 1) ? (r >> 1) % (TEST_CT_RANGE / 16) : (r >> 1) % TEST_CT_RANGE;
+    const key_t key = k * TEST_CT_THREADS + w->id;
+    switch (rand_r(&seed) % 4)
+    {
+    case 0:
+    case 1:
+      w->ok &= ctree_insert(w->ct, key) == 0;
+      w->counts[k]++;
+      break;
+    case 2:
+      w->ok &= ctree_erase(w->ct, key) == (w->counts[k] > 0);
+      if (w->counts[k] > 0) w->counts[k]--;
+      break;
+    default:
+      w->ok &= ctree_find(w->ct, key) == (w->counts[k] > 0);
+      break;
+    }
+  }
+  return NULL;
+}
+
+// 자기 key를 전부 지움 (여러 스레드가 같이 떼어 내고 erase_fixup 단계를 진행)
+static void *test_ct_eraser(void *arg)
+{
+  test_ct_worker_t *w = arg;
+  w->ok = 1;
+  for (int k = 0; k < TEST_CT_RANGE; ++k)
+  {
+    const key_t key = k * TEST_CT_THREADS + w->id;
+    for (; w->counts[k] > 0; w->counts[k]--)
+    {
+      w->ok &= ctree_erase(w->ct, key) == 1;
+    }
+    w->ok &= ctree_erase(w->ct, key) == 0;
+  }
+  return NULL;
+}
+
+void test_ctree(const size_t ops, const unsigned int seed)
+{
+  ctree *ct = new_ctree();
+  assert(ct != NULL);
+
+  test_ct_worker_t *workers = calloc(TEST_CT_THREADS, sizeof(test_ct_worker_t));
+  pthread_t threads[TEST_CT_THREADS];
+  for (int t = 0; t < TEST_CT_THREADS; ++t)
+  {
+    workers[t] = (test_ct_worker_t){.ct = ct, .id = t, .ops = ops, .seed = seed + t};
+    assert(pthread_create(&threads[t], NULL, test_ct_worker, &workers[t]) == 0);
+  }
+
+  size_t live = 0;
+  for (int t = 0; t < TEST_CT_THREADS; ++t)
+  {
+    assert(pthread_join(threads[t], NULL) == 0);
+    assert(workers[t].ok);
+    for (int k = 0; k < TEST_CT_RANGE; ++k)
+    {
+      live += workers[t].counts[k] > 0;
+    }
+  }
+
+  // 연산이 다 끝나면 남은 위반이 없어야 함
+  const rbtree *t = ctree_tree(ct);
+  test_search_constraint(t);
+  test_color_constraint(t);
+
+  size_t nodes = 0;
+  size_t seen = 0;
+  for (node_t *x = rbtree_min(t); x != t->nil; x = rbtree_next(t, x), ++seen)
+  {
+    assert(x->left == t->nil || x->left->parent == x);
+    assert(x->right == t->nil || x->right->parent == x);
+    assert(!x->dead);
+    assert(workers[x->key % TEST_CT_THREADS].counts[x->key / TEST_CT_THREADS] > 0);
+  }
+  assert(seen == live && t->size - t->dead_count == live);
+  for (int w = 0; w < TEST_CT_THREADS; ++w)
+  {
+    for (int k = 0; k < TEST_CT_RANGE; ++k)
+    {
+      const key_t key = k * TEST_CT_THREADS + w;
+      assert(ctree_count(ct, key) == (size_t)workers[w].counts[k]);
+      nodes += workers[w].counts[k] > 0;
+    }
+  }
+  assert(nodes == live);
+
+  // 여러 스레드가 같이 다 지우면 노드가 모두 떼어진 빈 트리
+  for (int w = 0; w < TEST_CT_THREADS; ++w)
+  {
+    assert(pthread_create(&threads[w], NULL, test_ct_eraser, &workers[w]) == 0);
+  }
+  for (int w = 0; w < TEST_CT_THREADS; ++w)
+  {
+    assert(pthread_join(threads[w], NULL) == 0);
+    assert(workers[w].ok);
+  }
+  t = ctree_tree(ct);
+  assert(t->root == t->nil && t->size == 0);
+
+  free(workers);
+  delete_ctree(ct);
+}
+#endif  // RBTREE_CORE_ONLY
+
+int main(void)
+{
+  test_init();
+  printf("1 OK\n");
+
+  test_insert_single(1024);
+  printf("2 OK\n");
+
+  test_find_single(512, 1024);
+  printf("3 OK\n");
+
+  test_erase_root(128);
+  printf("4 OK\n");
+
+  test_find_erase_fixed();
+  printf("5 OK\n");
+
+  test_minmax_suite();
+  printf("6 OK\n");
+
+  test_to_array_suite();
+  printf("7 OK\n");
+
+  test_distinct_values();
+  printf("8 OK\n");
+
+  test_duplicate_values();
+  printf("9 OK\n");
+
+  test_multi_instance();
+  printf("10 OK\n");
+
+  test_find_erase_rand(10000, 17);
+  printf("11 OK\n");
+
+#ifndef RBTREE_CORE_ONLY
+
+  test_interval_tree(500, 23);
+  printf("12 OK\n");
+
+  test_aggregate_suite();
+  printf("13 OK\n");
+
+  test_find_batch(1003, 47);
+  printf("14 OK\n");
+
+  test_compact(2000, 53);
+  printf("15 OK\n");
+
+  test_hash_index(400, 59);
+  printf("16 OK\n");
+
+  test_purge_shapes();
+  test_lazy_erase(800, 61);
+  printf("17 OK\n");
+
+  test_strtree(1500, 67);
+  printf("18 OK\n");
+
+  test_shmtree(2000, 71);
+  printf("19 OK\n");
+
+  test_destroy_clear(1000, 73);
+  printf("20 OK\n");
+
+  test_topk(20000, 100, 79);
+  printf("21 OK\n");
+
+  test_wal(20000, 83);
+  printf("22 OK\n");
+
+  test_trace(20000, 89);
+  printf("23 OK\n");
+
+  test_fctree(20000, 97);
+  printf("24 OK\n");
+
+  test_bloom(20000, 101);
+  printf("25 OK\n");
+#endif
+
+  test_erase_keeps_handles(10000, 103);
+  printf("26 OK\n");
+
+#ifndef RBTREE_CORE_ONLY
+  test_parallel_export(200000, 107);
+  printf("27 OK\n");
+
+  test_node_arena(50000, 109);
+  printf("28 OK\n");
+
+  test_async_ingest(20000, 113);
+  printf("29 OK\n");
+
+  test_keystream(100000, 127);
+  printf("30 OK\n");
+
+  test_ctree(50000, 131);
+  printf("31 OK\n");
+#endif
 
-  test_find_erase_rand(10000, 17);
   printf("Passed all tests!\n");
 }